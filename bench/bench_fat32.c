@@ -0,0 +1,463 @@
+#include "../include/fat32.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_DIR_ENTRIES 65536
+#define DEEP_PATH_DEPTH 64
+
+typedef struct {
+    const char *dir;
+    bool quick;
+    FILE *out;
+    char image[512];
+} Bench;
+
+typedef struct {
+    uint64_t *latencies;
+    uint32_t ops;
+    uint64_t start;
+    uint64_t elapsed;
+    DiskStats before;
+} Run;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static bool run_begin(Run *run, uint32_t max_ops, const Disk *disk) {
+    memset(run, 0, sizeof(Run));
+    run->latencies = (uint64_t*)malloc((size_t)max_ops * sizeof(uint64_t));
+    if (!run->latencies) {
+        return false;
+    }
+    if (disk) {
+        disk_get_stats(disk, &run->before);
+    }
+    return true;
+}
+
+static void op_begin(Run *run) {
+    run->start = now_ns();
+}
+
+static void op_end(Run *run) {
+    uint64_t latency = now_ns() - run->start;
+    run->latencies[run->ops++] = latency;
+    run->elapsed += latency;
+}
+
+static void run_report(Bench *bench, Run *run, const char *name, const char *param, uint64_t value,
+                       const DiskStats *after) {
+    if (run->ops == 0) {
+        free(run->latencies);
+        return;
+    }
+
+    qsort(run->latencies, run->ops, sizeof(uint64_t), compare_u64);
+    uint64_t p50 = run->latencies[(run->ops - 1) / 2];
+    uint64_t p99 = run->latencies[(uint32_t)(((uint64_t)run->ops * 99 - 1) / 100)];
+
+    DiskStats delta = { 0 };
+    if (after) {
+        delta.syscalls = after->syscalls - run->before.syscalls;
+        delta.sectors_read = after->sectors_read - run->before.sectors_read;
+        delta.sectors_written = after->sectors_written - run->before.sectors_written;
+    }
+
+    double seconds = run->elapsed / 1e9;
+    double ops = run->ops;
+    uint64_t bytes = (delta.sectors_read + delta.sectors_written) * DISK_SECTOR_SIZE;
+
+    fprintf(bench->out,
+            "{\"bench\":\"%s\",\"%s\":%llu,\"ops\":%u,\"seconds\":%.6f,\"ops_per_sec\":%.1f,"
+            "\"p50_us\":%.3f,\"p99_us\":%.3f,\"syscalls_per_op\":%.2f,"
+            "\"bytes_read_per_op\":%.1f,\"bytes_written_per_op\":%.1f,\"mib_per_sec\":%.2f}\n",
+            name, param, (unsigned long long)value, run->ops, seconds,
+            seconds > 0 ? ops / seconds : 0.0, p50 / 1e3, p99 / 1e3,
+            delta.syscalls / ops, delta.sectors_read * (double)DISK_SECTOR_SIZE / ops,
+            delta.sectors_written * (double)DISK_SECTOR_SIZE / ops,
+            seconds > 0 ? bytes / seconds / (1024.0 * 1024.0) : 0.0);
+    fflush(bench->out);
+
+    free(run->latencies);
+}
+
+static bool open_image(Bench *bench, FAT32_FileSystem *fs, uint64_t size, bool format) {
+    remove(bench->image);
+
+    DiskOptions options = { .backend = DISK_BACKEND_FILE, .size = size };
+    if (!fat32_init_with_options(fs, bench->image, &options)) {
+        fprintf(stderr, "Failed to create image %s\n", bench->image);
+        return false;
+    }
+
+    if (format && !fat32_format(fs)) {
+        fprintf(stderr, "Failed to format image %s\n", bench->image);
+        fat32_close(fs);
+        return false;
+    }
+    return true;
+}
+
+static void close_image(Bench *bench, FAT32_FileSystem *fs) {
+    fat32_close(fs);
+    remove(bench->image);
+}
+
+static void bench_format(Bench *bench, uint64_t size, FAT32_FormatMode mode, uint32_t reps) {
+    FAT32_FormatOptions options = { .mode = mode, .threads = 4 };
+
+    Run run;
+    if (!run_begin(&run, reps, NULL)) {
+        return;
+    }
+
+    DiskStats total = { 0 };
+    for (uint32_t i = 0; i < reps; i++) {
+        FAT32_FileSystem fs;
+        if (!open_image(bench, &fs, size, false)) {
+            break;
+        }
+
+        disk_reset_stats(&fs.disk);
+        op_begin(&run);
+        bool ok = fat32_format_ex(&fs, &options);
+        op_end(&run);
+
+        total.syscalls += fs.disk.stats.syscalls;
+        total.sectors_read += fs.disk.stats.sectors_read;
+        total.sectors_written += fs.disk.stats.sectors_written;
+        close_image(bench, &fs);
+        if (!ok) {
+            run.ops--;
+            break;
+        }
+    }
+
+    run_report(bench, &run, mode == FAT32_FORMAT_FULL ? "format_full" : "format_quick",
+               "volume_bytes", size, &total);
+}
+
+static void bench_mount(Bench *bench, uint64_t size, uint32_t reps) {
+    FAT32_FileSystem fs;
+    if (!open_image(bench, &fs, size, true)) {
+        return;
+    }
+    fat32_close(&fs);
+
+    Run run;
+    if (!run_begin(&run, reps, NULL)) {
+        remove(bench->image);
+        return;
+    }
+
+    DiskStats total = { 0 };
+    for (uint32_t i = 0; i < reps; i++) {
+        op_begin(&run);
+        bool ok = fat32_init(&fs, bench->image) && fs.is_formatted;
+        op_end(&run);
+
+        total.syscalls += fs.disk.stats.syscalls;
+        total.sectors_read += fs.disk.stats.sectors_read;
+        total.sectors_written += fs.disk.stats.sectors_written;
+        fat32_close(&fs);
+        if (!ok) {
+            run.ops--;
+            break;
+        }
+    }
+
+    run_report(bench, &run, "mount", "volume_bytes", size, &total);
+    remove(bench->image);
+}
+
+static void bench_create(Bench *bench, uint32_t count, bool directories, bool deferred) {
+    FAT32_FileSystem fs;
+    if (!open_image(bench, &fs, 512ull * 1024 * 1024, true)) {
+        return;
+    }
+
+    Run run;
+    if (!run_begin(&run, count, &fs.disk)) {
+        close_image(bench, &fs);
+        return;
+    }
+
+    fat32_set_deferred_sync(&fs, deferred);
+
+    char name[16];
+    for (uint32_t i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), directories ? "D%07u" : "F%07u.TXT", i);
+        op_begin(&run);
+        bool ok = directories ? fat32_create_directory(&fs, name) : fat32_create_file(&fs, name);
+        op_end(&run);
+        if (!ok) {
+            fprintf(stderr, "Failed to create %s\n", name);
+            run.ops--;
+            break;
+        }
+    }
+
+    if (deferred) {
+        op_begin(&run);
+        fat32_set_deferred_sync(&fs, false);
+        run.elapsed += now_ns() - run.start;
+    }
+
+    const char *name_text = directories ? (deferred ? "create_dirs_deferred" : "create_dirs")
+                                        : (deferred ? "create_files_deferred" : "create_files");
+    run_report(bench, &run, name_text, "entries", count, &fs.disk.stats);
+    close_image(bench, &fs);
+}
+
+static void bench_deep_cd(Bench *bench, uint32_t reps) {
+    FAT32_FileSystem fs;
+    if (!open_image(bench, &fs, 64ull * 1024 * 1024, true)) {
+        return;
+    }
+
+    char path[DEEP_PATH_DEPTH * 3 + 1] = "";
+    for (int depth = 0; depth < DEEP_PATH_DEPTH; depth++) {
+        char name[4];
+        snprintf(name, sizeof(name), "%02d", depth);
+        if (!fat32_create_directory(&fs, name)) {
+            fprintf(stderr, "Failed to create deep directory %s\n", name);
+            close_image(bench, &fs);
+            return;
+        }
+        strcat(path, "/");
+        strcat(path, name);
+        fat32_change_directory(&fs, path);
+    }
+
+    Run run;
+    if (!run_begin(&run, reps, &fs.disk)) {
+        close_image(bench, &fs);
+        return;
+    }
+
+    for (uint32_t i = 0; i < reps; i++) {
+        fat32_change_directory(&fs, "/");
+        op_begin(&run);
+        bool ok = fat32_change_directory(&fs, path);
+        op_end(&run);
+        if (!ok) {
+            fprintf(stderr, "Failed to change directory to %s\n", path);
+            run.ops--;
+            break;
+        }
+    }
+
+    run_report(bench, &run, "deep_cd", "depth", DEEP_PATH_DEPTH, &fs.disk.stats);
+    close_image(bench, &fs);
+}
+
+static void bench_ls(Bench *bench, uint32_t count, uint32_t reps) {
+    FAT32_FileSystem fs;
+    if (!open_image(bench, &fs, 256ull * 1024 * 1024, true)) {
+        return;
+    }
+
+    FAT32_DirEntry *entries = (FAT32_DirEntry*)malloc(MAX_DIR_ENTRIES * sizeof(FAT32_DirEntry));
+    Run run;
+    if (!entries || !run_begin(&run, reps, &fs.disk)) {
+        free(entries);
+        close_image(bench, &fs);
+        return;
+    }
+
+    fat32_set_deferred_sync(&fs, true);
+    char name[16];
+    for (uint32_t i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "F%07u.TXT", i);
+        fat32_create_file(&fs, name);
+    }
+    fat32_set_deferred_sync(&fs, false);
+    disk_get_stats(&fs.disk, &run.before);
+
+    for (uint32_t i = 0; i < reps; i++) {
+        uint32_t listed = 0;
+        op_begin(&run);
+        bool ok = fat32_list_directory(&fs, "/", entries, MAX_DIR_ENTRIES, &listed);
+        op_end(&run);
+        if (!ok || listed != count + 2) {
+            fprintf(stderr, "Listed %u entries, expected %u\n", listed, count + 2);
+            run.ops--;
+            break;
+        }
+    }
+
+    run_report(bench, &run, "ls", "entries", count, &fs.disk.stats);
+    free(entries);
+    close_image(bench, &fs);
+}
+
+static void bench_chain(Bench *bench, uint32_t bytes, bool extents, uint32_t reps) {
+    FAT32_FileSystem fs;
+    if (!open_image(bench, &fs, 1ull << 30, true)) {
+        return;
+    }
+
+    Run run;
+    if (!fat32_set_fat_extents(&fs, extents) || !fat32_create_file(&fs, "chain.bin")
+        || !fat32_preallocate(&fs, "/chain.bin", bytes, true) || !run_begin(&run, reps, &fs.disk)) {
+        close_image(bench, &fs);
+        return;
+    }
+
+    uint8_t byte;
+    for (uint32_t i = 0; i < reps; i++) {
+        FAT32_File file;
+        uint32_t read = 0;
+        op_begin(&run);
+        bool ok = fat32_open(&fs, "/chain.bin", FAT32_O_READ, &file);
+        ok = ok && fat32_pread(&file, &byte, 1, bytes - 1, &read) && read == 1;
+        if (ok) {
+            fat32_close_file(&file);
+        }
+        op_end(&run);
+        if (!ok) {
+            run.ops--;
+            break;
+        }
+    }
+
+    run_report(bench, &run, extents ? "chain_walk_extents" : "chain_walk", "file_bytes", bytes, &fs.disk.stats);
+    close_image(bench, &fs);
+}
+
+static void bench_disk(Bench *bench, uint32_t sectors_per_op, bool write) {
+    const uint64_t size = 64ull * 1024 * 1024;
+
+    remove(bench->image);
+    Disk disk;
+    DiskOptions options = { .backend = DISK_BACKEND_FILE, .size = size };
+    if (!disk_init_with_options(&disk, bench->image, &options)) {
+        fprintf(stderr, "Failed to create image %s\n", bench->image);
+        return;
+    }
+
+    uint8_t *buffer = (uint8_t*)malloc((size_t)sectors_per_op * DISK_SECTOR_SIZE);
+    uint32_t ops = (uint32_t)(size / DISK_SECTOR_SIZE / sectors_per_op);
+    if (bench->quick && ops > 4096) {
+        ops = 4096;
+    }
+
+    Run run;
+    if (!buffer || !run_begin(&run, ops, &disk)) {
+        free(buffer);
+        disk_close(&disk);
+        remove(bench->image);
+        return;
+    }
+
+    memset(buffer, 0xA5, (size_t)sectors_per_op * DISK_SECTOR_SIZE);
+    if (!write) {
+        for (uint32_t i = 0; i < ops; i++) {
+            disk_write_sectors(&disk, (uint64_t)i * sectors_per_op, sectors_per_op, buffer);
+        }
+        disk_get_stats(&disk, &run.before);
+    }
+
+    for (uint32_t i = 0; i < ops; i++) {
+        uint64_t sector = (uint64_t)i * sectors_per_op;
+        op_begin(&run);
+        bool ok = write ? disk_write_sectors(&disk, sector, sectors_per_op, buffer)
+                        : disk_read_sectors(&disk, sector, sectors_per_op, buffer);
+        op_end(&run);
+        if (!ok) {
+            run.ops--;
+            break;
+        }
+    }
+
+    run_report(bench, &run, write ? "disk_write_sectors" : "disk_read_sectors",
+               "sectors_per_op", sectors_per_op, &disk.stats);
+    free(buffer);
+    disk_close(&disk);
+    remove(bench->image);
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--quick] [--dir <path>] [--output <file>]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    Bench bench = { .dir = "/tmp", .quick = false, .out = NULL };
+    const char *output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            bench.quick = true;
+        } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            bench.dir = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    snprintf(bench.image, sizeof(bench.image), "%s/bench_fat32_%d.img", bench.dir, (int)getpid());
+
+    bench.out = output ? fopen(output, "w") : stdout;
+    if (!bench.out) {
+        fprintf(stderr, "Failed to open output\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t format_sizes[] = { 64ull << 20, 256ull << 20, 1ull << 30, 4ull << 30 };
+    uint32_t create_counts[] = { 1000, 10000, MAX_DIR_ENTRIES - 2 };
+    uint32_t size_count = bench.quick ? 2 : 4;
+    uint32_t count_count = bench.quick ? 1 : 3;
+    uint32_t reps = bench.quick ? 3 : 10;
+
+    for (uint32_t i = 0; i < size_count; i++) {
+        bench_format(&bench, format_sizes[i], FAT32_FORMAT_QUICK, reps);
+        bench_format(&bench, format_sizes[i], FAT32_FORMAT_FULL, reps);
+    }
+    for (uint32_t i = 0; i < size_count; i++) {
+        bench_mount(&bench, format_sizes[i], reps);
+    }
+    if (!bench.quick) {
+        bench_mount(&bench, 256ull << 30, reps);
+    }
+
+    for (uint32_t i = 0; i < count_count; i++) {
+        bench_create(&bench, create_counts[i], false, false);
+        bench_create(&bench, create_counts[i], false, true);
+        bench_create(&bench, create_counts[i], true, false);
+        bench_create(&bench, create_counts[i], true, true);
+    }
+
+    bench_deep_cd(&bench, bench.quick ? 1000 : 100000);
+
+    for (uint32_t i = 0; i < count_count; i++) {
+        bench_ls(&bench, create_counts[i], reps);
+    }
+
+    uint32_t chain_bytes = bench.quick ? 64u << 20 : 512u << 20;
+    bench_chain(&bench, chain_bytes, false, reps);
+    bench_chain(&bench, chain_bytes, true, reps);
+
+    uint32_t sector_counts[] = { 1, 8, 64, 256 };
+    for (uint32_t i = 0; i < 4; i++) {
+        bench_disk(&bench, sector_counts[i], true);
+        bench_disk(&bench, sector_counts[i], false);
+    }
+
+    fclose(bench.out);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file cache.h
+ * @brief Write-back buffer cache for fixed-size disk blocks
+ *
+ * This header provides a bounded cache of disk blocks (one block is a run of
+ * sectors, for example one cluster) with LRU eviction and dirty tracking.
+ * Dirty blocks are written back when they are evicted, flushed or when the
+ * cache is destroyed.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "disk.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Default memory budget for cached block data (4 MB) */
+#define CACHE_DEFAULT_BUDGET (4 * 1024 * 1024)
+/** @brief Minimum number of blocks a cache holds regardless of the budget */
+#define CACHE_MIN_BLOCKS 4
+
+/**
+ * @brief A single cached block
+ */
+typedef struct CacheBlock {
+    uint64_t sector;                /**< First sector of the block on disk */
+    uint8_t *data;                  /**< Block contents */
+    bool dirty;                     /**< Whether the block differs from disk */
+    uint32_t pins;                  /**< Number of outstanding cache_get() references */
+    struct CacheBlock *lru_prev;    /**< More recently used neighbour */
+    struct CacheBlock *lru_next;    /**< Less recently used neighbour */
+    struct CacheBlock *hash_next;   /**< Next block in the same hash bucket */
+} CacheBlock;
+
+/**
+ * @brief Buffer cache structure
+ */
+typedef struct {
+    Disk *disk;                     /**< Disk the blocks belong to */
+    uint32_t block_sectors;         /**< Number of sectors per block */
+    uint32_t block_size;            /**< Number of bytes per block */
+    uint32_t capacity;              /**< Maximum number of blocks held */
+    uint32_t count;                 /**< Number of blocks currently held */
+    CacheBlock **buckets;           /**< Hash table of blocks keyed by sector */
+    uint32_t bucket_mask;           /**< Hash table size minus one */
+    CacheBlock *lru_head;           /**< Most recently used block */
+    CacheBlock *lru_tail;           /**< Least recently used block */
+    uint64_t hits;                  /**< cache_get() calls served from memory */
+    uint64_t misses;                /**< cache_get() calls that had to take a new block */
+} BufferCache;
+
+/**
+ * @brief Initialize a buffer cache
+ *
+ * @param cache Pointer to the cache structure to initialize
+ * @param disk Disk that blocks are read from and written to
+ * @param block_sectors Number of sectors in each block
+ * @param budget_bytes Memory budget for block data
+ * @return true if initialization was successful, false otherwise
+ */
+bool cache_init(BufferCache *cache, Disk *disk, uint32_t block_sectors, size_t budget_bytes);
+
+/**
+ * @brief Get a block from the cache
+ *
+ * Returns the cached block starting at the given sector, reading it from
+ * disk on a miss. The block is pinned and will not be evicted until it is
+ * released with cache_release().
+ *
+ * @param cache Pointer to the cache structure
+ * @param sector First sector of the block
+ * @param load Whether to read the block from disk on a miss; if false the
+ *             block is zero-filled instead
+ * @return Pointer to the block data, or NULL on failure
+ */
+uint8_t *cache_get(BufferCache *cache, uint64_t sector, bool load);
+
+/**
+ * @brief Release a block obtained from cache_get()
+ *
+ * @param cache Pointer to the cache structure
+ * @param sector First sector of the block
+ * @param dirty Whether the block was modified and must be written back
+ */
+void cache_release(BufferCache *cache, uint64_t sector, bool dirty);
+
+/**
+ * @brief Write all dirty blocks to disk
+ *
+ * Blocks stay cached after they are written.
+ *
+ * @param cache Pointer to the cache structure
+ * @return true if all dirty blocks were written, false otherwise
+ */
+bool cache_flush(BufferCache *cache);
+
+/**
+ * @brief Write back the dirty blocks in a sector range
+ *
+ * Used before reading the range from disk directly. The range must start on
+ * a block boundary; blocks stay cached after they are written.
+ *
+ * @param cache Pointer to the cache structure
+ * @param sector First sector of the range
+ * @param sector_count Number of sectors in the range
+ * @return true if all dirty blocks in the range were written, false otherwise
+ */
+bool cache_write_back_range(BufferCache *cache, uint64_t sector, uint64_t sector_count);
+
+/**
+ * @brief Drop the unpinned blocks in a sector range without writing them back
+ *
+ * Used before overwriting the range on disk directly. The range must start
+ * on a block boundary.
+ *
+ * @param cache Pointer to the cache structure
+ * @param sector First sector of the range
+ * @param sector_count Number of sectors in the range
+ */
+void cache_discard_range(BufferCache *cache, uint64_t sector, uint64_t sector_count);
+
+/**
+ * @brief Drop all blocks without writing them back
+ *
+ * @param cache Pointer to the cache structure
+ */
+void cache_invalidate(BufferCache *cache);
+
+/**
+ * @brief Flush the cache and free all its memory
+ *
+ * @param cache Pointer to the cache structure
+ */
+void cache_destroy(BufferCache *cache);
+
+#endif /* CACHE_H */
@@ -18,9 +18,10 @@
  * Creates a new FAT32 filesystem on the device represented by the filesystem object.
  *
  * @param fs Pointer to the filesystem object
+ * @param options Format mode, writer threads, cluster size and alignment, or NULL for defaults
  * @return true if formatting was successful, false otherwise
  */
-bool cmd_format(FAT32_FileSystem *fs);
+bool cmd_format(FAT32_FileSystem *fs, const FAT32_FormatOptions *options);
 
 /**
  * @brief List directory contents
@@ -67,6 +68,53 @@ bool cmd_mkdir(FAT32_FileSystem *fs, const char *name);
  */
 bool cmd_touch(FAT32_FileSystem *fs, const char *name);
 
+/**
+ * @brief Reserve space for a file
+ *
+ * Creates the file if needed and reserves a contiguous cluster chain for
+ * the given size. The file size only grows when the space is zero-filled.
+ *
+ * @param fs Pointer to the filesystem object
+ * @param name Name or path of the file
+ * @param size Size to reserve, e.g. "64M" (see parse_size())
+ * @param zero Whether to fill the reserved space with zeros
+ * @return true if the space was reserved, false otherwise
+ */
+bool cmd_prealloc(FAT32_FileSystem *fs, const char *name, const char *size, bool zero);
+
+/**
+ * @brief Display free space
+ *
+ * Prints total, used and free space of the filesystem. The values come from
+ * the cached free cluster count, so no FAT scan is needed.
+ *
+ * @param fs Pointer to the filesystem object
+ * @return true if the free space was displayed, false otherwise
+ */
+bool cmd_df(FAT32_FileSystem *fs);
+
+/**
+ * @brief Flush all pending changes and make them durable
+ *
+ * Writes pending metadata and syncs the disk image.
+ *
+ * @param fs Pointer to the filesystem object
+ * @return true if the sync was successful, false otherwise
+ */
+bool cmd_sync(FAT32_FileSystem *fs);
+
+/**
+ * @brief Display or reset activity counters
+ *
+ * Prints disk I/O, FAT, allocation, directory and cache counters collected
+ * since the filesystem was opened or the counters were last reset.
+ *
+ * @param fs Pointer to the filesystem object
+ * @param reset Whether to reset the counters instead of printing them
+ * @return true if the command was successful, false otherwise
+ */
+bool cmd_stats(FAT32_FileSystem *fs, bool reset);
+
 /**
  * @brief Display help information
  *
@@ -78,10 +126,12 @@ void cmd_help();
  * @brief Process a command string
  *
  * Parses an input command string and executes the corresponding function.
- * Supports commands like format, ls, cd, mkdir, touch, and help.
+ * Supports commands like format, ls, cd, mkdir, touch, prealloc, df, sync, stats, and help.
  *
  * @param fs Pointer to the filesystem object
  * @param input The command string to process
+ * @return true if the command succeeded or the line was empty, false if it
+ *         was unknown, malformed or failed
  */
-void process_command(FAT32_FileSystem *fs, const char *input);
+bool process_command(FAT32_FileSystem *fs, const char *input);
 #endif //COMMANDS_H
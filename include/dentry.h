@@ -0,0 +1,99 @@
+/**
+ * @file dentry.h
+ * @brief Path resolution cache
+ *
+ * This header provides a bounded cache that maps normalized absolute paths
+ * to the first cluster and attributes of the entry they name. Paths are
+ * cached together with their prefixes, so resolving a deep path costs a hash
+ * lookup instead of one directory search per component. Entries are evicted
+ * in LRU order once the cache is full.
+ */
+
+#ifndef DENTRY_H
+#define DENTRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Default maximum number of cached paths */
+#define DENTRY_DEFAULT_CAPACITY 4096
+
+/**
+ * @brief A cached path
+ */
+typedef struct Dentry {
+    char *path;                 /**< Normalized absolute path */
+    uint32_t hash;              /**< Hash of the path */
+    uint32_t first_cluster;     /**< First cluster of the entry */
+    uint8_t attr;               /**< Attributes of the entry */
+    struct Dentry *lru_prev;    /**< More recently used entry */
+    struct Dentry *lru_next;    /**< Less recently used entry */
+    struct Dentry *hash_next;   /**< Next entry in the same hash bucket */
+} Dentry;
+
+/**
+ * @brief Path resolution cache structure
+ */
+typedef struct {
+    Dentry **buckets;           /**< Hash table of entries keyed by path */
+    uint32_t bucket_mask;       /**< Hash table size minus one */
+    uint32_t capacity;          /**< Maximum number of entries */
+    uint32_t count;             /**< Number of entries currently held */
+    Dentry *lru_head;           /**< Most recently used entry */
+    Dentry *lru_tail;           /**< Least recently used entry */
+} DentryCache;
+
+/**
+ * @brief Initialize an empty path cache
+ *
+ * @param cache Pointer to the cache structure to initialize
+ * @param capacity Maximum number of entries (at least 1)
+ * @return true if initialization was successful, false otherwise
+ */
+bool dentry_init(DentryCache *cache, uint32_t capacity);
+
+/**
+ * @brief Look up a path
+ *
+ * @param cache Pointer to the cache structure
+ * @param path Normalized absolute path
+ * @param first_cluster Output for the first cluster of the entry
+ * @param attr Output for the attributes of the entry
+ * @return true if the path is cached, false otherwise
+ */
+bool dentry_lookup(DentryCache *cache, const char *path, uint32_t *first_cluster, uint8_t *attr);
+
+/**
+ * @brief Add or update a path
+ *
+ * @param cache Pointer to the cache structure
+ * @param path Normalized absolute path
+ * @param first_cluster First cluster of the entry
+ * @param attr Attributes of the entry
+ * @return true if the path was stored, false otherwise
+ */
+bool dentry_insert(DentryCache *cache, const char *path, uint32_t first_cluster, uint8_t attr);
+
+/**
+ * @brief Drop a path and every cached path below it
+ *
+ * @param cache Pointer to the cache structure
+ * @param path Normalized absolute path
+ */
+void dentry_invalidate(DentryCache *cache, const char *path);
+
+/**
+ * @brief Drop all cached paths
+ *
+ * @param cache Pointer to the cache structure
+ */
+void dentry_clear(DentryCache *cache);
+
+/**
+ * @brief Drop all cached paths and free the cache
+ *
+ * @param cache Pointer to the cache structure
+ */
+void dentry_destroy(DentryCache *cache);
+
+#endif /* DENTRY_H */
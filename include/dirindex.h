@@ -0,0 +1,203 @@
+/**
+ * @file dirindex.h
+ * @brief In-memory name index for directories
+ *
+ * This header provides per-directory hash tables that map an 11-byte short
+ * name to the location of its directory entry (cluster and slot). Entries
+ * with a long filename also get a record keyed by the hash of the long name
+ * that points at the first long filename entry, so a long name is looked up
+ * by comparing hashes and only the candidates are read back and decoded.
+ * Indexes are built lazily by the filesystem layer, kept in sync as entries
+ * are created and removed, and evicted in LRU order when the memory budget
+ * is exceeded.
+ */
+
+#ifndef DIRINDEX_H
+#define DIRINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Default memory budget for all directory indexes (4 MB) */
+#define DIRINDEX_DEFAULT_BUDGET (4 * 1024 * 1024)
+/** @brief Initial number of hash slots in a new index */
+#define DIRINDEX_MIN_SLOTS 16
+
+/**
+ * @brief A single indexed directory entry
+ */
+typedef struct {
+    char name[11];              /**< Short name (8.3 format, space padded) */
+    uint8_t state;              /**< Slot state: empty, live or deleted */
+    uint8_t is_long;            /**< Whether this records a long name rather than a short name */
+    uint32_t hash;              /**< Hash of the short name, or of the long name for long records */
+    uint32_t cluster;           /**< Cluster holding the directory entry (first LFN entry for long records) */
+    uint32_t slot;              /**< Index of the entry within the cluster */
+} DirIndexEntry;
+
+/**
+ * @brief Name index of one directory
+ */
+typedef struct DirIndex {
+    uint32_t dir_cluster;       /**< First cluster of the indexed directory */
+    DirIndexEntry *slots;       /**< Open-addressing hash table */
+    uint32_t slot_mask;         /**< Hash table size minus one */
+    uint32_t live;              /**< Number of live entries */
+    uint32_t used;              /**< Number of live and deleted slots */
+    bool has_free_hint;         /**< Whether free_cluster/free_slot are valid */
+    uint32_t free_cluster;      /**< Cluster to start looking for a free entry */
+    uint32_t free_slot;         /**< Slot to start looking for a free entry */
+    struct DirIndex *lru_prev;  /**< More recently used index */
+    struct DirIndex *lru_next;  /**< Less recently used index */
+    struct DirIndex *hash_next; /**< Next index in the same hash bucket */
+} DirIndex;
+
+/**
+ * @brief Collection of directory indexes sharing one memory budget
+ */
+typedef struct {
+    DirIndex **buckets;         /**< Hash table of indexes keyed by directory cluster */
+    uint32_t bucket_mask;       /**< Hash table size minus one */
+    size_t budget;              /**< Memory budget in bytes */
+    size_t bytes;               /**< Memory currently used by indexes */
+    DirIndex *lru_head;         /**< Most recently used index */
+    DirIndex *lru_tail;         /**< Least recently used index */
+} DirIndexCache;
+
+/**
+ * @brief Initialize an empty index collection
+ *
+ * @param cache Pointer to the collection to initialize
+ * @param budget_bytes Memory budget for all indexes
+ * @return true if initialization was successful, false otherwise
+ */
+bool dirindex_init(DirIndexCache *cache, size_t budget_bytes);
+
+/**
+ * @brief Find the index of a directory
+ *
+ * Marks the index as most recently used.
+ *
+ * @param cache Pointer to the collection
+ * @param dir_cluster First cluster of the directory
+ * @return The index, or NULL if the directory is not indexed
+ */
+DirIndex *dirindex_get(DirIndexCache *cache, uint32_t dir_cluster);
+
+/**
+ * @brief Create an empty index for a directory
+ *
+ * Any existing index of the directory is replaced. Least recently used
+ * indexes are evicted to stay within the budget.
+ *
+ * @param cache Pointer to the collection
+ * @param dir_cluster First cluster of the directory
+ * @return The new index, or NULL on failure
+ */
+DirIndex *dirindex_create(DirIndexCache *cache, uint32_t dir_cluster);
+
+/**
+ * @brief Add or update an entry
+ *
+ * @param cache Pointer to the collection owning the index
+ * @param index Pointer to the index
+ * @param name 11-byte short name
+ * @param cluster Cluster holding the directory entry
+ * @param slot Index of the entry within the cluster
+ * @return true if the entry was stored, false if memory ran out
+ */
+bool dirindex_insert(DirIndexCache *cache, DirIndex *index, const char name[11],
+                     uint32_t cluster, uint32_t slot);
+
+/**
+ * @brief Look up an entry by name
+ *
+ * @param index Pointer to the index
+ * @param name 11-byte short name
+ * @param cluster Output for the cluster holding the directory entry
+ * @param slot Output for the index of the entry within the cluster
+ * @return true if the name was found, false otherwise
+ */
+bool dirindex_lookup(DirIndex *index, const char name[11], uint32_t *cluster, uint32_t *slot);
+
+/**
+ * @brief Remove an entry by name
+ *
+ * The freed location becomes the free-entry hint of the index. The long
+ * name record of the entry, if any, is removed with dirindex_remove_long().
+ *
+ * @param index Pointer to the index
+ * @param name 11-byte short name
+ */
+void dirindex_remove(DirIndex *index, const char name[11]);
+
+/**
+ * @brief Add or update the long name record of an entry
+ *
+ * @param cache Pointer to the collection owning the index
+ * @param index Pointer to the index
+ * @param hash Hash of the long name (see lfn_name_hash())
+ * @param name 11-byte short name of the entry
+ * @param cluster Cluster holding the first long filename entry
+ * @param slot Index of the first long filename entry within the cluster
+ * @return true if the record was stored, false if memory ran out
+ */
+bool dirindex_insert_long(DirIndexCache *cache, DirIndex *index, uint32_t hash, const char name[11],
+                          uint32_t cluster, uint32_t slot);
+
+/**
+ * @brief Iterate over the long name records with a given hash
+ *
+ * Different names can share a hash, so each candidate must be checked
+ * against the directory entries it points at.
+ *
+ * @param index Pointer to the index
+ * @param hash Hash of the long name
+ * @param cursor Iteration state, set to 0 before the first call
+ * @param cluster Output for the cluster holding the first long filename entry
+ * @param slot Output for the index of the first long filename entry within the cluster
+ * @return true if a candidate was returned, false when there are no more
+ */
+bool dirindex_next_long(DirIndex *index, uint32_t hash, uint32_t *cursor, uint32_t *cluster, uint32_t *slot);
+
+/**
+ * @brief Remove the long name record of an entry
+ *
+ * @param index Pointer to the index
+ * @param hash Hash of the long name
+ * @param name 11-byte short name of the entry
+ */
+void dirindex_remove_long(DirIndex *index, uint32_t hash, const char name[11]);
+
+/**
+ * @brief Drop the index of a directory, if any
+ *
+ * @param cache Pointer to the collection
+ * @param dir_cluster First cluster of the directory
+ */
+void dirindex_drop(DirIndexCache *cache, uint32_t dir_cluster);
+
+/**
+ * @brief Change the memory budget, evicting indexes as needed
+ *
+ * @param cache Pointer to the collection
+ * @param budget_bytes New memory budget
+ */
+void dirindex_set_budget(DirIndexCache *cache, size_t budget_bytes);
+
+/**
+ * @brief Drop all indexes
+ *
+ * @param cache Pointer to the collection
+ */
+void dirindex_clear(DirIndexCache *cache);
+
+/**
+ * @brief Drop all indexes and free the collection
+ *
+ * @param cache Pointer to the collection
+ */
+void dirindex_destroy(DirIndexCache *cache);
+
+#endif /* DIRINDEX_H */
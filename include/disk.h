@@ -20,22 +20,61 @@
 /** @brief Size of each disk sector in bytes */
 #define DISK_SECTOR_SIZE 512
 
+/**
+ * @brief I/O backend used to access the disk image
+ */
+typedef enum {
+    DISK_BACKEND_FILE,     /**< Positional pread/pwrite on the image file */
+    DISK_BACKEND_MMAP      /**< Image mapped into memory, flushed with msync */
+} DiskBackend;
+
+/**
+ * @brief Options controlling how a disk is opened
+ */
+typedef struct {
+    DiskBackend backend;   /**< I/O backend to use */
+    uint64_t size;         /**< Size in bytes of a newly created image, or 0 for DISK_DEFAULT_SIZE */
+} DiskOptions;
+
+/**
+ * @brief I/O counters of a disk
+ *
+ * Counts requests made through the sector read/write functions and the
+ * system calls they issue. Accesses through disk_sector_ptr() are not
+ * counted.
+ */
+typedef struct {
+    uint64_t read_ops;     /**< Calls to disk_read_sector() and disk_read_sectors() */
+    uint64_t write_ops;    /**< Calls to disk_write_sector() and disk_write_sectors() */
+    uint64_t sectors_read; /**< Sectors read */
+    uint64_t sectors_written; /**< Sectors written */
+    uint64_t seeks;        /**< Requests that did not start where the previous one ended */
+    uint64_t sectors_zeroed; /**< Sectors zeroed by the host without writing data */
+    uint64_t syncs;        /**< Calls to disk_sync() */
+    uint64_t syscalls;     /**< pread, pwrite, msync and fsync calls issued */
+} DiskStats;
+
 /**
  * @brief Disk structure representing a virtual disk
  *
  * Contains the information needed to access and manage a disk image file.
  */
 typedef struct {
-    FILE *file;            /**< File handle for the disk image */
+    int fd;                /**< File descriptor for the disk image */
     char *filename;        /**< Path to the disk image file */
-    uint32_t total_sectors; /**< Total number of sectors on the disk */
+    uint64_t total_sectors; /**< Total number of sectors on the disk */
+    DiskBackend backend;   /**< I/O backend in use */
+    uint8_t *map;          /**< Mapping of the whole image (mmap backend only) */
+    DiskStats stats;       /**< I/O counters since initialization or the last reset */
+    uint64_t next_sector;  /**< Sector following the last request, for seek counting */
 } Disk;
 
 /**
  * @brief Initialize a disk
  *
  * Opens an existing disk image file or creates a new one if it doesn't exist.
- * If creating a new disk, it will be initialized with zeros to the default size.
+ * A new disk is created as a sparse file of the default size, so it reads as
+ * zeros without taking host disk space up front.
  *
  * @param disk Pointer to the disk structure to initialize
  * @param filename Path to the disk image file
@@ -43,6 +82,20 @@ typedef struct {
  */
 bool disk_init(Disk *disk, const char *filename);
 
+/**
+ * @brief Initialize a disk with explicit options
+ *
+ * Same as disk_init(), but selects the I/O backend and the size of a newly
+ * created image. Passing NULL for options uses the file backend and the
+ * default size. The size of an existing image is never changed.
+ *
+ * @param disk Pointer to the disk structure to initialize
+ * @param filename Path to the disk image file
+ * @param options Options for opening the disk, or NULL for defaults
+ * @return true if initialization was successful, false otherwise
+ */
+bool disk_init_with_options(Disk *disk, const char *filename, const DiskOptions *options);
+
 /**
  * @brief Read a single sector from the disk
  *
@@ -53,7 +106,7 @@ bool disk_init(Disk *disk, const char *filename);
  * @param buffer Buffer to store the read data (must be at least DISK_SECTOR_SIZE bytes)
  * @return true if the read operation was successful, false otherwise
  */
-bool disk_read_sector(Disk *disk, uint32_t sector, void *buffer);
+bool disk_read_sector(Disk *disk, uint64_t sector, void *buffer);
 
 /**
  * @brief Write a single sector to the disk
@@ -65,7 +118,7 @@ bool disk_read_sector(Disk *disk, uint32_t sector, void *buffer);
  * @param buffer Buffer containing the data to write (must be at least DISK_SECTOR_SIZE bytes)
  * @return true if the write operation was successful, false otherwise
  */
-bool disk_write_sector(Disk *disk, uint32_t sector, const void *buffer);
+bool disk_write_sector(Disk *disk, uint64_t sector, const void *buffer);
 
 /**
  * @brief Read multiple contiguous sectors from the disk
@@ -78,7 +131,7 @@ bool disk_write_sector(Disk *disk, uint32_t sector, const void *buffer);
  * @param buffer Buffer to store the read data (must be at least sector_count * DISK_SECTOR_SIZE bytes)
  * @return true if the read operation was successful, false otherwise
  */
-bool disk_read_sectors(Disk *disk, uint32_t start_sector, uint32_t sector_count, void *buffer);
+bool disk_read_sectors(Disk *disk, uint64_t start_sector, uint32_t sector_count, void *buffer);
 
 /**
  * @brief Write multiple contiguous sectors to the disk
@@ -91,7 +144,61 @@ bool disk_read_sectors(Disk *disk, uint32_t start_sector, uint32_t sector_count,
  * @param buffer Buffer containing the data to write (must be at least sector_count * DISK_SECTOR_SIZE bytes)
  * @return true if the write operation was successful, false otherwise
  */
-bool disk_write_sectors(Disk *disk, uint32_t start_sector, uint32_t sector_count, const void *buffer);
+bool disk_write_sectors(Disk *disk, uint64_t start_sector, uint32_t sector_count, const void *buffer);
+
+/**
+ * @brief Write zeros to a range of sectors
+ *
+ * Writes the range with large requests. With threads greater than one the
+ * range is split into parts that are written concurrently.
+ *
+ * @param disk Pointer to the disk structure
+ * @param start_sector First sector of the range
+ * @param sector_count Number of sectors in the range
+ * @param threads Number of concurrent writers (0 or 1 writes sequentially)
+ * @return true if the range was zeroed, false otherwise
+ */
+bool disk_write_zeros(Disk *disk, uint64_t start_sector, uint64_t sector_count, uint32_t threads);
+
+/**
+ * @brief Make a range of sectors read as zeros as cheaply as possible
+ *
+ * Asks the host filesystem to zero the range without writing data by
+ * punching a hole (or FALLOC_FL_ZERO_RANGE), which leaves sparse images
+ * sparse. Falls back to disk_write_zeros() where that is not supported.
+ *
+ * @param disk Pointer to the disk structure
+ * @param start_sector First sector of the range
+ * @param sector_count Number of sectors in the range
+ * @return true if the range reads as zeros, false otherwise
+ */
+bool disk_zero_range(Disk *disk, uint64_t start_sector, uint64_t sector_count);
+
+/**
+ * @brief Get a direct pointer to a range of sectors
+ *
+ * With the mmap backend, returns a pointer into the mapping that can be read
+ * and modified in place. Changes reach the image at the next disk_sync().
+ *
+ * @param disk Pointer to the disk structure
+ * @param start_sector First sector of the range
+ * @param sector_count Number of sectors in the range
+ * @return Pointer to the first sector, or NULL if the disk is not mapped or
+ *         the range is out of bounds
+ */
+void *disk_sector_ptr(Disk *disk, uint64_t start_sector, uint32_t sector_count);
+
+/**
+ * @brief Make written data durable
+ *
+ * Sector writes go straight to the image without any flush, so this is the
+ * only durability point. Calls msync on the mapping for the mmap backend,
+ * then fsync on the image file.
+ *
+ * @param disk Pointer to the disk structure
+ * @return true if the flush was successful, false otherwise
+ */
+bool disk_sync(Disk *disk);
 
 /**
  * @brief Get the total number of sectors on the disk
@@ -99,12 +206,28 @@ bool disk_write_sectors(Disk *disk, uint32_t start_sector, uint32_t sector_count
  * @param disk Pointer to the disk structure
  * @return Number of sectors on the disk, or 0 if the disk is invalid
  */
-uint32_t disk_get_total_sectors(Disk *disk);
+uint64_t disk_get_total_sectors(Disk *disk);
+
+/**
+ * @brief Get the I/O counters of a disk
+ *
+ * @param disk Pointer to the disk structure
+ * @param stats Output for the counters
+ */
+void disk_get_stats(const Disk *disk, DiskStats *stats);
+
+/**
+ * @brief Reset the I/O counters of a disk to zero
+ *
+ * @param disk Pointer to the disk structure
+ */
+void disk_reset_stats(Disk *disk);
 
 /**
  * @brief Close a disk and free associated resources
  *
- * Closes the disk image file and frees any allocated memory.
+ * Unmaps the image if it is mapped, closes the disk image file and frees
+ * any allocated memory. Call disk_sync() first if the data must be durable.
  *
  * @param disk Pointer to the disk structure to close
  */
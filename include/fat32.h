@@ -10,6 +10,11 @@
 #define FAT32_H
 
 #include "disk.h"
+#include "cache.h"
+#include "fatcache.h"
+#include "fatmap.h"
+#include "dirindex.h"
+#include "dentry.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -29,6 +34,38 @@
 #define FAT32_CLUSTER_END       0x0FFFFFFF
 /** @brief Cluster number assigned to the root directory */
 #define FAT32_ROOTDIR_CLUSTER   2
+/** @brief FSInfo lead signature */
+#define FAT32_FSINFO_LEAD_SIG   0x41615252
+/** @brief FSInfo structure signature */
+#define FAT32_FSINFO_STRUC_SIG  0x61417272
+/** @brief FSInfo trail signature */
+#define FAT32_FSINFO_TRAIL_SIG  0xAA550000
+/** @brief FSInfo value meaning the free count or next free hint is unknown */
+#define FAT32_FSINFO_UNKNOWN    0xFFFFFFFF
+/** @brief BPB_ExtFlags bit set while only the active FAT is kept up to date */
+#define FAT32_EXTFLAGS_NO_MIRROR 0x0080
+/** @brief BPB_ExtFlags bits holding the number of the active FAT */
+#define FAT32_EXTFLAGS_ACTIVE_MASK 0x000F
+/** @brief Number of clusters summarized by one block of the free-cluster bitmap */
+#define FAT32_FREE_BLOCK_CLUSTERS 4096
+/** @brief Free count of a free-cluster bitmap block whose FAT entries have not been scanned */
+#define FAT32_FREE_BLOCK_UNKNOWN 0xFFFFFFFF
+/** @brief Maximum number of data clusters a FAT32 volume may have */
+#define FAT32_MAX_CLUSTERS      0x0FFFFFF5
+/** @brief Reserved sectors before alignment padding is added by format */
+#define FAT32_MIN_RESERVED_SECTORS 32
+/** @brief Largest data region alignment accepted by format, in bytes */
+#define FAT32_MAX_ALIGN         (16 * 1024 * 1024)
+/** @brief Volumes of at least this many sectors get 1 MiB alignment by default */
+#define FAT32_LARGE_VOLUME_SECTORS (2u * 1024 * 1024)
+/** @brief Maximum length of a long filename in UTF-16 code units */
+#define FAT32_LFN_MAX_CHARS     255
+/** @brief UTF-16 code units stored in one long filename entry */
+#define FAT32_LFN_CHARS_PER_ENTRY 13
+/** @brief Sequence number flag marking the last long filename entry of a name */
+#define FAT32_LFN_LAST_ENTRY    0x40
+/** @brief Maximum length in bytes of a filename in UTF-8, without the terminator */
+#define FAT32_NAME_MAX          (FAT32_LFN_MAX_CHARS * 3)
 
 /**
  * @defgroup FAT32_Attributes FAT32 File/Directory Attributes
@@ -50,6 +87,22 @@
 #define FAT32_ATTR_LFN          (FAT32_ATTR_READ_ONLY | FAT32_ATTR_HIDDEN | FAT32_ATTR_SYSTEM | FAT32_ATTR_VOLUME_ID)
 /** @} */
 
+/**
+ * @defgroup FAT32_OpenFlags FAT32 File Open Flags
+ * @{
+ */
+/** @brief Open for reading */
+#define FAT32_O_READ            0x01
+/** @brief Open for writing */
+#define FAT32_O_WRITE           0x02
+/** @brief Create the file if it does not exist */
+#define FAT32_O_CREATE          0x04
+/** @brief Truncate the file to zero length */
+#define FAT32_O_TRUNC           0x08
+/** @brief Write at the end of the file */
+#define FAT32_O_APPEND          0x10
+/** @} */
+
 /**
  * @brief FAT32 Boot Sector Structure
  *
@@ -90,6 +143,22 @@ typedef struct {
     uint16_t BootSignature;     /**< Boot sector signature (0xAA55) */
 } __attribute__((packed)) FAT32_BootSector;
 
+/**
+ * @brief FAT32 FSInfo Sector Structure
+ *
+ * Caches the free cluster count and a next free cluster hint so they do not
+ * have to be computed by scanning the FAT.
+ */
+typedef struct {
+    uint32_t FSI_LeadSig;       /**< Lead signature (0x41615252) */
+    uint8_t FSI_Reserved1[480]; /**< Reserved */
+    uint32_t FSI_StrucSig;      /**< Structure signature (0x61417272) */
+    uint32_t FSI_Free_Count;    /**< Free cluster count, or 0xFFFFFFFF if unknown */
+    uint32_t FSI_Nxt_Free;      /**< Hint for the next free cluster, or 0xFFFFFFFF if unknown */
+    uint8_t FSI_Reserved2[12];  /**< Reserved */
+    uint32_t FSI_TrailSig;      /**< Trail signature (0xAA550000) */
+} __attribute__((packed)) FAT32_FSInfo;
+
 /**
  * @brief FAT32 Directory Entry Structure
  *
@@ -121,11 +190,65 @@ typedef struct {
     uint8_t LDIR_Attr;          /**< Attributes (always 0x0F) */
     uint8_t LDIR_Type;          /**< Entry type (0 for LFN) */
     uint8_t LDIR_Chksum;        /**< Checksum of short name */
-    uint8_t LDIR_Name2[6];      /**< Next 6 Unicode characters */
+    uint16_t LDIR_Name2[6];     /**< Next 6 Unicode characters */
     uint16_t LDIR_FstClusL0;    /**< First cluster (always 0 for LFN) */
     uint16_t LDIR_Name3[2];     /**< Last 2 Unicode characters */
 } __attribute__((packed)) FAT32_LFNEntry;
 
+/**
+ * @brief A directory entry together with its display name
+ */
+typedef struct {
+    FAT32_DirEntry entry;       /**< Short directory entry */
+    char name[FAT32_NAME_MAX + 1]; /**< Long name in UTF-8, or the short name if the entry has none */
+} FAT32_DirInfo;
+
+/**
+ * @brief How format() clears the metadata area
+ */
+typedef enum {
+    FAT32_FORMAT_QUICK,         /**< Write only non-zero metadata; have the host zero the rest */
+    FAT32_FORMAT_FULL           /**< Write zeros over the reserved area and every FAT copy */
+} FAT32_FormatMode;
+
+/**
+ * @brief Options for fat32_format_ex()
+ */
+typedef struct {
+    FAT32_FormatMode mode;      /**< Quick or full format */
+    uint32_t threads;           /**< Concurrent writers for zeroing in full mode (0 or 1 for one) */
+    uint32_t cluster_size;      /**< Cluster size in bytes (512 to 65536, power of two), or 0 to pick from the volume size */
+    uint32_t align;             /**< Host boundary in bytes for the data region (512 to 16 MiB, power of two), or 0 for the default */
+} FAT32_FormatOptions;
+
+/**
+ * @brief Filesystem activity counters
+ *
+ * Counters start at zero when the filesystem is initialized and can be reset
+ * with fat32_reset_stats().
+ */
+typedef struct {
+    DiskStats disk;                 /**< I/O counters of the underlying disk */
+    uint64_t syncs;                 /**< Calls to fat32_sync() */
+    uint64_t fat_flushes;           /**< FAT flushes that wrote at least one sector */
+    uint64_t fat_mirror_syncs;      /**< Deferred mirror updates that copied at least one sector */
+    uint64_t fat_mirror_sectors;    /**< FAT sectors copied to mirrors in bulk */
+    uint64_t fat_sectors_written;   /**< FAT sectors written, counting every FAT copy */
+    uint64_t clusters_allocated;    /**< Clusters taken from the free pool */
+    uint64_t clusters_freed;        /**< Clusters returned to the free pool */
+    uint64_t dir_clusters_scanned;  /**< Directory clusters read while searching or listing */
+    uint64_t lookups;               /**< Name lookups in a directory */
+    uint64_t path_resolutions;      /**< Paths resolved to a directory entry */
+    uint64_t cache_hits;            /**< Cluster cache hits */
+    uint64_t cache_misses;          /**< Cluster cache misses */
+    uint64_t fat_page_hits;         /**< FAT entry accesses served by a cached FAT page */
+    uint64_t fat_page_misses;       /**< FAT entry accesses that had to read a FAT page */
+    uint64_t dir_index_hits;        /**< Lookups served by an existing directory index */
+    uint64_t dir_index_misses;      /**< Lookups that had to build a directory index */
+    uint64_t dentry_hits;           /**< Path resolutions served entirely by the path cache */
+    uint64_t dentry_misses;         /**< Path resolutions that searched at least one directory */
+} FAT32_Stats;
+
 /**
  * @brief FAT32 Filesystem Structure
  *
@@ -134,7 +257,24 @@ typedef struct {
 typedef struct {
     Disk disk;                  /**< Underlying disk interface */
     FAT32_BootSector bootSector; /**< Boot sector data */
-    uint32_t *fat;              /**< File Allocation Table */
+    FatCache fat_cache;         /**< Pages of the File Allocation Table loaded on demand */
+    size_t fat_cache_budget;    /**< Memory budget for the FAT page cache in bytes */
+    FatMap fat_map;             /**< Run-length FAT used instead of the page cache when loaded */
+    bool fat_extents;           /**< Whether to load the FAT as runs at mount and format */
+    uint64_t *free_map;         /**< Bitmap of free clusters, one bit per FAT entry */
+    uint32_t *free_block_count; /**< Free clusters in each FAT32_FREE_BLOCK_CLUSTERS block,
+                                     or FAT32_FREE_BLOCK_UNKNOWN until the block is scanned */
+    uint32_t free_block_total;  /**< Number of blocks in the free-cluster bitmap */
+    uint32_t free_count;        /**< Number of free data clusters */
+    uint32_t next_free;         /**< Next-fit allocation cursor */
+    bool fsinfo_dirty;          /**< Whether the FSInfo sector needs to be rewritten */
+    bool defer_sync;            /**< Whether modifying operations leave flushing to the caller */
+    bool defer_mirrors;         /**< Whether FAT mirrors are only updated by fat32_sync() and unmount */
+    BufferCache cache;          /**< Cluster cache (unused with the mmap backend) */
+    size_t cache_budget;        /**< Memory budget for the cluster cache in bytes */
+    DirIndexCache dir_index;    /**< Name indexes of recently used directories */
+    DentryCache dentries;       /**< Resolved absolute paths */
+    FAT32_Stats stats;          /**< Activity counters (see fat32_get_stats()) */
     uint32_t fat_size;          /**< Size of FAT in sectors */
     uint32_t sectors_per_cluster; /**< Number of sectors per cluster */
     uint32_t first_data_sector; /**< First sector of the data region */
@@ -145,6 +285,43 @@ typedef struct {
     bool is_formatted;          /**< Whether the filesystem is formatted */
 } FAT32_FileSystem;
 
+/**
+ * @brief Run of physically contiguous clusters in a file
+ */
+typedef struct {
+    uint32_t logical;           /**< Index of the first cluster within the file */
+    uint32_t physical;          /**< First cluster number on disk */
+    uint32_t length;            /**< Number of clusters in the run */
+} FAT32_Extent;
+
+/**
+ * @brief Open file handle
+ *
+ * Partial-cluster reads and writes go through a one-cluster buffer owned by
+ * the handle. The cluster chain is mapped by a sorted extent list that is
+ * built on first access, so any offset is found by binary search. The
+ * directory entry is updated when the handle is closed.
+ */
+typedef struct {
+    FAT32_FileSystem *fs;       /**< Filesystem the file belongs to */
+    uint32_t flags;             /**< FAT32_O_* flags the file was opened with */
+    char path[256];             /**< Absolute path of the file */
+    uint32_t entry_cluster;     /**< Cluster holding the directory entry */
+    uint32_t entry_index;       /**< Index of the directory entry within its cluster */
+    uint32_t first_cluster;     /**< First cluster of the file, 0 if empty */
+    uint32_t size;              /**< File size in bytes */
+    uint32_t position;          /**< Current read/write position */
+    FAT32_Extent *extents;      /**< Extents of the cluster chain, sorted by logical index */
+    uint32_t extent_count;      /**< Number of extents */
+    uint32_t extent_capacity;   /**< Allocated size of the extent array */
+    uint32_t cluster_count;     /**< Number of clusters in the chain */
+    bool extents_loaded;        /**< Whether the extent list has been built */
+    uint8_t *buffer;            /**< One-cluster buffer for partial I/O */
+    uint32_t buffer_cluster;    /**< Cluster held in the buffer, 0 if none */
+    bool buffer_dirty;          /**< Whether the buffer must be written back */
+    bool modified;              /**< Whether the directory entry needs updating */
+} FAT32_File;
+
 /**
  * @brief Initialize a FAT32 filesystem
  *
@@ -157,16 +334,106 @@ typedef struct {
  */
 bool fat32_init(FAT32_FileSystem *fs, const char *filename);
 
+/**
+ * @brief Initialize a FAT32 filesystem with explicit disk options
+ *
+ * Same as fat32_init(), but passes the options through to the disk layer,
+ * for example to select the mmap backend.
+ *
+ * @param fs Pointer to the filesystem structure to initialize
+ * @param filename Path to the disk image file
+ * @param options Options for opening the disk, or NULL for defaults
+ * @return true if initialization was successful, false otherwise
+ */
+bool fat32_init_with_options(FAT32_FileSystem *fs, const char *filename, const DiskOptions *options);
+
+/**
+ * @brief Set the memory budget of the cluster cache
+ *
+ * Dirty clusters are written back before the cache is resized. The budget
+ * is kept for later mounts and formats. The mmap backend does not use the
+ * cache.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param budget_bytes Memory budget in bytes
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_set_cache_budget(FAT32_FileSystem *fs, size_t budget_bytes);
+
+/**
+ * @brief Set the memory budget of the FAT page cache
+ *
+ * Pages beyond the new budget are evicted, writing back modified ones. The
+ * budget is kept for later mounts and formats.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param budget_bytes Memory budget in bytes
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_set_fat_cache_budget(FAT32_FileSystem *fs, size_t budget_bytes);
+
+/**
+ * @brief Keep the FAT in memory as runs of clusters
+ *
+ * When enabled, the whole FAT is read once and held as a run-length map
+ * (see fatmap.h) instead of being paged in on demand. Chain walks and free
+ * space searches then cost O(runs) rather than O(clusters), and modified
+ * entries are written back in FAT format on every flush. The setting is
+ * kept for later mounts and formats.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param enable Whether to use the run-length map
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_set_fat_extents(FAT32_FileSystem *fs, bool enable);
+
+/**
+ * @brief Set the memory budget of the directory name indexes
+ *
+ * Least recently used indexes are dropped to fit the new budget. A directory
+ * whose index does not fit is searched by scanning its entries instead.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param budget_bytes Memory budget in bytes
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_set_dir_index_budget(FAT32_FileSystem *fs, size_t budget_bytes);
+
 /**
  * @brief Format a disk as FAT32
  *
- * Creates a new FAT32 filesystem on the disk.
+ * Creates a new FAT32 filesystem on the disk with a quick format (see
+ * fat32_format_ex()).
  *
  * @param fs Pointer to the filesystem structure
  * @return true if formatting was successful, false otherwise
  */
 bool fat32_format(FAT32_FileSystem *fs);
 
+/**
+ * @brief Format a disk as FAT32 with explicit options
+ *
+ * Without an explicit cluster size, the cluster size is picked from the
+ * volume size as mkfs.fat does: 512 bytes up to 260 MiB, 4 KiB up to 8 GiB,
+ * 8 KiB up to 16 GiB, 16 KiB up to 32 GiB and 32 KiB above, doubled if
+ * needed to stay within the FAT32 cluster limit. The reserved area is padded
+ * so the data region starts on the alignment boundary (1 MiB on volumes of
+ * 1 GiB or more, 4 KiB otherwise); clusters then start on a host boundary
+ * whenever the cluster size is a multiple of the alignment or vice versa.
+ *
+ * Both modes write the boot sector and its backup, the FSInfo sector and
+ * its backup, the first sector of each FAT and the root directory cluster.
+ * A quick format has the host zero the rest of the reserved area and the
+ * FATs (see disk_zero_range()), so its cost depends on the metadata written
+ * rather than the volume size and sparse images stay sparse. A full format
+ * writes zeros over that area instead, optionally with several threads.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param options Format options, or NULL for a quick format
+ * @return true if formatting was successful, false otherwise
+ */
+bool fat32_format_ex(FAT32_FileSystem *fs, const FAT32_FormatOptions *options);
+
 /**
  * @brief Check if a filesystem is a valid FAT32 filesystem
  *
@@ -193,6 +460,24 @@ bool fat32_list_directory(FAT32_FileSystem *fs, const char *path,
                           FAT32_DirEntry *entries,
                           uint32_t max_entries, uint32_t *count);
 
+/**
+ * @brief List the contents of a directory with long filenames
+ *
+ * Same as fat32_list_directory(), but also returns the name of each entry:
+ * its long filename in UTF-8 when it has a valid one, otherwise its short
+ * name. Long filename entries whose checksum does not match the short entry
+ * that follows them are ignored.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param path Path to the directory to list, or NULL for current directory
+ * @param infos Array to store the entries and names
+ * @param max_entries Maximum number of entries to retrieve
+ * @param count Pointer to store the number of entries retrieved
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_read_directory(FAT32_FileSystem *fs, const char *path, FAT32_DirInfo *infos,
+                          uint32_t max_entries, uint32_t *count);
+
 /**
  * @brief Change the current directory
  *
@@ -207,7 +492,9 @@ bool fat32_change_directory(FAT32_FileSystem *fs, const char *path);
 /**
  * @brief Create a new directory
  *
- * Creates a new directory in the current directory.
+ * Creates a new directory in the current directory. Names that are not
+ * exact 8.3 names (see short_name_from_name()) are stored as long filenames
+ * with a generated "~N" short name.
  *
  * @param fs Pointer to the filesystem structure
  * @param name Name of the directory to create
@@ -218,7 +505,8 @@ bool fat32_create_directory(FAT32_FileSystem *fs, const char *name);
 /**
  * @brief Create a new empty file
  *
- * Creates a new empty file in the current directory.
+ * Creates a new empty file in the current directory. Long names are
+ * handled as in fat32_create_directory().
  *
  * @param fs Pointer to the filesystem structure
  * @param name Name of the file to create
@@ -226,10 +514,111 @@ bool fat32_create_directory(FAT32_FileSystem *fs, const char *name);
  */
 bool fat32_create_file(FAT32_FileSystem *fs, const char *name);
 
+/**
+ * @brief Open a file
+ *
+ * Relative paths are resolved against the current directory. Runs of
+ * physically contiguous clusters are read and written with one disk call.
+ * A file must not be opened through more than one writable handle at once.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param path Path of the file
+ * @param flags Combination of FAT32_O_* flags; FAT32_O_READ or FAT32_O_WRITE is required
+ * @param file Handle to initialize
+ * @return true if the file was opened, false otherwise
+ */
+bool fat32_open(FAT32_FileSystem *fs, const char *path, uint32_t flags, FAT32_File *file);
+
+/**
+ * @brief Read from the current position of a file
+ *
+ * @param file Open file handle
+ * @param buffer Buffer to read into
+ * @param length Number of bytes to read
+ * @param bytes_read Output for the number of bytes read (fewer at end of file), may be NULL
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_read(FAT32_File *file, void *buffer, uint32_t length, uint32_t *bytes_read);
+
+/**
+ * @brief Write at the current position of a file
+ *
+ * Clusters are allocated as the file grows. The new size is recorded in the
+ * directory entry by fat32_close_file().
+ *
+ * @param file Open file handle
+ * @param buffer Data to write
+ * @param length Number of bytes to write
+ * @param bytes_written Output for the number of bytes written, may be NULL
+ * @return true if all bytes were written, false otherwise (for example when the disk is full)
+ */
+bool fat32_write(FAT32_File *file, const void *buffer, uint32_t length, uint32_t *bytes_written);
+
+/**
+ * @brief Read from a file at an offset
+ *
+ * Does not move the position used by fat32_read() and fat32_write().
+ *
+ * @param file Open file handle
+ * @param buffer Buffer to read into
+ * @param length Number of bytes to read
+ * @param offset Offset in the file to read from
+ * @param bytes_read Output for the number of bytes read (fewer at end of file), may be NULL
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_pread(FAT32_File *file, void *buffer, uint32_t length, uint32_t offset, uint32_t *bytes_read);
+
+/**
+ * @brief Write to a file at an offset
+ *
+ * Does not move the position used by fat32_read() and fat32_write(). Writing
+ * past the end of the file fills the gap with zeros.
+ *
+ * @param file Open file handle
+ * @param buffer Data to write
+ * @param length Number of bytes to write
+ * @param offset Offset in the file to write at
+ * @param bytes_written Output for the number of bytes written, may be NULL
+ * @return true if all bytes were written, false otherwise
+ */
+bool fat32_pwrite(FAT32_File *file, const void *buffer, uint32_t length, uint32_t offset,
+                  uint32_t *bytes_written);
+
+/**
+ * @brief Reserve clusters for a file up front
+ *
+ * Creates the file if needed and extends its cluster chain to cover bytes,
+ * allocating the missing clusters as one contiguous run where possible, so
+ * later writes up to that size never call the allocator. With zero set the
+ * new range is filled with zeros and the file size is raised to bytes.
+ * Otherwise the file size is left unchanged, so the stale contents of the
+ * reserved clusters can never be read; writes past the end of the file
+ * still zero any gap they leave.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param path Path of the file
+ * @param bytes Size to reserve in bytes
+ * @param zero Whether to fill the newly reserved range with zeros
+ * @return true if the space was reserved, false otherwise
+ */
+bool fat32_preallocate(FAT32_FileSystem *fs, const char *path, uint32_t bytes, bool zero);
+
+/**
+ * @brief Close a file
+ *
+ * Writes back buffered data and, if the file was modified, updates its size,
+ * first cluster and write timestamp and syncs the filesystem metadata.
+ *
+ * @param file Open file handle
+ * @return true if everything was written, false otherwise
+ */
+bool fat32_close_file(FAT32_File *file);
+
 /**
  * @brief Close a FAT32 filesystem
  *
- * Frees all allocated resources and closes the disk.
+ * Flushes pending changes, syncs the disk so they are durable, frees all
+ * allocated resources and closes the disk.
  *
  * @param fs Pointer to the filesystem structure
  */
@@ -256,9 +645,48 @@ bool fat32_read_boot_sector(FAT32_FileSystem *fs);
 bool fat32_write_boot_sector(FAT32_FileSystem *fs);
 
 /**
- * @brief Read the FAT from disk
+ * @brief Read the FSInfo sector from disk
+ *
+ * Loads the free cluster count and next free hint from the FSInfo sector.
+ * The values are only used if the signatures are valid and the free count
+ * is within the volume; otherwise the caller must count free clusters.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @return true if a valid FSInfo sector was loaded, false otherwise
+ */
+bool fat32_read_fsinfo(FAT32_FileSystem *fs);
+
+/**
+ * @brief Write the FSInfo sector to disk
+ *
+ * Stores the current free cluster count and next free hint in the FSInfo sector.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_write_fsinfo(FAT32_FileSystem *fs);
+
+/**
+ * @brief Get free space information
  *
- * Loads the File Allocation Table from the disk into memory.
+ * Returns the cached free cluster count without scanning the FAT.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param free_clusters Pointer to store the number of free clusters
+ * @param total_clusters Pointer to store the number of data clusters
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_get_free_space(FAT32_FileSystem *fs, uint32_t *free_clusters, uint32_t *total_clusters);
+
+/**
+ * @brief Set up access to the FAT on disk
+ *
+ * Prepares the FAT page cache and drops any cached pages without writing
+ * them back. No FAT sectors are read until entries are accessed, so the
+ * cost of mounting does not depend on the size of the FAT. With
+ * fat32_set_fat_extents() enabled the whole FAT is read into a run-length
+ * map instead. If the boot sector shows that the mirrors were left out of
+ * date, the active FAT is first copied over them.
  *
  * @param fs Pointer to the filesystem structure
  * @return true if the operation was successful, false otherwise
@@ -268,38 +696,144 @@ bool fat32_read_fat(FAT32_FileSystem *fs);
 /**
  * @brief Write the FAT to disk
  *
- * Writes the File Allocation Table from memory to the disk.
+ * Writes every modified FAT page to the primary FAT and every mirror copy.
+ * Pages that were never loaded already match the disk, so this is the same
+ * as fat32_flush_fat().
  *
  * @param fs Pointer to the filesystem structure
  * @return true if the operation was successful, false otherwise
  */
 bool fat32_write_fat(FAT32_FileSystem *fs);
 
+/**
+ * @brief Write modified FAT sectors to disk
+ *
+ * Writes only the FAT sectors modified since they were last written, to
+ * the primary FAT and every mirror copy (only the primary while mirror
+ * updates are deferred). Modified pages may also be written earlier, when
+ * they are evicted from the FAT page cache.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_flush_fat(FAT32_FileSystem *fs);
+
+/**
+ * @brief Flush all pending filesystem changes to disk
+ *
+ * This is the flush point for deferred metadata writes: dirty cached
+ * clusters, dirty FAT sectors and the FSInfo sector. It is called at the
+ * end of every modifying operation (unless deferred with
+ * fat32_set_deferred_sync()) and when the filesystem is closed. It hands the
+ * data to the disk layer; use disk_sync() to make it durable. Deferred FAT
+ * mirror updates are only carried out by explicit calls and at close, not
+ * by the flush at the end of each operation.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_sync(FAT32_FileSystem *fs);
+
+/**
+ * @brief Enable or disable deferred FAT mirror updates
+ *
+ * While enabled, FAT writes go to the primary FAT only and the mirror
+ * copies are brought up to date in one bulk copy by fat32_sync() and at
+ * close. The boot sector is marked with FAT32_EXTFLAGS_NO_MIRROR (FAT 0
+ * active) for as long as the mirrors may be behind, so the mount after a
+ * crash copies FAT 0 over the mirrors. The setting is kept for later
+ * mounts and formats.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param defer Whether to defer mirror updates
+ * @return true if the operation was successful, false otherwise
+ */
+bool fat32_set_deferred_mirrors(FAT32_FileSystem *fs, bool defer);
+
+/**
+ * @brief Enable or disable deferred syncing
+ *
+ * While enabled, modifying operations keep their changes in memory and the
+ * caller decides when to call fat32_sync(), so a batch of operations costs a
+ * single flush. Dirty clusters may still be written early when the cache
+ * evicts them. Disabling deferred syncing flushes pending changes.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param defer Whether to defer syncing
+ * @return true if the operation was successful, false if the flush failed
+ */
+bool fat32_set_deferred_sync(FAT32_FileSystem *fs, bool defer);
+
+/**
+ * @brief Get the activity counters of the filesystem
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param stats Output for the counters, including those of the disk and
+ *              the cluster cache
+ */
+void fat32_get_stats(FAT32_FileSystem *fs, FAT32_Stats *stats);
+
+/**
+ * @brief Reset all activity counters to zero
+ *
+ * Also resets the counters of the disk and the cluster cache.
+ *
+ * @param fs Pointer to the filesystem structure
+ */
+void fat32_reset_stats(FAT32_FileSystem *fs);
+
 /**
  * @brief Get the next cluster in a cluster chain
  *
- * Retrieves the next cluster number from the FAT for a given cluster.
+ * Retrieves the next cluster number from the FAT for a given cluster,
+ * loading its FAT page if it is not cached.
  *
  * @param fs Pointer to the filesystem structure
  * @param cluster Current cluster number
- * @return Next cluster number, or FAT32_CLUSTER_END if end of chain
+ * @return Next cluster number, or FAT32_CLUSTER_END if end of chain or the
+ *         FAT page could not be read
  */
 uint32_t fat32_get_next_cluster(FAT32_FileSystem *fs, uint32_t cluster);
 
 /**
  * @brief Allocate a new cluster
  *
- * Finds a free cluster in the FAT and marks it as the end of a chain.
+ * Takes the next free cluster at or after the next-fit cursor from the
+ * free-cluster index and marks it as the end of a chain. The change is kept
+ * in memory until the next fat32_sync(). Blocks of the free-cluster index
+ * are filled in by scanning their FAT pages the first time the allocator
+ * reaches them.
  *
  * @param fs Pointer to the filesystem structure
  * @return The allocated cluster number, or 0 if allocation failed
  */
 uint32_t fat32_allocate_cluster(FAT32_FileSystem *fs);
 
+/**
+ * @brief Allocate several clusters as one chain
+ *
+ * Looks for a free run of at least count clusters starting at the next-fit
+ * cursor. Otherwise the free runs met on the way are gathered until they
+ * cover count, and the longest of them are combined, linked in disk order.
+ * All chain links are written to the in-memory FAT in one pass and kept
+ * there until the next fat32_sync(). If any link, including the one from
+ * link_from, cannot be written, the clusters taken so far are released.
+ *
+ * @param fs Pointer to the filesystem structure
+ * @param count Number of clusters to allocate
+ * @param link_from Last cluster of an existing chain to append to, or 0 for a new chain
+ * @param first_cluster Output for the first allocated cluster
+ * @return true if all clusters were allocated, false otherwise (nothing is allocated then)
+ */
+bool fat32_allocate_clusters(FAT32_FileSystem *fs, uint32_t count, uint32_t link_from,
+                             uint32_t *first_cluster);
+
 /**
  * @brief Set a value in the FAT for a given cluster
  *
- * Updates the FAT entry for a cluster with a new value.
+ * Updates the FAT entry for a cluster with a new value and marks the
+ * containing FAT sector dirty. The change is kept in the FAT page cache
+ * until the next fat32_sync() or until the page is evicted.
  *
  * @param fs Pointer to the filesystem structure
  * @param cluster Cluster number to update
@@ -311,7 +845,7 @@ bool fat32_set_cluster_value(FAT32_FileSystem *fs, uint32_t cluster, uint32_t va
 /**
  * @brief Read a cluster from disk
  *
- * Reads the contents of a cluster from the disk into a buffer.
+ * Reads the contents of a cluster into a buffer, through the cluster cache.
  *
  * @param fs Pointer to the filesystem structure
  * @param cluster Cluster number to read
@@ -323,7 +857,8 @@ bool fat32_read_cluster(FAT32_FileSystem *fs, uint32_t cluster, void *buffer);
 /**
  * @brief Write a cluster to disk
  *
- * Writes data from a buffer to a cluster on the disk.
+ * Writes data from a buffer to a cluster through the cluster cache. The
+ * cluster reaches the disk when it is evicted or at the next fat32_sync().
  *
  * @param fs Pointer to the filesystem structure
  * @param cluster Cluster number to write
@@ -339,8 +874,8 @@ bool fat32_write_cluster(FAT32_FileSystem *fs, uint32_t cluster, const void *buf
  *
  * @param fs Pointer to the filesystem structure
  * @param cluster Cluster number
- * @return First sector number of the cluster
+ * @return First sector number of the cluster (64-bit, so it can address past 4 GiB)
  */
-uint32_t fat32_sector_for_cluster(FAT32_FileSystem *fs, uint32_t cluster);
+uint64_t fat32_sector_for_cluster(FAT32_FileSystem *fs, uint32_t cluster);
 
 #endif //FAT32_H
@@ -0,0 +1,199 @@
+/**
+ * @file fatcache.h
+ * @brief Paged cache of File Allocation Table entries
+ *
+ * This header provides a bounded cache of FAT pages, so only the parts of
+ * the FAT that are actually used are held in memory. A page covers a fixed
+ * number of FAT sectors and is read from the primary FAT on first access.
+ * Modified sectors are tracked per page and written to every FAT copy when
+ * the cache is flushed or the page is evicted. Clean pages are evicted in
+ * LRU order before dirty ones. Updates to the mirror copies can be deferred,
+ * in which case only the primary FAT is written and the range of sectors
+ * the mirrors are missing is copied over in bulk later.
+ */
+
+#ifndef FATCACHE_H
+#define FATCACHE_H
+
+#include "disk.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Number of FAT sectors in one page */
+#define FATCACHE_PAGE_SECTORS 8
+/** @brief Number of FAT entries in one page */
+#define FATCACHE_PAGE_ENTRIES (FATCACHE_PAGE_SECTORS * DISK_SECTOR_SIZE / sizeof(uint32_t))
+/** @brief Number of bytes in one page */
+#define FATCACHE_PAGE_SIZE (FATCACHE_PAGE_SECTORS * DISK_SECTOR_SIZE)
+/** @brief Default memory budget for cached pages (1 MB) */
+#define FATCACHE_DEFAULT_BUDGET (1024 * 1024)
+/** @brief Minimum number of pages a cache holds regardless of the budget */
+#define FATCACHE_MIN_PAGES 4
+
+/**
+ * @brief A single cached FAT page
+ */
+typedef struct FatPage {
+    uint32_t index;                 /**< Page number within the FAT */
+    uint32_t *entries;              /**< FATCACHE_PAGE_ENTRIES FAT entries */
+    uint8_t dirty;                  /**< Bitmask of sectors modified since the last write */
+    struct FatPage *lru_prev;       /**< More recently used neighbour */
+    struct FatPage *lru_next;       /**< Less recently used neighbour */
+    struct FatPage *hash_next;      /**< Next page in the same hash bucket */
+} FatPage;
+
+/**
+ * @brief FAT page cache structure
+ */
+typedef struct {
+    Disk *disk;                     /**< Disk the FAT lives on */
+    uint32_t fat_start;             /**< First sector of the primary FAT */
+    uint32_t fat_sectors;           /**< Size of one FAT copy in sectors */
+    uint8_t fat_copies;             /**< Number of FAT copies written back */
+    uint32_t capacity;              /**< Maximum number of pages held */
+    uint32_t count;                 /**< Number of pages currently held */
+    FatPage **buckets;              /**< Hash table of pages keyed by page number */
+    uint32_t bucket_mask;           /**< Hash table size minus one */
+    FatPage *lru_head;              /**< Most recently used page */
+    FatPage *lru_tail;              /**< Least recently used page */
+    uint32_t dirty_pages;           /**< Number of pages with unwritten changes */
+    uint64_t hits;                  /**< Accesses served from memory */
+    uint64_t misses;                /**< Accesses that had to read a page */
+    uint64_t sectors_written;       /**< FAT sectors written, counting every FAT copy */
+    bool defer_mirrors;             /**< Whether writes go to the primary FAT only */
+    uint32_t stale_first;           /**< First primary FAT sector not yet copied to the mirrors */
+    uint32_t stale_end;             /**< One past the last such sector, or 0 if the mirrors are current */
+    uint64_t mirror_syncs;          /**< Mirror updates that copied at least one sector */
+    uint64_t mirror_sectors;        /**< Sectors copied from one FAT copy to another */
+} FatCache;
+
+/**
+ * @brief Initialize a FAT page cache
+ *
+ * No pages are read until they are accessed.
+ *
+ * @param cache Pointer to the cache structure to initialize
+ * @param disk Disk the FAT is read from and written to
+ * @param fat_start First sector of the primary FAT
+ * @param fat_sectors Size of one FAT copy in sectors
+ * @param fat_copies Number of FAT copies, stored back to back
+ * @param budget_bytes Memory budget for page data
+ * @return true if initialization was successful, false otherwise
+ */
+bool fatcache_init(FatCache *cache, Disk *disk, uint32_t fat_start, uint32_t fat_sectors,
+                   uint8_t fat_copies, size_t budget_bytes);
+
+/**
+ * @brief Read a FAT entry
+ *
+ * @param cache Pointer to the cache structure
+ * @param cluster Cluster whose entry to read
+ * @param value Output for the raw 32-bit entry
+ * @return true if the entry was read, false if it is outside the FAT or
+ *         its page could not be loaded
+ */
+bool fatcache_get(FatCache *cache, uint32_t cluster, uint32_t *value);
+
+/**
+ * @brief Write a FAT entry
+ *
+ * The change stays in memory until the page is flushed or evicted.
+ *
+ * @param cache Pointer to the cache structure
+ * @param cluster Cluster whose entry to write
+ * @param value Raw 32-bit entry
+ * @return true if the entry was written, false if it is outside the FAT or
+ *         its page could not be loaded
+ */
+bool fatcache_set(FatCache *cache, uint32_t cluster, uint32_t value);
+
+/**
+ * @brief Write all modified sectors to every FAT copy
+ *
+ * Pages stay cached after they are written.
+ *
+ * @param cache Pointer to the cache structure
+ * @return true if all modified sectors were written, false otherwise
+ */
+bool fatcache_flush(FatCache *cache);
+
+/**
+ * @brief Write whole FAT sectors
+ *
+ * The sectors are written to the primary FAT and, unless mirror updates
+ * are deferred, to every mirror copy. Used for write-back and by callers
+ * that keep FAT entries elsewhere.
+ *
+ * @param cache Pointer to the cache structure
+ * @param sector First sector within one FAT copy
+ * @param count Number of sectors
+ * @param data Sector data
+ * @return true if the sectors were written, false otherwise
+ */
+bool fatcache_write(FatCache *cache, uint32_t sector, uint32_t count, const void *data);
+
+/**
+ * @brief Copy a range of sectors from one FAT copy to all others
+ *
+ * Modified pages that were not written yet are not included.
+ *
+ * @param cache Pointer to the cache structure
+ * @param source Number of the FAT copy to copy from
+ * @param sector First sector within one FAT copy
+ * @param count Number of sectors
+ * @return true if the sectors were copied, false otherwise
+ */
+bool fatcache_copy(FatCache *cache, uint8_t source, uint32_t sector, uint32_t count);
+
+/**
+ * @brief Choose whether writes update the mirror copies
+ *
+ * When mirror updates are turned back on, the mirrors are brought up to
+ * date first.
+ *
+ * @param cache Pointer to the cache structure
+ * @param defer Whether to write the primary FAT only
+ * @return true if the operation was successful, false otherwise
+ */
+bool fatcache_set_defer_mirrors(FatCache *cache, bool defer);
+
+/**
+ * @brief Copy the sectors the mirrors are missing from the primary FAT
+ *
+ * The sectors are copied in bulk, covering everything written to the
+ * primary FAT only since the last mirror update.
+ *
+ * @param cache Pointer to the cache structure
+ * @return true if the mirrors are up to date, false otherwise
+ */
+bool fatcache_sync_mirrors(FatCache *cache);
+
+/**
+ * @brief Drop all pages without writing them back
+ *
+ * Used after the FAT was rewritten on disk directly.
+ *
+ * @param cache Pointer to the cache structure
+ */
+void fatcache_invalidate(FatCache *cache);
+
+/**
+ * @brief Change the memory budget
+ *
+ * Pages beyond the new capacity are evicted, writing back dirty ones.
+ *
+ * @param cache Pointer to the cache structure
+ * @param budget_bytes Memory budget for page data
+ * @return true if the cache fits the new budget, false if a write failed
+ */
+bool fatcache_set_budget(FatCache *cache, size_t budget_bytes);
+
+/**
+ * @brief Flush the cache and free all its memory
+ *
+ * @param cache Pointer to the cache structure
+ */
+void fatcache_destroy(FatCache *cache);
+
+#endif /* FATCACHE_H */
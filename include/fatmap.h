@@ -0,0 +1,183 @@
+/**
+ * @file fatmap.h
+ * @brief Run-length representation of the File Allocation Table
+ *
+ * This header provides an in-memory FAT that stores runs of clusters
+ * instead of one entry per cluster. A chain run covers clusters that each
+ * link to the following cluster, with the last one linking to an arbitrary
+ * value; a fill run covers clusters that all hold the same value, such as a
+ * stretch of free clusters. On a volume whose files are laid out
+ * contiguously the map holds a few runs per file, so walking a chain and
+ * finding free space cost O(runs) rather than O(clusters). Modified FAT
+ * sectors are tracked so they can be written back in on-disk format.
+ */
+
+#ifndef FATMAP_H
+#define FATMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Run whose clusters each link to the next one, the last linking to next */
+#define FATMAP_CHAIN 0
+/** @brief Run whose clusters all hold the value next */
+#define FATMAP_FILL 1
+
+/**
+ * @brief A run of FAT entries
+ */
+typedef struct {
+    uint32_t start;             /**< First cluster of the run */
+    uint32_t length;            /**< Number of clusters in the run */
+    uint32_t next;              /**< Value of the last entry (chain) or of every entry (fill) */
+    uint8_t kind;               /**< FATMAP_CHAIN or FATMAP_FILL */
+} FatRun;
+
+/**
+ * @brief Run-length FAT structure
+ *
+ * The runs are sorted by start cluster and cover the clusters from
+ * first to limit without gaps. Adjacent runs that could be one run are
+ * always merged.
+ */
+typedef struct {
+    FatRun *runs;               /**< Runs sorted by start cluster */
+    uint32_t count;             /**< Number of runs */
+    uint32_t capacity;          /**< Allocated size of the run array */
+    uint32_t first;             /**< First cluster covered */
+    uint32_t limit;             /**< One past the last cluster covered so far */
+    uint32_t head[2];           /**< Raw values of the reserved entries 0 and 1 */
+    uint8_t *dirty;             /**< Bitmap of FAT sectors modified since the last write */
+    uint32_t sectors;           /**< Number of sectors in one FAT copy */
+} FatMap;
+
+/**
+ * @brief Initialize an empty map
+ *
+ * Entries are added in cluster order with fatmap_append(), starting at
+ * cluster 2.
+ *
+ * @param map Pointer to the map structure to initialize
+ * @param sectors Number of sectors in one FAT copy, used for dirty tracking
+ * @return true if initialization was successful, false otherwise
+ */
+bool fatmap_init(FatMap *map, uint32_t sectors);
+
+/**
+ * @brief Append entries after the last cluster covered
+ *
+ * @param map Pointer to the map structure
+ * @param count Number of clusters to append
+ * @param value Value of each appended entry (28 bits)
+ * @return true if the entries were appended, false if memory ran out
+ */
+bool fatmap_append(FatMap *map, uint32_t count, uint32_t value);
+
+/**
+ * @brief Get the value of a FAT entry
+ *
+ * @param map Pointer to the map structure
+ * @param cluster Cluster number; 0 and 1 return the reserved entries
+ * @param value Output for the entry value
+ * @return true if the cluster is covered by the map, false otherwise
+ */
+bool fatmap_get(const FatMap *map, uint32_t cluster, uint32_t *value);
+
+/**
+ * @brief Set the value of a FAT entry and mark its sector dirty
+ *
+ * @param map Pointer to the map structure
+ * @param cluster Cluster number; 0 and 1 set the reserved entries
+ * @param value New entry value
+ * @return true if the entry was set, false if the cluster is not covered
+ *         or memory ran out
+ */
+bool fatmap_set(FatMap *map, uint32_t cluster, uint32_t value);
+
+/**
+ * @brief Get the contiguous part of a chain starting at a cluster
+ *
+ * @param map Pointer to the map structure
+ * @param cluster Cluster in a chain
+ * @param length Output for the number of clusters, starting at cluster,
+ *               that each link to the following cluster, plus one
+ * @param next Output for the value of the last of those clusters
+ * @return true if the cluster is covered by the map, false otherwise
+ */
+bool fatmap_run(const FatMap *map, uint32_t cluster, uint32_t *length, uint32_t *next);
+
+/**
+ * @brief Find the first free or used cluster in a range
+ *
+ * @param map Pointer to the map structure
+ * @param from First cluster to consider
+ * @param limit One past the last cluster to consider
+ * @param want_free Whether to look for a free cluster (value 0) rather
+ *                  than a used one
+ * @return The first matching cluster, or limit if there is none
+ */
+uint32_t fatmap_find(const FatMap *map, uint32_t from, uint32_t limit, bool want_free);
+
+/**
+ * @brief Count the free clusters
+ *
+ * @param map Pointer to the map structure
+ * @return Number of clusters with value 0
+ */
+uint32_t fatmap_count_free(const FatMap *map);
+
+/**
+ * @brief Expand a range of entries into on-disk FAT format
+ *
+ * Clusters beyond the map read as 0.
+ *
+ * @param map Pointer to the map structure
+ * @param cluster First cluster of the range
+ * @param count Number of entries
+ * @param entries Output array of count entries
+ */
+void fatmap_read(const FatMap *map, uint32_t cluster, uint32_t count, uint32_t *entries);
+
+/**
+ * @brief Check whether a FAT sector was modified since the last write
+ *
+ * @param map Pointer to the map structure
+ * @param sector Sector number within one FAT copy
+ * @return true if the sector is dirty, false otherwise
+ */
+bool fatmap_is_dirty(const FatMap *map, uint32_t sector);
+
+/**
+ * @brief Find the next FAT sector modified since the last write
+ *
+ * @param map Pointer to the map structure
+ * @param from First sector to consider
+ * @return The first dirty sector at or after from, or the number of FAT
+ *         sectors if there is none
+ */
+uint32_t fatmap_next_dirty(const FatMap *map, uint32_t from);
+
+/**
+ * @brief Mark all FAT sectors clean
+ *
+ * @param map Pointer to the map structure
+ */
+void fatmap_clear_dirty(FatMap *map);
+
+/**
+ * @brief Get the memory used by the map
+ *
+ * @param map Pointer to the map structure
+ * @return Number of bytes allocated for runs and dirty tracking
+ */
+size_t fatmap_memory(const FatMap *map);
+
+/**
+ * @brief Free all memory used by the map
+ *
+ * @param map Pointer to the map structure
+ */
+void fatmap_destroy(FatMap *map);
+
+#endif /* FATMAP_H */
@@ -0,0 +1,111 @@
+/**
+ * @file log.h
+ * @brief Leveled diagnostic logging
+ *
+ * This header provides logging macros for library code. Messages below the
+ * compile-time level LOG_COMPILE_LEVEL (CMake option FAT32_LOG_LEVEL) are
+ * removed by the compiler; messages below the run-time level set with
+ * log_set_level() are dropped before they are formatted. Messages go to
+ * stderr unless a callback is installed with log_set_callback().
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Message severity, from most to least severe
+ */
+typedef enum {
+    LOG_LEVEL_NONE = 0,    /**< No messages */
+    LOG_LEVEL_ERROR = 1,   /**< Operation failed */
+    LOG_LEVEL_WARN = 2,    /**< Unexpected condition that was handled */
+    LOG_LEVEL_INFO = 3,    /**< Notable events */
+    LOG_LEVEL_DEBUG = 4    /**< Detailed progress for troubleshooting */
+} LogLevel;
+
+#ifndef LOG_COMPILE_LEVEL
+/** @brief Most verbose level compiled in */
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+/** @brief Default run-time level */
+#define LOG_DEFAULT_LEVEL LOG_LEVEL_WARN
+
+/**
+ * @brief Callback receiving formatted log messages
+ *
+ * @param level Severity of the message
+ * @param message Formatted message without a trailing newline
+ * @param user_data Pointer passed to log_set_callback()
+ */
+typedef void (*LogCallback)(LogLevel level, const char *message, void *user_data);
+
+/** @brief Log a message at the given level */
+#define LOG_AT(level, ...) \
+    do { \
+        if ((level) <= LOG_COMPILE_LEVEL && log_is_enabled(level)) { \
+            log_write((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+/**
+ * @brief Set the run-time level
+ *
+ * Messages less severe than level are dropped.
+ *
+ * @param level Most verbose level to emit
+ */
+void log_set_level(LogLevel level);
+
+/**
+ * @brief Get the run-time level
+ *
+ * @return Most verbose level emitted
+ */
+LogLevel log_get_level(void);
+
+/**
+ * @brief Check whether messages of a level are emitted
+ *
+ * @param level Level to check
+ * @return true if messages of this level are emitted, false otherwise
+ */
+bool log_is_enabled(LogLevel level);
+
+/**
+ * @brief Send messages to a callback instead of stderr
+ *
+ * @param callback Callback to receive messages, or NULL to restore stderr
+ * @param user_data Pointer passed to the callback
+ */
+void log_set_callback(LogCallback callback, void *user_data);
+
+/**
+ * @brief Parse a level name
+ *
+ * Accepts "none", "error", "warn", "info" and "debug".
+ *
+ * @param text Level name
+ * @param level Output for the level
+ * @return true if the name is valid, false otherwise
+ */
+bool log_parse_level(const char *text, LogLevel *level);
+
+/**
+ * @brief Format and emit a message
+ *
+ * Normally called through the LOG_* macros, which check the level first.
+ *
+ * @param level Severity of the message
+ * @param format printf-style format string
+ */
+void log_write(LogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+#endif /* LOG_H */
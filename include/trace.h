@@ -0,0 +1,129 @@
+/**
+ * @file trace.h
+ * @brief Scoped latency tracing with Chrome trace export
+ *
+ * This header provides trace spans that record the start time and duration
+ * of a scope into an in-memory ring buffer, which can be written out as
+ * Chrome/Perfetto trace JSON. Spans are only compiled in when FAT32_TRACE is
+ * defined (CMake option FAT32_TRACE); otherwise TRACE_SCOPE() and
+ * TRACE_FUNCTION() expand to nothing. Recording must also be switched on at
+ * run time with trace_enable().
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Default number of spans kept in the ring buffer */
+#define TRACE_DEFAULT_CAPACITY (1024 * 1024)
+
+/**
+ * @brief A completed span
+ */
+typedef struct {
+    const char *name;           /**< Span name (must outlive the trace) */
+    uint64_t start_ns;          /**< Start time in nanoseconds since trace_enable() */
+    uint64_t duration_ns;       /**< Duration in nanoseconds */
+} TraceEvent;
+
+/**
+ * @brief An open span
+ */
+typedef struct {
+    const char *name;           /**< Span name, or NULL if tracing was off when it began */
+    uint64_t start_ns;          /**< Start time in nanoseconds since trace_enable() */
+} TraceSpan;
+
+#ifdef FAT32_TRACE
+/** @brief Whether trace spans are compiled in */
+#define TRACE_COMPILED 1
+/** @brief Trace the enclosing scope under the given name */
+#define TRACE_SCOPE(name) \
+    TraceSpan trace_span __attribute__((cleanup(trace_span_end))) = trace_span_begin(name)
+#else
+#define TRACE_COMPILED 0
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+/** @brief Trace the enclosing function under its own name */
+#define TRACE_FUNCTION() TRACE_SCOPE(__func__)
+
+/**
+ * @brief Start recording spans
+ *
+ * Allocates the ring buffer and clears any previously recorded spans. Once
+ * the buffer is full, new spans overwrite the oldest ones.
+ *
+ * @param capacity Maximum number of spans kept
+ * @return true if recording was started, false otherwise
+ */
+bool trace_enable(uint32_t capacity);
+
+/**
+ * @brief Stop recording spans and free the ring buffer
+ */
+void trace_disable(void);
+
+/**
+ * @brief Check whether spans are being recorded
+ *
+ * @return true if recording is on, false otherwise
+ */
+bool trace_is_enabled(void);
+
+/**
+ * @brief Begin a span
+ *
+ * Normally called through TRACE_SCOPE().
+ *
+ * @param name Span name
+ * @return The open span
+ */
+TraceSpan trace_span_begin(const char *name);
+
+/**
+ * @brief End a span and record it
+ *
+ * Normally called automatically when a TRACE_SCOPE() variable goes out of
+ * scope.
+ *
+ * @param span Pointer to the open span
+ */
+void trace_span_end(TraceSpan *span);
+
+/**
+ * @brief Get the number of spans currently held
+ *
+ * @return Number of spans in the ring buffer
+ */
+uint32_t trace_event_count(void);
+
+/**
+ * @brief Get a recorded span
+ *
+ * @param index Index of the span, 0 being the oldest one still held
+ * @param event Output for the span
+ * @return true if the span exists, false otherwise
+ */
+bool trace_get_event(uint32_t index, TraceEvent *event);
+
+/**
+ * @brief Get the number of spans overwritten because the buffer was full
+ *
+ * @return Number of dropped spans
+ */
+uint64_t trace_dropped_count(void);
+
+/**
+ * @brief Write the recorded spans as Chrome trace JSON
+ *
+ * The file can be opened in chrome://tracing or ui.perfetto.dev.
+ *
+ * @param path Path of the output file
+ * @return true if the file was written, false otherwise
+ */
+bool trace_write_chrome(const char *path);
+
+#endif /* TRACE_H */
@@ -2,16 +2,24 @@
  * @file utils.h
  * @brief Utility functions for path manipulation and FAT32 name conversion
  *
- * This header provides various helper functions for path operations and
- * filename conversions between standard filenames and FAT32 8.3 format.
+ * This header provides various helper functions for path operations,
+ * filename conversions between standard filenames and FAT32 8.3 format,
+ * and the UTF-8/UTF-16 conversion, hashing and short-name generation used
+ * for long filenames.
  */
 
 #ifndef UTILS_H
 #define UTILS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/** @brief DIR_NTRes flag: the base of the short name is shown in lower case */
+#define SHORT_NAME_LOWER_BASE 0x08
+/** @brief DIR_NTRes flag: the extension of the short name is shown in lower case */
+#define SHORT_NAME_LOWER_EXT  0x10
+
 /**
  * @brief Normalize a file path
  *
@@ -78,7 +86,8 @@ void path_get_extension(char *dest, const char *path);
  * @brief Check if a filename is valid
  *
  * Validates a filename according to common filesystem rules.
- * Checks for invalid characters and length constraints.
+ * Checks for invalid characters and length constraints, and rejects "."
+ * and ".." and names ending in a period or space.
  *
  * @param name Filename to validate
  * @return true if the filename is valid, false otherwise
@@ -106,4 +115,125 @@ void convert_to_short_name(char *dest, const char *src);
  */
 void convert_from_short_name(char *dest, const char *src);
 
+/**
+ * @brief Convert a FAT32 8.3 short name to a normal filename, honouring case flags
+ *
+ * Same as convert_from_short_name(), but shows the base and extension in
+ * lower case when the matching DIR_NTRes flags are set.
+ *
+ * @param dest Buffer to store the normal filename (at least 13 bytes)
+ * @param src FAT32 8.3 format name (11 characters)
+ * @param case_flags SHORT_NAME_LOWER_BASE and SHORT_NAME_LOWER_EXT bits
+ */
+void convert_from_short_name_case(char *dest, const char *src, uint8_t case_flags);
+
+/**
+ * @brief Get the exact 8.3 short name of a filename, if it has one
+ *
+ * A filename has an exact short name when it is plain ASCII, has a base of
+ * at most 8 and an extension of at most 3 valid short-name characters, and
+ * each part is either all upper or all lower case. Such names need no long
+ * filename entries; lower-case parts are recorded with case flags.
+ *
+ * @param short_name Buffer to store the 8.3 name (11 bytes)
+ * @param case_flags Output for the DIR_NTRes case flags
+ * @param name Filename to convert
+ * @return true if the name has an exact short name, false otherwise
+ */
+bool short_name_from_name(char short_name[11], uint8_t *case_flags, const char *name);
+
+/**
+ * @brief Generate the basis short name for a long filename
+ *
+ * Follows the FAT specification: upper-cases the name, replaces characters
+ * that are not valid in short names with '_', drops spaces and all periods
+ * except the last, and keeps up to 8 characters of base and 3 of extension.
+ *
+ * @param short_name Buffer to store the 8.3 name (11 bytes)
+ * @param name Long filename
+ * @return true if the basis is an exact upper-case copy of the name, false
+ *         if characters were replaced or dropped (a numeric tail is needed)
+ */
+bool short_name_basis(char short_name[11], const char *name);
+
+/**
+ * @brief Put a numeric tail ("~N") into a short name
+ *
+ * The tail is placed after the base, overwriting its last characters if
+ * the base is too long to hold it.
+ *
+ * @param short_name 8.3 name to modify (11 bytes)
+ * @param number Tail number, 1 to 999999
+ * @return true if the tail was set, false if the number is out of range
+ */
+bool short_name_set_tail(char short_name[11], uint32_t number);
+
+/**
+ * @brief Compute the long filename checksum of a short name
+ *
+ * @param short_name 8.3 name (11 bytes)
+ * @return Checksum stored in each long filename entry of the name
+ */
+uint8_t lfn_checksum(const char short_name[11]);
+
+/**
+ * @brief Convert a UTF-8 string to UTF-16
+ *
+ * Rejects malformed UTF-8, overlong encodings, surrogate code points and
+ * code points above U+10FFFF.
+ *
+ * @param src NUL-terminated UTF-8 string
+ * @param dest Buffer for the UTF-16 code units (not NUL-terminated)
+ * @param dest_units Size of dest in code units
+ * @param length Output for the number of code units written
+ * @return true if the string was converted, false if it is invalid or too long
+ */
+bool utf8_to_utf16(const char *src, uint16_t *dest, size_t dest_units, size_t *length);
+
+/**
+ * @brief Convert UTF-16 code units to a UTF-8 string
+ *
+ * Unpaired surrogates are replaced with U+FFFD.
+ *
+ * @param src UTF-16 code units
+ * @param length Number of code units
+ * @param dest Buffer for the NUL-terminated UTF-8 string
+ * @param dest_size Size of dest in bytes (3 per code unit plus 1 always suffices)
+ * @return true if the string was converted, false if dest is too small
+ */
+bool utf16_to_utf8(const uint16_t *src, size_t length, char *dest, size_t dest_size);
+
+/**
+ * @brief Hash a UTF-16 name, ignoring ASCII case
+ *
+ * @param units UTF-16 code units
+ * @param length Number of code units
+ * @return Hash of the name
+ */
+uint32_t lfn_name_hash(const uint16_t *units, size_t length);
+
+/**
+ * @brief Compare two UTF-16 names, ignoring ASCII case
+ *
+ * @param a First name
+ * @param a_length Number of code units in a
+ * @param b Second name
+ * @param b_length Number of code units in b
+ * @return true if the names are equal, false otherwise
+ */
+bool lfn_name_equal(const uint16_t *a, size_t a_length, const uint16_t *b, size_t b_length);
+
+/**
+ * @brief Parse a size with an optional binary unit suffix
+ *
+ * Accepts a decimal number optionally followed by K, M, G or T (powers of
+ * 1024), with an optional trailing "B" or "iB", for example "512", "64M",
+ * "32G" or "1TiB".
+ *
+ * @param text String to parse
+ * @param out Pointer to store the size in bytes
+ * @return true if the string is a valid size, false otherwise
+ */
+bool parse_size(const char *text, uint64_t *out);
+
 #endif /* UTILS_H */
\ No newline at end of file
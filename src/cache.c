@@ -0,0 +1,266 @@
+#include "../include/cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t cache_hash(BufferCache *cache, uint64_t sector) {
+    return (uint32_t)(sector / cache->block_sectors * 2654435761u) & cache->bucket_mask;
+}
+
+static CacheBlock *cache_lookup(BufferCache *cache, uint64_t sector) {
+    CacheBlock *block = cache->buckets[cache_hash(cache, sector)];
+    while (block && block->sector != sector) {
+        block = block->hash_next;
+    }
+    return block;
+}
+
+static void lru_unlink(BufferCache *cache, CacheBlock *block) {
+    if (block->lru_prev) {
+        block->lru_prev->lru_next = block->lru_next;
+    } else {
+        cache->lru_head = block->lru_next;
+    }
+
+    if (block->lru_next) {
+        block->lru_next->lru_prev = block->lru_prev;
+    } else {
+        cache->lru_tail = block->lru_prev;
+    }
+
+    block->lru_prev = NULL;
+    block->lru_next = NULL;
+}
+
+static void lru_push_front(BufferCache *cache, CacheBlock *block) {
+    block->lru_prev = NULL;
+    block->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = block;
+    }
+    cache->lru_head = block;
+    if (!cache->lru_tail) {
+        cache->lru_tail = block;
+    }
+}
+
+static void hash_remove(BufferCache *cache, CacheBlock *block) {
+    CacheBlock **link = &cache->buckets[cache_hash(cache, block->sector)];
+    while (*link && *link != block) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) {
+        *link = block->hash_next;
+    }
+    block->hash_next = NULL;
+}
+
+static bool write_back(BufferCache *cache, CacheBlock *block) {
+    if (!block->dirty) {
+        return true;
+    }
+
+    if (!disk_write_sectors(cache->disk, block->sector, cache->block_sectors, block->data)) {
+        return false;
+    }
+
+    block->dirty = false;
+    return true;
+}
+
+static CacheBlock *take_block(BufferCache *cache) {
+    if (cache->count < cache->capacity) {
+        CacheBlock *block = (CacheBlock*)calloc(1, sizeof(CacheBlock));
+        if (!block) {
+            return NULL;
+        }
+
+        block->data = (uint8_t*)malloc(cache->block_size);
+        if (!block->data) {
+            free(block);
+            return NULL;
+        }
+
+        cache->count++;
+        return block;
+    }
+
+    CacheBlock *victim = cache->lru_tail;
+    while (victim && victim->pins > 0) {
+        victim = victim->lru_prev;
+    }
+
+    if (!victim || !write_back(cache, victim)) {
+        return NULL;
+    }
+
+    lru_unlink(cache, victim);
+    hash_remove(cache, victim);
+    return victim;
+}
+
+bool cache_init(BufferCache *cache, Disk *disk, uint32_t block_sectors, size_t budget_bytes) {
+    if (!cache || !disk || block_sectors == 0) {
+        return false;
+    }
+
+    memset(cache, 0, sizeof(BufferCache));
+    cache->disk = disk;
+    cache->block_sectors = block_sectors;
+    cache->block_size = block_sectors * DISK_SECTOR_SIZE;
+
+    size_t capacity = budget_bytes / cache->block_size;
+    if (capacity < CACHE_MIN_BLOCKS) {
+        capacity = CACHE_MIN_BLOCKS;
+    }
+    cache->capacity = (uint32_t)capacity;
+
+    uint32_t bucket_count = 1;
+    while (bucket_count < cache->capacity * 2) {
+        bucket_count <<= 1;
+    }
+    cache->bucket_mask = bucket_count - 1;
+
+    cache->buckets = (CacheBlock**)calloc(bucket_count, sizeof(CacheBlock*));
+    return cache->buckets != NULL;
+}
+
+uint8_t *cache_get(BufferCache *cache, uint64_t sector, bool load) {
+    if (!cache || !cache->buckets) {
+        return NULL;
+    }
+
+    CacheBlock *block = cache_lookup(cache, sector);
+    if (block) {
+        cache->hits++;
+        lru_unlink(cache, block);
+        lru_push_front(cache, block);
+        if (!load) {
+            memset(block->data, 0, cache->block_size);
+            block->dirty = true;
+        }
+        block->pins++;
+        return block->data;
+    }
+
+    cache->misses++;
+    block = take_block(cache);
+    if (!block) {
+        return NULL;
+    }
+
+    block->sector = sector;
+    block->dirty = false;
+    block->pins = 0;
+
+    if (!load) {
+        memset(block->data, 0, cache->block_size);
+        block->dirty = true;
+    } else if (!disk_read_sectors(cache->disk, sector, cache->block_sectors, block->data)) {
+        free(block->data);
+        free(block);
+        cache->count--;
+        return NULL;
+    }
+
+    uint32_t bucket = cache_hash(cache, sector);
+    block->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = block;
+    lru_push_front(cache, block);
+
+    block->pins++;
+    return block->data;
+}
+
+void cache_release(BufferCache *cache, uint64_t sector, bool dirty) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    CacheBlock *block = cache_lookup(cache, sector);
+    if (!block) {
+        return;
+    }
+
+    if (block->pins > 0) {
+        block->pins--;
+    }
+    if (dirty) {
+        block->dirty = true;
+    }
+}
+
+bool cache_flush(BufferCache *cache) {
+    if (!cache || !cache->buckets) {
+        return false;
+    }
+
+    bool success = true;
+    for (CacheBlock *block = cache->lru_head; block; block = block->lru_next) {
+        if (!write_back(cache, block)) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool cache_write_back_range(BufferCache *cache, uint64_t sector, uint64_t sector_count) {
+    if (!cache || !cache->buckets) {
+        return false;
+    }
+
+    bool success = true;
+    for (uint64_t s = sector; s < sector + sector_count && cache->count > 0; s += cache->block_sectors) {
+        CacheBlock *block = cache_lookup(cache, s);
+        if (block && !write_back(cache, block)) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+void cache_discard_range(BufferCache *cache, uint64_t sector, uint64_t sector_count) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    for (uint64_t s = sector; s < sector + sector_count && cache->count > 0; s += cache->block_sectors) {
+        CacheBlock *block = cache_lookup(cache, s);
+        if (block && block->pins == 0) {
+            lru_unlink(cache, block);
+            hash_remove(cache, block);
+            free(block->data);
+            free(block);
+            cache->count--;
+        }
+    }
+}
+
+void cache_invalidate(BufferCache *cache) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    CacheBlock *block = cache->lru_head;
+    while (block) {
+        CacheBlock *next = block->lru_next;
+        free(block->data);
+        free(block);
+        block = next;
+    }
+
+    memset(cache->buckets, 0, (size_t)(cache->bucket_mask + 1) * sizeof(CacheBlock*));
+    cache->lru_head = NULL;
+    cache->lru_tail = NULL;
+    cache->count = 0;
+}
+
+void cache_destroy(BufferCache *cache) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    cache_flush(cache);
+    cache_invalidate(cache);
+    free(cache->buckets);
+    cache->buckets = NULL;
+}
@@ -7,13 +7,13 @@
 
 #define MAX_DIR_ENTRIES 1024
 
-static void parse_input(const char *input, char *command, char *arg, size_t max_len) {
+static void parse_input(const char *input, char *command, size_t command_size, char *arg, size_t arg_size) {
     char *space = strchr(input, ' ');
 
     if (space) {
         size_t cmd_len = space - input;
-        if (cmd_len >= max_len) {
-            cmd_len = max_len - 1;
+        if (cmd_len >= command_size) {
+            cmd_len = command_size - 1;
         }
 
         strncpy(command, input, cmd_len);
@@ -23,40 +23,74 @@ static void parse_input(const char *input, char *command, char *arg, size_t max_
             space++;
         }
 
-        strncpy(arg, space, max_len - 1);
-        arg[max_len - 1] = '\0';
+        strncpy(arg, space, arg_size - 1);
+        arg[arg_size - 1] = '\0';
     } else {
-        strncpy (command, input, max_len - 1);
-        command[max_len - 1] = '\0';
+        strncpy (command, input, command_size - 1);
+        command[command_size - 1] = '\0';
         arg[0] = '\0';
     }
 }
 
-static void get_readable_name(char *dest, const char *src) {
-    char name[9], ext[4];
-    int i;
-
-    for (i = 0; i < 8 && src[i] != ' '; i++) {
-        name[i] = src[i];
-    }
-    name[i] = '\0';
-
-    for (i = 0; i < 3 && src[i + 8] != ' '; i++) {
-        ext[i] = src[i + 8];
+static bool parse_format_args(const char *args, FAT32_FormatOptions *options) {
+    options->mode = FAT32_FORMAT_QUICK;
+    options->threads = 1;
+    options->cluster_size = 0;
+    options->align = 0;
+
+    char token[32];
+    int consumed = 0;
+    while (sscanf(args, "%31s%n", token, &consumed) == 1) {
+        args += consumed;
+        if (strcmp(token, "--quick") == 0) {
+            options->mode = FAT32_FORMAT_QUICK;
+        } else if (strcmp(token, "--full") == 0) {
+            options->mode = FAT32_FORMAT_FULL;
+        } else if (strcmp(token, "--cluster-size") == 0 || strcmp(token, "--align") == 0) {
+            bool cluster = strcmp(token, "--cluster-size") == 0;
+            uint64_t bytes = 0;
+            if (sscanf(args, "%31s%n", token, &consumed) != 1) {
+                printf("Error: Size expected\n");
+                return false;
+            }
+            args += consumed;
+            if (!parse_size(token, &bytes) || bytes < 512 || bytes > (cluster ? 65536 : FAT32_MAX_ALIGN) ||
+                (bytes & (bytes - 1)) != 0) {
+                printf("Error: Invalid %s '%s'\n", cluster ? "cluster size" : "alignment", token);
+                return false;
+            }
+            if (cluster) {
+                options->cluster_size = (uint32_t)bytes;
+            } else {
+                options->align = (uint32_t)bytes;
+            }
+        } else if (strcmp(token, "--threads") == 0) {
+            char *end = NULL;
+            if (sscanf(args, "%31s%n", token, &consumed) != 1) {
+                printf("Error: Thread count expected\n");
+                return false;
+            }
+            args += consumed;
+            unsigned long threads = strtoul(token, &end, 10);
+            if (*end != '\0' || threads == 0 || threads > 64) {
+                printf("Error: Invalid thread count '%s'\n", token);
+                return false;
+            }
+            options->threads = (uint32_t)threads;
+        } else {
+            printf("Error: Unknown option '%s'\n", token);
+            return false;
+        }
     }
-    ext[i] = '\0';
-
-    if (ext[0]) {
-        sprintf(dest, "%s.%s", name, ext);
-    } else strcpy(dest, name);
+    return true;
 }
 
-bool cmd_format(FAT32_FileSystem *fs) {
+bool cmd_format(FAT32_FileSystem *fs, const FAT32_FormatOptions *options) {
     if (!fs) {
         return false;
     }
 
-    if (!fat32_format(fs)) {
+    if (!fat32_format_ex(fs, options)) {
         printf("Error: Failed to format disk\n");
         return false;
     }
@@ -75,23 +109,20 @@ bool cmd_ls(FAT32_FileSystem *fs, const char *path) {
         return false;
     }
 
-    FAT32_DirEntry entries[MAX_DIR_ENTRIES];
+    FAT32_DirInfo *infos = (FAT32_DirInfo*)malloc(MAX_DIR_ENTRIES * sizeof(FAT32_DirInfo));
     uint32_t count = 0;
 
-    if (!fat32_list_directory(fs, path, entries, MAX_DIR_ENTRIES, &count)) {
+    if (!infos || !fat32_read_directory(fs, path, infos, MAX_DIR_ENTRIES, &count)) {
         printf("Error: Failed to list directory\n");
+        free(infos);
         return false;
     }
 
     for (uint32_t i = 0; i < count; i++) {
-        char readable_name[13];
-        get_readable_name(readable_name, entries[i].DIR_Name);
-
-        if (entries[i].DIR_Attr & FAT32_ATTR_DIRECTORY) {
-            printf("%s\n", readable_name);
-        } else printf("%s\n", readable_name);
+        printf("%s\n", infos[i].name);
     }
 
+    free(infos);
     return true;
 }
 
@@ -169,52 +200,209 @@ bool cmd_touch(FAT32_FileSystem *fs, const char *name) {
     return true;
 }
 
+bool cmd_prealloc(FAT32_FileSystem *fs, const char *name, const char *size, bool zero) {
+    if (!fs || !name || !size) {
+        return false;
+    }
+
+    if (!fs->is_formatted) {
+        printf("Unknown disk format\n");
+        return false;
+    }
+
+    uint64_t bytes = 0;
+    if (!parse_size(size, &bytes) || bytes > UINT32_MAX) {
+        printf("Error: Invalid size '%s'\n", size);
+        return false;
+    }
+
+    if (!fat32_preallocate(fs, name, (uint32_t)bytes, zero)) {
+        printf("Error: Failed to preallocate file\n");
+        return false;
+    }
+
+    printf("Ok\n");
+    return true;
+}
+
+bool cmd_df(FAT32_FileSystem *fs) {
+    if (!fs) {
+        return false;
+    }
+
+    if (!fs->is_formatted) {
+        printf("Unknown disk format\n");
+        return false;
+    }
+
+    uint32_t free_clusters = 0;
+    uint32_t total_clusters = 0;
+    if (!fat32_get_free_space(fs, &free_clusters, &total_clusters)) {
+        printf("Error: Failed to get free space\n");
+        return false;
+    }
+
+    uint64_t cluster_size = fs->bytes_per_cluster;
+    printf("Cluster size: %u bytes\n", fs->bytes_per_cluster);
+    printf("Total: %u clusters (%llu bytes)\n", total_clusters,
+           (unsigned long long)(total_clusters * cluster_size));
+    printf("Used:  %u clusters (%llu bytes)\n", total_clusters - free_clusters,
+           (unsigned long long)((total_clusters - free_clusters) * cluster_size));
+    printf("Free:  %u clusters (%llu bytes)\n", free_clusters,
+           (unsigned long long)(free_clusters * cluster_size));
+    return true;
+}
+
+bool cmd_sync(FAT32_FileSystem *fs) {
+    if (!fs) {
+        return false;
+    }
+
+    if (fs->is_formatted && !fat32_sync(fs)) {
+        printf("Error: Failed to flush filesystem\n");
+        return false;
+    }
+
+    if (!disk_sync(&fs->disk)) {
+        printf("Error: Failed to sync disk\n");
+        return false;
+    }
+
+    printf("Ok\n");
+    return true;
+}
+
+bool cmd_stats(FAT32_FileSystem *fs, bool reset) {
+    if (!fs) {
+        return false;
+    }
+
+    if (reset) {
+        fat32_reset_stats(fs);
+        printf("Ok\n");
+        return true;
+    }
+
+    FAT32_Stats stats;
+    fat32_get_stats(fs, &stats);
+
+    printf("Disk reads:     %llu (%llu sectors)\n",
+           (unsigned long long)stats.disk.read_ops, (unsigned long long)stats.disk.sectors_read);
+    printf("Disk writes:    %llu (%llu sectors)\n",
+           (unsigned long long)stats.disk.write_ops, (unsigned long long)stats.disk.sectors_written);
+    printf("Disk seeks:     %llu\n", (unsigned long long)stats.disk.seeks);
+    printf("Disk zeroed:    %llu sectors\n", (unsigned long long)stats.disk.sectors_zeroed);
+    printf("Disk syncs:     %llu\n", (unsigned long long)stats.disk.syncs);
+    printf("Disk syscalls:  %llu\n", (unsigned long long)stats.disk.syscalls);
+    printf("Flushes:        %llu\n", (unsigned long long)stats.syncs);
+    printf("FAT flushes:    %llu (%llu sectors)\n",
+           (unsigned long long)stats.fat_flushes, (unsigned long long)stats.fat_sectors_written);
+    printf("FAT mirrors:    %llu bulk syncs (%llu sectors)\n",
+           (unsigned long long)stats.fat_mirror_syncs, (unsigned long long)stats.fat_mirror_sectors);
+    printf("Clusters:       %llu allocated, %llu freed\n",
+           (unsigned long long)stats.clusters_allocated, (unsigned long long)stats.clusters_freed);
+    printf("Lookups:        %llu (%llu directory clusters scanned)\n",
+           (unsigned long long)stats.lookups, (unsigned long long)stats.dir_clusters_scanned);
+    printf("Cluster cache:  %llu hits, %llu misses\n",
+           (unsigned long long)stats.cache_hits, (unsigned long long)stats.cache_misses);
+    printf("FAT pages:      %llu hits, %llu misses\n",
+           (unsigned long long)stats.fat_page_hits, (unsigned long long)stats.fat_page_misses);
+    if (fs->fat_map.runs) {
+        printf("FAT extents:    %u runs (%zu bytes)\n", fs->fat_map.count, fatmap_memory(&fs->fat_map));
+    }
+    printf("Dir index:      %llu hits, %llu misses\n",
+           (unsigned long long)stats.dir_index_hits, (unsigned long long)stats.dir_index_misses);
+    printf("Path cache:     %llu hits, %llu misses\n",
+           (unsigned long long)stats.dentry_hits, (unsigned long long)stats.dentry_misses);
+    return true;
+}
+
 void cmd_help() {
     printf("Available commands:\n");
-    printf("  format         - Create new FAT32 filesystem\n");
+    printf("  format [--quick|--full] [--threads N] [--cluster-size S] [--align S]\n");
+    printf("                 - Create new FAT32 filesystem\n");
     printf("  ls [path]      - List directory contents\n");
     printf("  cd <path>      - Change current directory (absolute path)\n");
     printf("  mkdir <name>   - Create new directory\n");
     printf("  touch <name>   - Create empty file\n");
+    printf("  prealloc <name> <size> [--zero] - Reserve contiguous space for a file\n");
+    printf("  df             - Show free space\n");
+    printf("  sync           - Write pending changes to the disk image\n");
+    printf("  stats [reset]  - Show or reset I/O and cache counters\n");
     printf("  exit/quit      - Exit the program\n");
 }
 
-void process_command(FAT32_FileSystem *fs, const char *input) {
+bool process_command(FAT32_FileSystem *fs, const char *input) {
     if (!fs || !input) {
-        return;
+        return false;
     }
 
     char command[32];
     char arg[256];
 
-    parse_input(input, command, arg, sizeof(command));
+    parse_input(input, command, sizeof(command), arg, sizeof(arg));
 
     if (strcmp(command, "format") == 0) {
-        cmd_format(fs);
+        FAT32_FormatOptions options;
+        if (!parse_format_args(arg, &options)) {
+            return false;
+        }
+        return cmd_format(fs, &options);
     } else if (strcmp(command, "ls") == 0) {
-        cmd_ls(fs, arg[0] ? arg : NULL);
+        return cmd_ls(fs, arg[0] ? arg : NULL);
     } else if (strcmp(command, "cd") == 0) {
         if (arg[0]) {
-            cmd_cd(fs, arg);
+            return cmd_cd(fs, arg);
         } else {
             printf("Error: Path expected\n");
+            return false;
         }
     } else if (strcmp(command, "mkdir") == 0) {
         if (arg[0]) {
-            cmd_mkdir(fs, arg);
+            return cmd_mkdir(fs, arg);
         } else {
             printf("Error: Name expected\n");
+            return false;
         }
     } else if (strcmp(command, "touch") == 0) {
         if (arg[0]) {
-            cmd_touch(fs, arg);
+            return cmd_touch(fs, arg);
         } else {
             printf("Error: Name expected\n");
+            return false;
+        }
+    } else if (strcmp(command, "prealloc") == 0) {
+        char name[256];
+        char size[32];
+        char option[16];
+        int fields = sscanf(arg, "%255s %31s %15s", name, size, option);
+        if (fields < 2) {
+            printf("Error: Name and size expected\n");
+            return false;
+        } else if (fields == 3 && strcmp(option, "--zero") != 0) {
+            printf("Error: Unknown option '%s'\n", option);
+            return false;
+        } else {
+            return cmd_prealloc(fs, name, size, fields == 3);
         }
+    } else if (strcmp(command, "df") == 0) {
+        return cmd_df(fs);
+    } else if (strcmp(command, "sync") == 0) {
+        return cmd_sync(fs);
+    } else if (strcmp(command, "stats") == 0) {
+        if (arg[0] && strcmp(arg, "reset") != 0) {
+            printf("Error: Unknown argument '%s'\n", arg);
+            return false;
+        }
+        return cmd_stats(fs, arg[0] != '\0');
     } else if (strcmp(command, "help") == 0) {
         cmd_help();
+        return true;
     } else if (command[0]) {
         printf("Error: Unknown command '%s'\n", command);
         printf("Type 'help' for available commands\n");
+        return false;
     }
+
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "../include/dentry.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t path_hash(const char *path) {
+    uint32_t hash = 2166136261u;
+    while (*path) {
+        hash ^= (uint8_t)*path++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void lru_unlink(DentryCache *cache, Dentry *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void lru_push_front(DentryCache *cache, Dentry *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = entry;
+    }
+    cache->lru_head = entry;
+    if (!cache->lru_tail) {
+        cache->lru_tail = entry;
+    }
+}
+
+static Dentry *find(DentryCache *cache, const char *path, uint32_t hash) {
+    Dentry *entry = cache->buckets[hash & cache->bucket_mask];
+    while (entry && (entry->hash != hash || strcmp(entry->path, path) != 0)) {
+        entry = entry->hash_next;
+    }
+    return entry;
+}
+
+static void remove_entry(DentryCache *cache, Dentry *entry) {
+    Dentry **link = &cache->buckets[entry->hash & cache->bucket_mask];
+    while (*link && *link != entry) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) {
+        *link = entry->hash_next;
+    }
+
+    lru_unlink(cache, entry);
+    cache->count--;
+    free(entry->path);
+    free(entry);
+}
+
+bool dentry_init(DentryCache *cache, uint32_t capacity) {
+    if (!cache || capacity == 0) {
+        return false;
+    }
+
+    memset(cache, 0, sizeof(DentryCache));
+    cache->capacity = capacity;
+
+    uint32_t bucket_count = 1;
+    while (bucket_count < capacity * 2) {
+        bucket_count <<= 1;
+    }
+    cache->bucket_mask = bucket_count - 1;
+
+    cache->buckets = (Dentry**)calloc(bucket_count, sizeof(Dentry*));
+    return cache->buckets != NULL;
+}
+
+bool dentry_lookup(DentryCache *cache, const char *path, uint32_t *first_cluster, uint8_t *attr) {
+    if (!cache || !cache->buckets || !path) {
+        return false;
+    }
+
+    Dentry *entry = find(cache, path, path_hash(path));
+    if (!entry) {
+        return false;
+    }
+
+    lru_unlink(cache, entry);
+    lru_push_front(cache, entry);
+
+    if (first_cluster) {
+        *first_cluster = entry->first_cluster;
+    }
+    if (attr) {
+        *attr = entry->attr;
+    }
+    return true;
+}
+
+bool dentry_insert(DentryCache *cache, const char *path, uint32_t first_cluster, uint8_t attr) {
+    if (!cache || !cache->buckets || !path) {
+        return false;
+    }
+
+    uint32_t hash = path_hash(path);
+    Dentry *entry = find(cache, path, hash);
+    if (entry) {
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+        entry->first_cluster = first_cluster;
+        entry->attr = attr;
+        return true;
+    }
+
+    if (cache->count >= cache->capacity) {
+        remove_entry(cache, cache->lru_tail);
+    }
+
+    entry = (Dentry*)calloc(1, sizeof(Dentry));
+    if (!entry) {
+        return false;
+    }
+
+    entry->path = strdup(path);
+    if (!entry->path) {
+        free(entry);
+        return false;
+    }
+
+    entry->hash = hash;
+    entry->first_cluster = first_cluster;
+    entry->attr = attr;
+
+    uint32_t bucket = hash & cache->bucket_mask;
+    entry->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    lru_push_front(cache, entry);
+    cache->count++;
+
+    return true;
+}
+
+void dentry_invalidate(DentryCache *cache, const char *path) {
+    if (!cache || !cache->buckets || !path) {
+        return;
+    }
+
+    if (strcmp(path, "/") == 0) {
+        dentry_clear(cache);
+        return;
+    }
+
+    size_t length = strlen(path);
+    Dentry *entry = cache->lru_head;
+    while (entry) {
+        Dentry *next = entry->lru_next;
+        if (strncmp(entry->path, path, length) == 0
+            && (entry->path[length] == '\0' || entry->path[length] == '/')) {
+            remove_entry(cache, entry);
+        }
+        entry = next;
+    }
+}
+
+void dentry_clear(DentryCache *cache) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    while (cache->lru_head) {
+        remove_entry(cache, cache->lru_head);
+    }
+}
+
+void dentry_destroy(DentryCache *cache) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    dentry_clear(cache);
+    free(cache->buckets);
+    cache->buckets = NULL;
+}
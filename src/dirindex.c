@@ -0,0 +1,371 @@
+#include "../include/dirindex.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOT_EMPTY   0
+#define SLOT_LIVE    1
+#define SLOT_DELETED 2
+
+#define DIRINDEX_BUCKETS 64
+
+static uint32_t name_hash(const char name[11]) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 11; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t dir_hash(DirIndexCache *cache, uint32_t dir_cluster) {
+    return (dir_cluster * 2654435761u) & cache->bucket_mask;
+}
+
+static size_t index_bytes(uint32_t slot_count) {
+    return sizeof(DirIndex) + (size_t)slot_count * sizeof(DirIndexEntry);
+}
+
+static void lru_unlink(DirIndexCache *cache, DirIndex *index) {
+    if (index->lru_prev) {
+        index->lru_prev->lru_next = index->lru_next;
+    } else {
+        cache->lru_head = index->lru_next;
+    }
+
+    if (index->lru_next) {
+        index->lru_next->lru_prev = index->lru_prev;
+    } else {
+        cache->lru_tail = index->lru_prev;
+    }
+
+    index->lru_prev = NULL;
+    index->lru_next = NULL;
+}
+
+static void lru_push_front(DirIndexCache *cache, DirIndex *index) {
+    index->lru_prev = NULL;
+    index->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = index;
+    }
+    cache->lru_head = index;
+    if (!cache->lru_tail) {
+        cache->lru_tail = index;
+    }
+}
+
+static void index_free(DirIndexCache *cache, DirIndex *index) {
+    DirIndex **link = &cache->buckets[dir_hash(cache, index->dir_cluster)];
+    while (*link && *link != index) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) {
+        *link = index->hash_next;
+    }
+
+    lru_unlink(cache, index);
+    cache->bytes -= index_bytes(index->slot_mask + 1);
+    free(index->slots);
+    free(index);
+}
+
+static bool make_room(DirIndexCache *cache, DirIndex *keep, size_t extra) {
+    while (cache->bytes + extra > cache->budget) {
+        DirIndex *victim = cache->lru_tail;
+        while (victim && victim == keep) {
+            victim = victim->lru_prev;
+        }
+        if (!victim) {
+            return false;
+        }
+        index_free(cache, victim);
+    }
+    return true;
+}
+
+static DirIndexEntry *probe(DirIndex *index, bool is_long, uint32_t hash, const char name[11], bool for_insert) {
+    uint32_t pos = hash & index->slot_mask;
+    DirIndexEntry *first_deleted = NULL;
+
+    for (;;) {
+        DirIndexEntry *entry = &index->slots[pos];
+        if (entry->state == SLOT_EMPTY) {
+            if (!for_insert) {
+                return NULL;
+            }
+            return first_deleted ? first_deleted : entry;
+        }
+        if (entry->state == SLOT_DELETED) {
+            if (!first_deleted) {
+                first_deleted = entry;
+            }
+        } else if (entry->is_long == is_long && entry->hash == hash && memcmp(entry->name, name, 11) == 0) {
+            return entry;
+        }
+        pos = (pos + 1) & index->slot_mask;
+    }
+}
+
+static bool rehash(DirIndexCache *cache, DirIndex *index) {
+    uint32_t slot_count = DIRINDEX_MIN_SLOTS;
+    while (slot_count < (index->live + 1) * 2) {
+        slot_count <<= 1;
+    }
+
+    size_t old_bytes = index_bytes(index->slot_mask + 1);
+    size_t new_bytes = index_bytes(slot_count);
+    if (new_bytes > old_bytes && !make_room(cache, index, new_bytes - old_bytes)) {
+        return false;
+    }
+
+    DirIndexEntry *slots = (DirIndexEntry*)calloc(slot_count, sizeof(DirIndexEntry));
+    if (!slots) {
+        return false;
+    }
+
+    DirIndexEntry *old_slots = index->slots;
+    uint32_t old_count = index->slot_mask + 1;
+
+    index->slots = slots;
+    index->slot_mask = slot_count - 1;
+    index->used = index->live;
+
+    for (uint32_t i = 0; i < old_count; i++) {
+        if (old_slots[i].state == SLOT_LIVE) {
+            *probe(index, old_slots[i].is_long, old_slots[i].hash, old_slots[i].name, true) = old_slots[i];
+        }
+    }
+
+    free(old_slots);
+    cache->bytes = cache->bytes - old_bytes + new_bytes;
+    return true;
+}
+
+bool dirindex_init(DirIndexCache *cache, size_t budget_bytes) {
+    if (!cache) {
+        return false;
+    }
+
+    memset(cache, 0, sizeof(DirIndexCache));
+    cache->budget = budget_bytes;
+    cache->bucket_mask = DIRINDEX_BUCKETS - 1;
+
+    cache->buckets = (DirIndex**)calloc(DIRINDEX_BUCKETS, sizeof(DirIndex*));
+    return cache->buckets != NULL;
+}
+
+DirIndex *dirindex_get(DirIndexCache *cache, uint32_t dir_cluster) {
+    if (!cache || !cache->buckets) {
+        return NULL;
+    }
+
+    DirIndex *index = cache->buckets[dir_hash(cache, dir_cluster)];
+    while (index && index->dir_cluster != dir_cluster) {
+        index = index->hash_next;
+    }
+
+    if (index && index != cache->lru_head) {
+        lru_unlink(cache, index);
+        lru_push_front(cache, index);
+    }
+    return index;
+}
+
+DirIndex *dirindex_create(DirIndexCache *cache, uint32_t dir_cluster) {
+    if (!cache || !cache->buckets) {
+        return NULL;
+    }
+
+    dirindex_drop(cache, dir_cluster);
+
+    size_t bytes = index_bytes(DIRINDEX_MIN_SLOTS);
+    if (!make_room(cache, NULL, bytes)) {
+        return NULL;
+    }
+
+    DirIndex *index = (DirIndex*)calloc(1, sizeof(DirIndex));
+    if (!index) {
+        return NULL;
+    }
+
+    index->slots = (DirIndexEntry*)calloc(DIRINDEX_MIN_SLOTS, sizeof(DirIndexEntry));
+    if (!index->slots) {
+        free(index);
+        return NULL;
+    }
+
+    index->dir_cluster = dir_cluster;
+    index->slot_mask = DIRINDEX_MIN_SLOTS - 1;
+
+    uint32_t bucket = dir_hash(cache, dir_cluster);
+    index->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = index;
+    lru_push_front(cache, index);
+    cache->bytes += bytes;
+
+    return index;
+}
+
+static bool insert_record(DirIndexCache *cache, DirIndex *index, bool is_long, uint32_t hash,
+                          const char name[11], uint32_t cluster, uint32_t slot) {
+    DirIndexEntry *entry = probe(index, is_long, hash, name, true);
+    if (entry->state != SLOT_LIVE) {
+        if ((index->used + 1) * 4 > (index->slot_mask + 1) * 3) {
+            if (!rehash(cache, index)) {
+                return false;
+            }
+            entry = probe(index, is_long, hash, name, true);
+        }
+
+        if (entry->state == SLOT_EMPTY) {
+            index->used++;
+        }
+        index->live++;
+        memcpy(entry->name, name, 11);
+        entry->is_long = is_long;
+        entry->hash = hash;
+        entry->state = SLOT_LIVE;
+    }
+
+    entry->cluster = cluster;
+    entry->slot = slot;
+    return true;
+}
+
+bool dirindex_insert(DirIndexCache *cache, DirIndex *index, const char name[11],
+                     uint32_t cluster, uint32_t slot) {
+    if (!cache || !index || !name) {
+        return false;
+    }
+
+    return insert_record(cache, index, false, name_hash(name), name, cluster, slot);
+}
+
+bool dirindex_lookup(DirIndex *index, const char name[11], uint32_t *cluster, uint32_t *slot) {
+    if (!index || !name) {
+        return false;
+    }
+
+    DirIndexEntry *entry = probe(index, false, name_hash(name), name, false);
+    if (!entry) {
+        return false;
+    }
+
+    if (cluster) {
+        *cluster = entry->cluster;
+    }
+    if (slot) {
+        *slot = entry->slot;
+    }
+    return true;
+}
+
+void dirindex_remove(DirIndex *index, const char name[11]) {
+    if (!index || !name) {
+        return;
+    }
+
+    DirIndexEntry *entry = probe(index, false, name_hash(name), name, false);
+    if (!entry) {
+        return;
+    }
+
+    entry->state = SLOT_DELETED;
+    index->live--;
+
+    index->has_free_hint = true;
+    index->free_cluster = entry->cluster;
+    index->free_slot = entry->slot;
+}
+
+bool dirindex_insert_long(DirIndexCache *cache, DirIndex *index, uint32_t hash, const char name[11],
+                          uint32_t cluster, uint32_t slot) {
+    if (!cache || !index || !name) {
+        return false;
+    }
+
+    return insert_record(cache, index, true, hash, name, cluster, slot);
+}
+
+bool dirindex_next_long(DirIndex *index, uint32_t hash, uint32_t *cursor, uint32_t *cluster, uint32_t *slot) {
+    if (!index || !cursor) {
+        return false;
+    }
+
+    while (*cursor <= index->slot_mask) {
+        DirIndexEntry *entry = &index->slots[(hash + *cursor) & index->slot_mask];
+        (*cursor)++;
+
+        if (entry->state == SLOT_EMPTY) {
+            break;
+        }
+        if (entry->state == SLOT_LIVE && entry->is_long && entry->hash == hash) {
+            if (cluster) {
+                *cluster = entry->cluster;
+            }
+            if (slot) {
+                *slot = entry->slot;
+            }
+            return true;
+        }
+    }
+
+    *cursor = index->slot_mask + 1;
+    return false;
+}
+
+void dirindex_remove_long(DirIndex *index, uint32_t hash, const char name[11]) {
+    if (!index || !name) {
+        return;
+    }
+
+    DirIndexEntry *entry = probe(index, true, hash, name, false);
+    if (entry) {
+        entry->state = SLOT_DELETED;
+        index->live--;
+    }
+}
+
+void dirindex_drop(DirIndexCache *cache, uint32_t dir_cluster) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    DirIndex *index = cache->buckets[dir_hash(cache, dir_cluster)];
+    while (index && index->dir_cluster != dir_cluster) {
+        index = index->hash_next;
+    }
+
+    if (index) {
+        index_free(cache, index);
+    }
+}
+
+void dirindex_set_budget(DirIndexCache *cache, size_t budget_bytes) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    cache->budget = budget_bytes;
+    make_room(cache, NULL, 0);
+}
+
+void dirindex_clear(DirIndexCache *cache) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    while (cache->lru_head) {
+        index_free(cache, cache->lru_head);
+    }
+}
+
+void dirindex_destroy(DirIndexCache *cache) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    dirindex_clear(cache);
+    free(cache->buckets);
+    cache->buckets = NULL;
+}
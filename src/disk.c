@@ -1,146 +1,419 @@
+#define _GNU_SOURCE
 #include "../include/disk.h"
+#include "../include/trace.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ZERO_CHUNK_SIZE (4 * 1024 * 1024)
+#define ZERO_MAX_THREADS 64
+
+typedef struct {
+    Disk *disk;
+    const uint8_t *zeros;
+    uint64_t offset;
+    uint64_t length;
+    uint64_t syscalls;
+    bool success;
+} ZeroJob;
+
+static bool pread_full(int fd, void *buffer, size_t length, off_t offset, uint64_t *syscalls) {
+    uint8_t *p = (uint8_t*)buffer;
+
+    while (length > 0) {
+        ssize_t n = pread(fd, p, length, offset);
+        (*syscalls)++;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        length -= (size_t)n;
+        offset += n;
+    }
+
+    return true;
+}
+
+static bool pwrite_full(int fd, const void *buffer, size_t length, off_t offset, uint64_t *syscalls) {
+    const uint8_t *p = (const uint8_t*)buffer;
+
+    while (length > 0) {
+        ssize_t n = pwrite(fd, p, length, offset);
+        (*syscalls)++;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        length -= (size_t)n;
+        offset += n;
+    }
+
+    return true;
+}
+
+static void count_request(Disk *disk, uint64_t sector, uint64_t sector_count) {
+    if (sector != disk->next_sector) {
+        disk->stats.seeks++;
+    }
+    disk->next_sector = sector + sector_count;
+}
+
+static bool disk_map(Disk *disk) {
+    if (disk->total_sectors == 0 || disk->total_sectors > SIZE_MAX / DISK_SECTOR_SIZE) {
+        return false;
+    }
+
+    size_t map_size = (size_t)disk->total_sectors * DISK_SECTOR_SIZE;
+
+    void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, disk->fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    disk->map = (uint8_t*)map;
+    return true;
+}
 
 bool disk_init(Disk *disk, const char *filename) {
+    return disk_init_with_options(disk, filename, NULL);
+}
+
+bool disk_init_with_options(Disk *disk, const char *filename, const DiskOptions *options) {
 
     if (!disk || !filename) {
         return false;
     }
 
+    disk->backend = options ? options->backend : DISK_BACKEND_FILE;
+    disk->map = NULL;
+    memset(&disk->stats, 0, sizeof(DiskStats));
+    disk->next_sector = 0;
+
     disk->filename = strdup(filename);
     if (!disk->filename) {
         return false;
     }
 
-    disk->file = fopen(disk->filename, "r+b");
-    if (!disk->file) {
-        disk->file = fopen(disk->filename, "w+b");
-        if (!disk->file) {
+    disk->fd = open(disk->filename, O_RDWR);
+    if (disk->fd < 0) {
+        disk->fd = open(disk->filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (disk->fd < 0) {
             free(disk->filename);
             disk->filename = NULL;
             return false;
         }
 
-        uint8_t *empty_sector = calloc(1, DISK_SECTOR_SIZE);
-        if (!empty_sector) {
-            fclose(disk->file);
+        uint64_t size = options && options->size ? options->size : DISK_DEFAULT_SIZE;
+        uint64_t sectors = size / DISK_SECTOR_SIZE;
+
+        if (sectors == 0 || sectors > (uint64_t)INT64_MAX / DISK_SECTOR_SIZE
+            || ftruncate(disk->fd, (off_t)(sectors * DISK_SECTOR_SIZE)) != 0) {
+            close(disk->fd);
+            unlink(disk->filename);
+            disk->fd = -1;
             free(disk->filename);
             disk->filename = NULL;
             return false;
         }
 
-        uint32_t sectors = DISK_DEFAULT_SIZE / DISK_SECTOR_SIZE;
-
-        for (uint32_t i = 0; i < sectors; i++) {
-            if (fwrite(empty_sector, DISK_SECTOR_SIZE, 1, disk->file) != 1) {
-                free(empty_sector);
-                fclose(disk->file);
-                free(disk->filename);
-                disk->filename = NULL;
-                return false;
-            }
-        }
-        free(empty_sector);
-
-        fflush(disk->file);
         disk->total_sectors = sectors;
     } else {
-        fseek(disk->file, 0, SEEK_END);
-        long file_size = ftell(disk->file);
-        fseek(disk->file, 0, SEEK_SET);
+        struct stat st;
+        if (fstat(disk->fd, &st) != 0) {
+            close(disk->fd);
+            disk->fd = -1;
+            free(disk->filename);
+            disk->filename = NULL;
+            return false;
+        }
+
+        disk->total_sectors = (uint64_t)st.st_size / DISK_SECTOR_SIZE;
+    }
 
-        disk->total_sectors = file_size / DISK_SECTOR_SIZE;
+    if (disk->backend == DISK_BACKEND_MMAP && !disk_map(disk)) {
+        close(disk->fd);
+        disk->fd = -1;
+        free(disk->filename);
+        disk->filename = NULL;
+        return false;
     }
 
     return true;
 }
 
-bool disk_read_sector(Disk *disk, uint32_t sector_num, void *buffer) {
-    if (!disk || !disk->file || !buffer
+bool disk_read_sector(Disk *disk, uint64_t sector_num, void *buffer) {
+    TRACE_FUNCTION();
+    if (!disk || disk->fd < 0 || !buffer
               || sector_num >= disk->total_sectors) {
         return false;
     }
 
-    if (fseek(disk->file, sector_num * DISK_SECTOR_SIZE, SEEK_SET) != 0) {
-        return false;
+    disk->stats.read_ops++;
+    disk->stats.sectors_read++;
+    count_request(disk, sector_num, 1);
+
+    if (disk->map) {
+        memcpy(buffer, disk->map + (size_t)sector_num * DISK_SECTOR_SIZE, DISK_SECTOR_SIZE);
+        return true;
     }
 
-    size_t read_count = fread(buffer, DISK_SECTOR_SIZE, 1, disk->file);
-    return read_count == 1;
+    return pread_full(disk->fd, buffer, DISK_SECTOR_SIZE, (off_t)sector_num * DISK_SECTOR_SIZE,
+                      &disk->stats.syscalls);
 }
 
-bool disk_write_sector(Disk *disk, uint32_t sector_num, const void *buffer) {
+bool disk_write_sector(Disk *disk, uint64_t sector_num, const void *buffer) {
+    TRACE_FUNCTION();
 
-    if (!disk || !disk->file || !buffer
+    if (!disk || disk->fd < 0 || !buffer
               || sector_num >= disk->total_sectors) {
         return false;
     }
 
-    if (fseek(disk->file, sector_num * DISK_SECTOR_SIZE, SEEK_SET) != 0) {
+    disk->stats.write_ops++;
+    disk->stats.sectors_written++;
+    count_request(disk, sector_num, 1);
+
+    if (disk->map) {
+        memcpy(disk->map + (size_t)sector_num * DISK_SECTOR_SIZE, buffer, DISK_SECTOR_SIZE);
+        return true;
+    }
+
+    return pwrite_full(disk->fd, buffer, DISK_SECTOR_SIZE, (off_t)sector_num * DISK_SECTOR_SIZE,
+                       &disk->stats.syscalls);
+}
+
+bool disk_read_sectors(Disk *disk, uint64_t start_sector, uint32_t sector_count, void *buffer) {
+    TRACE_FUNCTION();
+    if (!disk || disk->fd < 0 || !buffer
+              || start_sector >= disk->total_sectors
+              || sector_count > disk->total_sectors - start_sector) {
         return false;
     }
 
-    size_t write_count = fwrite(buffer, DISK_SECTOR_SIZE, 1, disk->file);
+    disk->stats.read_ops++;
+    disk->stats.sectors_read += sector_count;
+    count_request(disk, start_sector, sector_count);
 
-    if (write_count == 1) {
-        fflush(disk->file);
+    if (disk->map) {
+        memcpy(buffer, disk->map + (size_t)start_sector * DISK_SECTOR_SIZE,
+               (size_t)sector_count * DISK_SECTOR_SIZE);
         return true;
     }
-    return false;
+
+    return pread_full(disk->fd, buffer, (size_t)sector_count * DISK_SECTOR_SIZE,
+                      (off_t)start_sector * DISK_SECTOR_SIZE, &disk->stats.syscalls);
 }
 
-bool disk_read_sectors(Disk *disk, uint32_t start_sector, uint32_t sector_count, void *buffer) {
-    if (!disk || !disk->file || !buffer
-              || start_sector >= disk->total_sectors
-              || start_sector + sector_count > disk->total_sectors) {
+bool disk_write_sectors(Disk *disk, uint64_t start_sector, uint32_t sector_count, const void *buffer) {
+    TRACE_FUNCTION();
+    if (!disk || disk->fd < 0 || !buffer
+        || start_sector >= disk->total_sectors
+        || sector_count > disk->total_sectors - start_sector) {
         return false;
     }
 
-    if (fseek(disk->file, start_sector * DISK_SECTOR_SIZE, SEEK_SET) != 0) {
-        return false;
+    disk->stats.write_ops++;
+    disk->stats.sectors_written += sector_count;
+    count_request(disk, start_sector, sector_count);
+
+    if (disk->map) {
+        memcpy(disk->map + (size_t)start_sector * DISK_SECTOR_SIZE, buffer,
+               (size_t)sector_count * DISK_SECTOR_SIZE);
+        return true;
     }
 
-    size_t read_count = fread(buffer, DISK_SECTOR_SIZE, sector_count, disk->file);
-    return read_count == sector_count;
+    return pwrite_full(disk->fd, buffer, (size_t)sector_count * DISK_SECTOR_SIZE,
+                       (off_t)start_sector * DISK_SECTOR_SIZE, &disk->stats.syscalls);
+}
+
+static void *zero_worker(void *arg) {
+    ZeroJob *job = (ZeroJob*)arg;
+
+    job->success = true;
+    while (job->length > 0 && job->success) {
+        size_t chunk = job->length < ZERO_CHUNK_SIZE ? (size_t)job->length : ZERO_CHUNK_SIZE;
+        if (job->disk->map) {
+            memset(job->disk->map + job->offset, 0, chunk);
+        } else {
+            job->success = pwrite_full(job->disk->fd, job->zeros, chunk, (off_t)job->offset, &job->syscalls);
+        }
+        job->offset += chunk;
+        job->length -= chunk;
+    }
+    return NULL;
 }
 
-bool disk_write_sectors(Disk *disk, uint32_t start_sector, uint32_t sector_count, const void *buffer) {
-    if (!disk || !disk->file || !buffer
+bool disk_write_zeros(Disk *disk, uint64_t start_sector, uint64_t sector_count, uint32_t threads) {
+    TRACE_FUNCTION();
+    if (!disk || disk->fd < 0
         || start_sector >= disk->total_sectors
-        || start_sector + sector_count > disk->total_sectors) {
+        || sector_count > disk->total_sectors - start_sector) {
         return false;
     }
 
-    if (fseek(disk->file, start_sector * DISK_SECTOR_SIZE, SEEK_SET) != 0) {
+    disk->stats.write_ops++;
+    disk->stats.sectors_written += sector_count;
+    count_request(disk, start_sector, sector_count);
+
+    uint64_t length = sector_count * DISK_SECTOR_SIZE;
+    uint64_t chunks = (length + ZERO_CHUNK_SIZE - 1) / ZERO_CHUNK_SIZE;
+    if (threads == 0) {
+        threads = 1;
+    }
+    if (threads > ZERO_MAX_THREADS) {
+        threads = ZERO_MAX_THREADS;
+    }
+    if (threads > chunks) {
+        threads = chunks > 0 ? (uint32_t)chunks : 1;
+    }
+
+    uint8_t *zeros = NULL;
+    if (!disk->map) {
+        zeros = (uint8_t*)calloc(1, ZERO_CHUNK_SIZE);
+        if (!zeros) {
+            return false;
+        }
+    }
+
+    ZeroJob jobs[ZERO_MAX_THREADS];
+    pthread_t workers[ZERO_MAX_THREADS];
+    bool started[ZERO_MAX_THREADS] = { false };
+    uint64_t chunks_per_job = chunks / threads;
+    uint64_t offset = start_sector * DISK_SECTOR_SIZE;
+    uint64_t end = offset + length;
+
+    for (uint32_t i = 0; i < threads; i++) {
+        uint64_t job_length = (chunks_per_job + (i < chunks % threads ? 1 : 0)) * ZERO_CHUNK_SIZE;
+        if (job_length > end - offset) {
+            job_length = end - offset;
+        }
+        jobs[i] = (ZeroJob){ disk, zeros, offset, job_length, 0, false };
+        offset += job_length;
+
+        if (i > 0) {
+            started[i] = pthread_create(&workers[i], NULL, zero_worker, &jobs[i]) == 0;
+        }
+        if (!started[i]) {
+            zero_worker(&jobs[i]);
+        }
+    }
+
+    bool success = true;
+    for (uint32_t i = 0; i < threads; i++) {
+        if (started[i]) {
+            pthread_join(workers[i], NULL);
+        }
+        disk->stats.syscalls += jobs[i].syscalls;
+        success = success && jobs[i].success;
+    }
+
+    free(zeros);
+    return success;
+}
+
+bool disk_zero_range(Disk *disk, uint64_t start_sector, uint64_t sector_count) {
+    TRACE_FUNCTION();
+    if (!disk || disk->fd < 0
+        || start_sector >= disk->total_sectors
+        || sector_count > disk->total_sectors - start_sector) {
         return false;
     }
 
-    size_t write_count = fwrite(buffer, DISK_SECTOR_SIZE, sector_count, disk->file);
+#ifdef __linux__
+    off_t offset = (off_t)(start_sector * DISK_SECTOR_SIZE);
+    off_t length = (off_t)(sector_count * DISK_SECTOR_SIZE);
 
-    if (write_count == sector_count) {
-        fflush(disk->file);
+    disk->stats.syscalls++;
+    if (fallocate(disk->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length) == 0) {
+        disk->stats.sectors_zeroed += sector_count;
         return true;
     }
 
-    return false;
+    disk->stats.syscalls++;
+    if (fallocate(disk->fd, FALLOC_FL_ZERO_RANGE | FALLOC_FL_KEEP_SIZE, offset, length) == 0) {
+        disk->stats.sectors_zeroed += sector_count;
+        return true;
+    }
+#endif
+
+    return disk_write_zeros(disk, start_sector, sector_count, 1);
+}
+
+void *disk_sector_ptr(Disk *disk, uint64_t start_sector, uint32_t sector_count) {
+    if (!disk || !disk->map
+              || start_sector >= disk->total_sectors
+              || sector_count > disk->total_sectors - start_sector) {
+        return NULL;
+    }
+
+    return disk->map + (size_t)start_sector * DISK_SECTOR_SIZE;
+}
+
+bool disk_sync(Disk *disk) {
+    TRACE_FUNCTION();
+    if (!disk || disk->fd < 0) {
+        return false;
+    }
+
+    disk->stats.syncs++;
+
+    if (disk->map) {
+        disk->stats.syscalls++;
+        if (msync(disk->map, (size_t)disk->total_sectors * DISK_SECTOR_SIZE, MS_SYNC) != 0) {
+            return false;
+        }
+    }
+
+    disk->stats.syscalls++;
+    return fsync(disk->fd) == 0;
 }
 
-uint32_t disk_get_total_sectors(Disk *disk) {
+uint64_t disk_get_total_sectors(Disk *disk) {
     if (!disk) {
         return 0;
     }
     return disk->total_sectors;
 }
 
+void disk_get_stats(const Disk *disk, DiskStats *stats) {
+    if (!disk || !stats) {
+        return;
+    }
+    *stats = disk->stats;
+}
+
+void disk_reset_stats(Disk *disk) {
+    if (!disk) {
+        return;
+    }
+    memset(&disk->stats, 0, sizeof(DiskStats));
+}
+
 void disk_close(Disk *disk) {
     if (!disk) {
         return;
     }
 
-    if (disk->file) {
-        fclose(disk->file);
-        disk->file = NULL;
+    if (disk->map) {
+        munmap(disk->map, (size_t)disk->total_sectors * DISK_SECTOR_SIZE);
+        disk->map = NULL;
+    }
+
+    if (disk->fd >= 0) {
+        close(disk->fd);
+        disk->fd = -1;
     }
 
     if (disk->filename) {
@@ -149,4 +422,4 @@ void disk_close(Disk *disk) {
     }
 
     disk->total_sectors = 0;
-}
\ No newline at end of file
+}
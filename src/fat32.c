@@ -1,6 +1,11 @@
+
 #include "../include/fat32.h"
 #include "../include/utils.h"
+#include "../include/trace.h"
+#include "../include/log.h"
 
+#include <ctype.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -27,890 +32,2933 @@ static uint16_t get_fat_time() {
     return (hour << 11) | (minute << 5) | second;
 }
 
-static int find_entry_by_name(FAT32_FileSystem *fs,
-    uint32_t dir_cluster, const char *name) {
-    uint8_t *cluster_data = (uint8_t*)malloc(fs->bytes_per_cluster);
-    if (!cluster_data) {
-        return -1;
-    }
-
-    char short_name[11];
-    convert_to_short_name(short_name, name);
+static void init_dot_entries(FAT32_DirEntry *dir_entries, uint32_t self_cluster, uint32_t parent_cluster) {
+    memset(dir_entries[0].DIR_Name, ' ', 11);
+    dir_entries[0].DIR_Name[0] = '.';
+    dir_entries[0].DIR_Attr = FAT32_ATTR_DIRECTORY;
+    dir_entries[0].DIR_CrtTime = get_fat_time();
+    dir_entries[0].DIR_CrtDate = get_fat_date();
+    dir_entries[0].DIR_LstAccDate = get_fat_date();
+    dir_entries[0].DIR_WrtTime = get_fat_time();
+    dir_entries[0].DIR_WrtDate = get_fat_date();
+    dir_entries[0].DIR_FstClusHI = (self_cluster >> 16) & 0xFFFF;
+    dir_entries[0].DIR_FstClusLO = self_cluster & 0xFFFF;
+    dir_entries[0].DIR_FileSize = 0;
 
-    uint32_t current_cluster = dir_cluster;
-    int entry_index = -1;
-    int current_offset = 0;
+    memset(dir_entries[1].DIR_Name, ' ', 11);
+    dir_entries[1].DIR_Name[0] = '.';
+    dir_entries[1].DIR_Name[1] = '.';
+    dir_entries[1].DIR_Attr = FAT32_ATTR_DIRECTORY;
+    dir_entries[1].DIR_CrtTime = get_fat_time();
+    dir_entries[1].DIR_CrtDate = get_fat_date();
+    dir_entries[1].DIR_LstAccDate = get_fat_date();
+    dir_entries[1].DIR_WrtTime = get_fat_time();
+    dir_entries[1].DIR_WrtDate = get_fat_date();
+    dir_entries[1].DIR_FstClusHI = (parent_cluster >> 16) & 0xFFFF;
+    dir_entries[1].DIR_FstClusLO = parent_cluster & 0xFFFF;
+    dir_entries[1].DIR_FileSize = 0;
+}
 
-    while (current_cluster >= 2 && current_cluster < FAT32_CLUSTER_END) {
-        if (!fat32_read_cluster(fs, current_cluster, cluster_data)) {
-            free(cluster_data);
-            return -1;
+static bool fat_get(FAT32_FileSystem *fs, uint32_t cluster, uint32_t *value) {
+    uint32_t raw;
+    if (fs->fat_map.runs) {
+        if (!fatmap_get(&fs->fat_map, cluster, &raw)) {
+            return false;
         }
+    } else if (!fatcache_get(&fs->fat_cache, cluster, &raw)) {
+        return false;
+    }
 
-        FAT32_DirEntry * entries = (FAT32_DirEntry*)cluster_data;
-        uint32_t entries_per_cluster = fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
-        for (uint32_t i = 0; i < entries_per_cluster; i++) {
-            if (entries[i].DIR_Name[0] == 0x00 || entries[i].DIR_Name[0] == 0xE5) {
-                continue;
-            }
+    *value = raw & 0x0FFFFFFF;
+    return true;
+}
 
-            if (memcmp(entries[i].DIR_Name, short_name, 11) == 0) {
-                entry_index = current_offset + i;
-                break;
-            }
-        }
-        if (entry_index >= 0) {
-            break;
-        }
+static bool fat_set(FAT32_FileSystem *fs, uint32_t cluster, uint32_t value) {
+    if (fs->fat_map.runs) {
+        return fatmap_set(&fs->fat_map, cluster, value & 0x0FFFFFFF);
+    }
 
-        current_cluster = fat32_get_next_cluster(fs, current_cluster);
-        current_offset += entries_per_cluster;
+    uint32_t raw;
+    if (!fatcache_get(&fs->fat_cache, cluster, &raw)) {
+        return false;
     }
 
-    free(cluster_data);
-    return entry_index;
+    return fatcache_set(&fs->fat_cache, cluster, (raw & 0xF0000000) | (value & 0x0FFFFFFF));
 }
 
-static int find_free_entry(FAT32_FileSystem *fs,
-    uint32_t dir_cluster, uint32_t *out_cluster) {
-    uint8_t *cluster_data = (uint8_t*)malloc(fs->bytes_per_cluster);
-    if (!cluster_data) {
-        return -1;
+static void fat_cache_close(FAT32_FileSystem *fs, bool write_back) {
+    if (!write_back) {
+        fatcache_invalidate(&fs->fat_cache);
     }
+    fatcache_destroy(&fs->fat_cache);
 
-    uint32_t current_cluster = dir_cluster;
-    int entry_index = -1;
+    fs->stats.fat_page_hits += fs->fat_cache.hits;
+    fs->stats.fat_page_misses += fs->fat_cache.misses;
+    fs->stats.fat_sectors_written += fs->fat_cache.sectors_written;
+    fs->stats.fat_mirror_syncs += fs->fat_cache.mirror_syncs;
+    fs->stats.fat_mirror_sectors += fs->fat_cache.mirror_sectors;
+    memset(&fs->fat_cache, 0, sizeof(fs->fat_cache));
+}
 
-    while (current_cluster >= 2 && current_cluster < FAT32_CLUSTER_END) {
-        if (!fat32_read_cluster(fs, current_cluster, cluster_data)) {
-            free(cluster_data);
-            return -1;
-        }
-        FAT32_DirEntry *entries = (FAT32_DirEntry*)cluster_data;
-        uint32_t entries_per_cluster = fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
+static bool fat_map_flush(FAT32_FileSystem *fs) {
+    FatMap *map = &fs->fat_map;
+    if (!map->runs) {
+        return true;
+    }
 
-        for (uint32_t i = 0; i < entries_per_cluster; i++) {
-            if (entries[i].DIR_Name[0] == 0x00 || entries[i].DIR_Name[0] == 0xE5) {
-                entry_index = i;
-                *out_cluster = current_cluster;
-                break;
-            }
+    uint32_t entries[FATCACHE_PAGE_ENTRIES];
+    uint32_t entries_per_sector = FATCACHE_PAGE_ENTRIES / FATCACHE_PAGE_SECTORS;
+    bool success = true;
+
+    uint32_t sector = fatmap_next_dirty(map, 0);
+    while (sector < map->sectors) {
+        uint32_t run_start = sector;
+        while (sector < map->sectors && sector - run_start < FATCACHE_PAGE_SECTORS
+               && fatmap_is_dirty(map, sector)) {
+            sector++;
         }
+        uint32_t run_length = sector - run_start;
+        fatmap_read(map, run_start * entries_per_sector, run_length * entries_per_sector, entries);
 
-        if (entry_index >= 0) {
-            break;
+        if (!fatcache_write(&fs->fat_cache, run_start, run_length, entries)) {
+            success = false;
         }
+        sector = fatmap_next_dirty(map, sector);
+    }
 
-        uint32_t next_cluster = fat32_get_next_cluster(fs, current_cluster);
+    if (success) {
+        fatmap_clear_dirty(map);
+    }
+    return success;
+}
 
-        if (next_cluster >= FAT32_CLUSTER_END) {
-            uint32_t new_cluster = fat32_allocate_cluster(fs);
-            if (new_cluster == 0) {
-                free(cluster_data);
-                return -1;
-            }
+static void fat_map_close(FAT32_FileSystem *fs, bool write_back) {
+    if (write_back) {
+        fat_map_flush(fs);
+    }
+    fatmap_destroy(&fs->fat_map);
+}
 
-            memset(cluster_data, 0, fs->bytes_per_cluster);
-            if (!fat32_write_cluster(fs, new_cluster, cluster_data)) {
-                free(cluster_data);
-                return -1;
-            }
+static bool fat_cache_setup(FAT32_FileSystem *fs) {
+    fat_map_close(fs, false);
+    fat_cache_close(fs, false);
+    return fatcache_init(&fs->fat_cache, &fs->disk, fs->bootSector.BPB_RsvdSecCnt, fs->fat_size,
+                         fs->bootSector.BPB_NumFATs, fs->fat_cache_budget);
+}
 
-            fat32_set_cluster_value(fs, current_cluster, new_cluster);
+#define FREE_BLOCK_WORDS (FAT32_FREE_BLOCK_CLUSTERS / 64)
 
-            fat32_set_cluster_value(fs, new_cluster, FAT32_CLUSTER_END);
+static uint32_t cluster_limit(FAT32_FileSystem *fs) {
+    return fs->data_cluster_count + 2;
+}
 
-            entry_index = 0;
-            *out_cluster = new_cluster;
-            break;
-        }
-        current_cluster = next_cluster;
-    }
-    free(cluster_data);
-    return entry_index;
+static void free_index_destroy(FAT32_FileSystem *fs) {
+    free(fs->free_map);
+    free(fs->free_block_count);
+    fs->free_map = NULL;
+    fs->free_block_count = NULL;
+    fs->free_block_total = 0;
 }
 
-static bool parse_path(const char *path, char components[][13], int *component_count) {
-    if (!path || path[0] != '/')
+static bool free_index_init(FAT32_FileSystem *fs) {
+    free_index_destroy(fs);
+
+    uint32_t limit = cluster_limit(fs);
+    fs->free_block_total = (limit + FAT32_FREE_BLOCK_CLUSTERS - 1) / FAT32_FREE_BLOCK_CLUSTERS;
+    fs->free_map = (uint64_t*)calloc((size_t)fs->free_block_total * FREE_BLOCK_WORDS, sizeof(uint64_t));
+    fs->free_block_count = (uint32_t*)malloc((size_t)fs->free_block_total * sizeof(uint32_t));
+    if (!fs->free_map || !fs->free_block_count) {
+        free_index_destroy(fs);
         return false;
+    }
 
-    *component_count = 0;
+    memset(fs->free_block_count, 0xFF, (size_t)fs->free_block_total * sizeof(uint32_t));
+    return true;
+}
 
-    path++;
+static bool free_index_load_block(FAT32_FileSystem *fs, uint32_t block) {
+    if (fs->free_block_count[block] != FAT32_FREE_BLOCK_UNKNOWN) {
+        return true;
+    }
 
-    char temp[13];
-    int temp_index = 0;
+    uint32_t first = block * FAT32_FREE_BLOCK_CLUSTERS;
+    uint32_t end = first + FAT32_FREE_BLOCK_CLUSTERS;
+    if (end > cluster_limit(fs)) {
+        end = cluster_limit(fs);
+    }
 
-    while (*path) {
-        if (*path == '/') {
-            if (temp_index > 0) {
-                temp[temp_index] = '\0';
-                strcpy(components[*component_count], temp);
-                (*component_count)++;
-                temp_index = 0;
-            }
-        } else if (temp_index < 12) {
-            temp[temp_index++] = *path;
-        } else {
+    uint32_t block_free = 0;
+    for (uint32_t cluster = first < 2 ? 2 : first; cluster < end; cluster++) {
+        uint32_t value;
+        if (!fat_get(fs, cluster, &value)) {
+            memset(fs->free_map + (size_t)block * FREE_BLOCK_WORDS, 0, FREE_BLOCK_WORDS * sizeof(uint64_t));
             return false;
         }
-
-        path++;
-    }
-
-    if (temp_index > 0) {
-        temp[temp_index] = '\0';
-        strcpy(components[*component_count], temp);
-        (*component_count)++;
+        if (value == FAT32_CLUSTER_FREE) {
+            fs->free_map[cluster / 64] |= 1ull << (cluster % 64);
+            block_free++;
+        }
     }
 
+    fs->free_block_count[block] = block_free;
     return true;
 }
-#if 0
-bool fat32_init(FAT32_FileSystem *fs, const char *filename) {
-    if (!fs || !filename) {
-        return false;
-    }
-
-    fs->fat = NULL;
 
-    if (!disk_init(&fs->disk, filename)) {
-        return false;
+static void free_index_set(FAT32_FileSystem *fs, uint32_t cluster, bool is_free) {
+    uint32_t block = cluster / FAT32_FREE_BLOCK_CLUSTERS;
+    if (!fs->free_map || fs->free_block_count[block] == FAT32_FREE_BLOCK_UNKNOWN) {
+        return;
     }
 
-    strcpy(fs->current_path, "/");
+    uint64_t bit = 1ull << (cluster % 64);
+    uint64_t *word = &fs->free_map[cluster / 64];
+    bool was_free = (*word & bit) != 0;
 
-    fseek(fs->disk.file, 0, SEEK_END);
-    long file_size = ftell(fs->disk.file);
-    fseek(fs->disk.file, 0, SEEK_SET);
+    if (was_free == is_free) {
+        return;
+    }
 
-    if (file_size > 1024 * 1024) {
-        printf("Debug: File exists with size %ld bytes, assuming formatted\n", file_size);
-        fs->is_formatted = true;
+    if (is_free) {
+        *word |= bit;
+        fs->free_block_count[block]++;
     } else {
-        printf("Debug: Small or empty file, not formatted\n");
-        fs->is_formatted = false;
+        *word &= ~bit;
+        fs->free_block_count[block]--;
     }
+}
 
-    if (fat32_read_boot_sector(fs)) {
-        fs->sectors_per_cluster = fs->bootSector.BPB_SecPerClus;
-        fs->fat_size = fs->bootSector.BPB_FATSz32;
-        fs->bytes_per_cluster = fs->bootSector.BPB_BytesPerSec * fs->sectors_per_cluster;
-        fs->first_data_sector = fs->bootSector.BPB_RsvdSecCnt +
-                                (fs->bootSector.BPB_NumFATs * fs->fat_size);
-        uint32_t total_sectors = fs->bootSector.BPB_TotSec32;
-        uint32_t data_sectors = total_sectors - fs->first_data_sector;
-        fs->data_cluster_count = data_sectors / fs->sectors_per_cluster;
-        fs->current_dir_cluster = fs->bootSector.BPB_RootClus;
+static bool free_index_build(FAT32_FileSystem *fs) {
+    uint32_t free_count = 0;
+    if (fs->fat_map.runs) {
+        free_count = fatmap_count_free(&fs->fat_map);
+    } else {
+        if (!free_index_init(fs)) {
+            return false;
+        }
 
-        if (fs->is_formatted) {
-            fat32_read_fat(fs);
+        for (uint32_t block = 0; block < fs->free_block_total; block++) {
+            if (!free_index_load_block(fs, block)) {
+                free_index_destroy(fs);
+                return false;
+            }
+            free_count += fs->free_block_count[block];
         }
     }
 
+    if (fs->free_count != free_count) {
+        fs->free_count = free_count;
+        fs->fsinfo_dirty = true;
+    }
     return true;
 }
-#endif
-bool fat32_init(FAT32_FileSystem *fs, const char *filename) {
-    if (!fs || !filename) {
-        return false;
-    }
 
-    fs->fat = NULL;
-    fs->is_formatted = false;
+static uint32_t free_index_scan_block(FAT32_FileSystem *fs, uint32_t block, uint32_t from) {
+    uint32_t first_word = block * FREE_BLOCK_WORDS;
+    uint32_t word = from / 64;
+    uint64_t bits = fs->free_map[word] & (~0ull << (from % 64));
 
-    if (!disk_init(&fs->disk, filename)) {
-        return false;
+    while (true) {
+        if (bits) {
+            uint32_t cluster = word * 64 + (uint32_t)__builtin_ctzll(bits);
+            return cluster < cluster_limit(fs) ? cluster : 0;
+        }
+        word++;
+        if (word >= first_word + FREE_BLOCK_WORDS) {
+            return 0;
+        }
+        bits = fs->free_map[word];
     }
+}
 
-    strcpy(fs->current_path, "/");
-
-    fseek(fs->disk.file, 0, SEEK_END);
-    long file_size = ftell(fs->disk.file);
-    fseek(fs->disk.file, 0, SEEK_SET);
-
-    if (file_size < 1024) {
-        printf("Debug: File is too small, not formatted\n");
-        return true;
+static uint32_t free_index_find(FAT32_FileSystem *fs) {
+    if (fs->free_count == 0) {
+        return 0;
     }
 
-    if (!fat32_read_boot_sector(fs)) {
-        printf("Debug: Failed to read boot sector\n");
-        return true;
+    uint32_t limit = cluster_limit(fs);
+    uint32_t start = fs->next_free;
+    if (start < 2 || start >= limit) {
+        start = 2;
     }
 
-    if (fs->bootSector.BootSignature == FAT32_SIGNATURE &&
-        fs->bootSector.BPB_SecPerClus != 0 &&
-        strncmp(fs->bootSector.BS_FilSysType, "FAT32   ", 8) == 0) {
+    if (fs->fat_map.runs) {
+        uint32_t cluster = fatmap_find(&fs->fat_map, start, limit, true);
+        if (cluster < limit) {
+            return cluster;
+        }
+        cluster = fatmap_find(&fs->fat_map, 2, start, true);
+        return cluster < start ? cluster : 0;
+    }
 
-        fs->is_formatted = true;
-        printf("Debug: Valid FAT32 filesystem detected\n");
+    if (!fs->free_map && !free_index_init(fs)) {
+        return 0;
+    }
 
-        fs->sectors_per_cluster = fs->bootSector.BPB_SecPerClus;
-        fs->fat_size = fs->bootSector.BPB_FATSz32;
-        fs->bytes_per_cluster = fs->bootSector.BPB_BytesPerSec * fs->sectors_per_cluster;
-        fs->first_data_sector = fs->bootSector.BPB_RsvdSecCnt +
-                                (fs->bootSector.BPB_NumFATs * fs->fat_size);
+    uint32_t start_block = start / FAT32_FREE_BLOCK_CLUSTERS;
+    for (uint32_t n = 0; n <= fs->free_block_total; n++) {
+        uint32_t block = (start_block + n) % fs->free_block_total;
+        if (!free_index_load_block(fs, block)) {
+            return 0;
+        }
+        if (fs->free_block_count[block] == 0) {
+            continue;
+        }
 
-        uint32_t total_sectors = fs->bootSector.BPB_TotSec32;
-        uint32_t data_sectors = total_sectors - fs->first_data_sector;
-        fs->data_cluster_count = data_sectors / fs->sectors_per_cluster;
-        fs->current_dir_cluster = fs->bootSector.BPB_RootClus;
+        uint32_t from = block * FAT32_FREE_BLOCK_CLUSTERS;
+        if (n == 0) {
+            from = start;
+        }
 
-        fat32_read_fat(fs);
-    } else {
-        printf("Debug: File exists but is not a valid FAT32 filesystem\n");
-        fs->is_formatted = false;
+        uint32_t cluster = free_index_scan_block(fs, block, from);
+        if (cluster != 0) {
+            return cluster;
+        }
     }
 
-    return true;
+    return 0;
 }
 
-bool fat32_read_boot_sector(FAT32_FileSystem *fs) {
-    if (!fs) {
-        return false;
+static uint32_t free_index_next(FAT32_FileSystem *fs, uint32_t from, uint32_t limit, bool want_free) {
+    if (fs->fat_map.runs) {
+        return fatmap_find(&fs->fat_map, from, limit, want_free);
     }
 
-    return disk_read_sector(&fs->disk, 0, &fs->bootSector);
-}
+    while (from < limit) {
+        uint32_t block = from / FAT32_FREE_BLOCK_CLUSTERS;
+        if (!free_index_load_block(fs, block)) {
+            return limit;
+        }
+        uint32_t block_free = fs->free_block_count[block];
 
-bool fat32_write_boot_sector(FAT32_FileSystem *fs) {
-    if (!fs) {
-        return false;
+        if ((want_free && block_free == 0) || (!want_free && block_free == FAT32_FREE_BLOCK_CLUSTERS)) {
+            from = (block + 1) * FAT32_FREE_BLOCK_CLUSTERS;
+            continue;
+        }
+
+        uint32_t block_end = (block + 1) * FAT32_FREE_BLOCK_CLUSTERS;
+        while (from < block_end && from < limit) {
+            uint64_t bits = fs->free_map[from / 64];
+            if (!want_free) {
+                bits = ~bits;
+            }
+            bits &= ~0ull << (from % 64);
+
+            if (bits) {
+                uint32_t cluster = (from / 64) * 64 + (uint32_t)__builtin_ctzll(bits);
+                return cluster < limit ? cluster : limit;
+            }
+            from = (from / 64 + 1) * 64;
+        }
     }
 
-    return disk_write_sector(&fs->disk, 0, &fs->bootSector);
+    return limit;
 }
 
-bool fat32_check_fs(FAT32_FileSystem *fs) {
-    if (!fs) {
-        printf("Debug: fs is NULL\n");
+static bool fat_map_load(FAT32_FileSystem *fs, bool fresh) {
+    FatMap map;
+    if (!fatmap_init(&map, fs->fat_size)) {
         return false;
     }
 
-    printf("Debug: Boot signature value: 0x%04X, expected: 0x%04X\n",
-       fs->bootSector.BootSignature, FAT32_SIGNATURE);
+    bool success = fatcache_flush(&fs->fat_cache)
+                   && fatcache_get(&fs->fat_cache, 0, &map.head[0])
+                   && fatcache_get(&fs->fat_cache, 1, &map.head[1]);
 
-    if (fs->bootSector.BootSignature == 0) {
-        printf("Debug: Boot signature is 0\n");
-        return false;
+    uint32_t limit = cluster_limit(fs);
+    if (fresh) {
+        success = success && fatmap_append(&map, 1, FAT32_CLUSTER_END)
+                  && fatmap_append(&map, limit - FAT32_ROOTDIR_CLUSTER - 1, FAT32_CLUSTER_FREE);
+    } else {
+        for (uint32_t cluster = 2; success && cluster < limit; cluster++) {
+            uint32_t value;
+            success = fat_get(fs, cluster, &value) && fatmap_append(&map, 1, value);
+        }
     }
 
-    if (strncmp(fs->bootSector.BS_FilSysType, "FAT32   ", 8) != 0) {
-        printf("Debug: Invalid file system type: %.8s (expected FAT32   )\n",
-               fs->bootSector.BS_FilSysType);
+    if (!success) {
+        fatmap_destroy(&map);
         return false;
     }
 
-    if (fs->bootSector.BPB_BytesPerSec != 512 ||
-        fs->bootSector.BPB_SecPerClus == 0 ||
-        fs->bootSector.BPB_NumFATs == 0 ||
-        fs->bootSector.BPB_FATSz32 == 0) {
-        printf("Debug: Invalid BPB parameters: BytesPerSec=%d, SecPerClus=%d, NumFATs=%d, FATSz32=%d\n",
-               fs->bootSector.BPB_BytesPerSec, fs->bootSector.BPB_SecPerClus,
-               fs->bootSector.BPB_NumFATs, fs->bootSector.BPB_FATSz32);
-        return false;
-        }
-
+    fatcache_invalidate(&fs->fat_cache);
+    free_index_destroy(fs);
+    fs->fat_map = map;
+    LOG_DEBUG("Loaded FAT as %u runs (%zu bytes)", map.count, fatmap_memory(&map));
     return true;
 }
 
-bool fat32_read_fat(FAT32_FileSystem *fs) {
-    if (!fs || !fs->is_formatted) {
-        return false;
-    }
-
-    uint32_t fat_size_bytes = fs->fat_size * fs->bootSector.BPB_BytesPerSec;
+typedef struct {
+    uint32_t start;
+    uint32_t length;
+} FreeRun;
 
-    fs->fat = (uint32_t*)malloc(fat_size_bytes);
-    if (!fs->fat) {
-        return false;
+static int compare_runs_by_length(const void *a, const void *b) {
+    const FreeRun *x = (const FreeRun*)a;
+    const FreeRun *y = (const FreeRun*)b;
+    if (x->length != y->length) {
+        return x->length > y->length ? -1 : 1;
     }
+    return x->start < y->start ? -1 : (x->start > y->start);
+}
 
-    uint32_t fat_start_sector = fs->bootSector.BPB_RsvdSecCnt;
-    return disk_read_sectors(&fs->disk, fat_start_sector, fs->fat_size, fs->fat);
+static int compare_runs_by_start(const void *a, const void *b) {
+    const FreeRun *x = (const FreeRun*)a;
+    const FreeRun *y = (const FreeRun*)b;
+    return x->start < y->start ? -1 : (x->start > y->start);
 }
 
-bool fat32_write_fat(FAT32_FileSystem *fs) {
-    if (!fs || !fs->fat ) {
-        return false;
+static bool free_index_find_runs(FAT32_FileSystem *fs, uint32_t count, FreeRun **out_runs, uint32_t *out_count) {
+    uint32_t limit = cluster_limit(fs);
+    uint32_t start = fs->next_free;
+    if (start < 2 || start >= limit) {
+        start = 2;
     }
 
-    uint32_t fat_start_sector = fs->bootSector.BPB_RsvdSecCnt;
-    bool success = disk_write_sectors(&fs->disk, fat_start_sector, fs->fat_size, fs->fat);
+    FreeRun *runs = NULL;
+    uint32_t run_count = 0;
+    uint32_t run_capacity = 0;
+    uint32_t gathered = 0;
 
-    if (success && fs->bootSector.BPB_NumFATs > 1) {
-        for (uint8_t i = 1; i < fs->bootSector.BPB_NumFATs; i++) {
-            uint32_t fat_copy_start = fat_start_sector + (i * fs->fat_size);
-            success = disk_write_sectors(&fs->disk, fat_copy_start, fs->fat_size, fs->fat);
-            if (!success) {
+    for (int pass = 0; pass < 2 && gathered < count; pass++) {
+        uint32_t from = pass == 0 ? start : 2;
+        uint32_t end = pass == 0 ? limit : start;
+
+        while (from < end && gathered < count) {
+            uint32_t run_start = free_index_next(fs, from, end, true);
+            if (run_start >= end) {
                 break;
             }
-        }
-    }
-    return success;
-}
+            uint32_t run_end = free_index_next(fs, run_start, end, false);
+
+            if (run_end - run_start >= count) {
+                free(runs);
+                *out_runs = (FreeRun*)malloc(sizeof(FreeRun));
+                if (!*out_runs) {
+                    return false;
+                }
+                (*out_runs)[0].start = run_start;
+                (*out_runs)[0].length = count;
+                *out_count = 1;
+                return true;
+            }
 
+            if (run_count == run_capacity) {
+                run_capacity = run_capacity ? run_capacity * 2 : 64;
+                FreeRun *grown = (FreeRun*)realloc(runs, run_capacity * sizeof(FreeRun));
+                if (!grown) {
+                    free(runs);
+                    return false;
+                }
+                runs = grown;
+            }
+            runs[run_count].start = run_start;
+            runs[run_count].length = run_end - run_start;
+            run_count++;
+            gathered += run_end - run_start;
 
-uint32_t fat32_get_next_cluster(FAT32_FileSystem *fs, uint32_t cluster) {
-    if (!fs || !fs->fat || !fs->is_formatted || cluster < 2 || cluster >= fs->data_cluster_count + 2) {
-        return FAT32_CLUSTER_END;
+            from = run_end;
+        }
     }
 
-    return fs->fat[cluster] & 0x0FFFFFFF;
-}
+    qsort(runs, run_count, sizeof(FreeRun), compare_runs_by_length);
 
-uint32_t fat32_allocate_cluster(FAT32_FileSystem *fs) {
-    if (!fs || !fs->fat || !fs->is_formatted) {
-        return 0;
+    uint32_t taken = 0;
+    uint32_t used = 0;
+    while (used < run_count && taken < count) {
+        if (runs[used].length > count - taken) {
+            runs[used].length = count - taken;
+        }
+        taken += runs[used].length;
+        used++;
     }
 
-    for (uint32_t i = 2; i < fs->data_cluster_count + 2; i++) {
-        if (fs->fat[i] == FAT32_CLUSTER_FREE) {
-            fs->fat[i] = FAT32_CLUSTER_END;
+    if (taken < count) {
+        free(runs);
+        return false;
+    }
 
-            fat32_write_fat(fs);
+    qsort(runs, used, sizeof(FreeRun), compare_runs_by_start);
+    *out_runs = runs;
+    *out_count = used;
+    return true;
+}
 
-            return i;
+static void release_runs(FAT32_FileSystem *fs, const FreeRun *runs, uint32_t run_count, uint32_t allocated) {
+    for (uint32_t r = 0; r < run_count && allocated > 0; r++) {
+        uint32_t end = runs[r].start + runs[r].length;
+        for (uint32_t cluster = runs[r].start; cluster < end && allocated > 0; cluster++, allocated--) {
+            if (fat_set(fs, cluster, FAT32_CLUSTER_FREE)) {
+                free_index_set(fs, cluster, true);
+                fs->free_count++;
+                fs->stats.clusters_allocated--;
+            }
         }
     }
-
-    return 0;
 }
 
-bool fat32_set_cluster_value(FAT32_FileSystem *fs, uint32_t cluster, uint32_t value) {
-    if (!fs || !fs->fat || !fs->is_formatted || cluster < 2 || cluster >= fs->data_cluster_count + 2) {
-        return false;
+static bool cache_setup(FAT32_FileSystem *fs) {
+    fs->stats.cache_hits += fs->cache.hits;
+    fs->stats.cache_misses += fs->cache.misses;
+    cache_destroy(&fs->cache);
+    fs->cache.hits = 0;
+    fs->cache.misses = 0;
+
+    if (fs->disk.map) {
+        return true;
     }
 
-    fs->fat[cluster] = value & 0x0FFFFFFF;
-    return fat32_write_fat(fs);
+    return cache_init(&fs->cache, &fs->disk, fs->sectors_per_cluster, fs->cache_budget);
 }
 
-uint32_t fat32_sector_for_cluster(FAT32_FileSystem *fs, uint32_t cluster) {
-    if (!fs || cluster < 2 ) {
+static uint8_t *cluster_get(FAT32_FileSystem *fs, uint32_t cluster, bool load) {
+    TRACE_FUNCTION();
+    uint64_t sector = fat32_sector_for_cluster(fs, cluster);
+
+    if (fs->cache.buckets) {
+        return cache_get(&fs->cache, sector, load);
+    }
+
+    if (fs->disk.map) {
+        uint8_t *data = (uint8_t*)disk_sector_ptr(&fs->disk, sector, fs->sectors_per_cluster);
+        if (data && !load) {
+            memset(data, 0, fs->bytes_per_cluster);
+        }
+        return data;
+    }
+
+    uint8_t *data = (uint8_t*)malloc(fs->bytes_per_cluster);
+    if (!data) {
+        return NULL;
+    }
+
+    if (!load) {
+        memset(data, 0, fs->bytes_per_cluster);
+    } else if (!disk_read_sectors(&fs->disk, sector, fs->sectors_per_cluster, data)) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+static bool cluster_put(FAT32_FileSystem *fs, uint32_t cluster, uint8_t *data, bool dirty) {
+    TRACE_FUNCTION();
+    if (fs->cache.buckets) {
+        cache_release(&fs->cache, fat32_sector_for_cluster(fs, cluster), dirty);
+        return true;
+    }
+
+    if (fs->disk.map) {
+        return true;
+    }
+
+    bool success = !dirty || disk_write_sectors(&fs->disk, fat32_sector_for_cluster(fs, cluster),
+                                                fs->sectors_per_cluster, data);
+    free(data);
+    return success;
+}
+
+static bool is_unused_entry(const FAT32_DirEntry *entry) {
+    return (uint8_t)entry->DIR_Name[0] == 0x00 || (uint8_t)entry->DIR_Name[0] == 0xE5;
+}
+
+#define LFN_MAX_ENTRIES ((FAT32_LFN_MAX_CHARS + FAT32_LFN_CHARS_PER_ENTRY - 1) / FAT32_LFN_CHARS_PER_ENTRY)
+
+typedef struct {
+    uint16_t units[LFN_MAX_ENTRIES * FAT32_LFN_CHARS_PER_ENTRY];
+    uint32_t entries;
+    uint32_t next;
+    uint8_t checksum;
+    uint32_t cluster;
+    uint32_t slot;
+} LongNameRun;
+
+static bool is_lfn_entry(const FAT32_DirEntry *entry) {
+    return (entry->DIR_Attr & 0x3F) == FAT32_ATTR_LFN;
+}
+
+static void lfn_run_reset(LongNameRun *run) {
+    run->entries = 0;
+    run->next = 0;
+}
+
+static void lfn_run_add(LongNameRun *run, const FAT32_DirEntry *entry, uint32_t cluster, uint32_t slot) {
+    const FAT32_LFNEntry *lfn = (const FAT32_LFNEntry*)entry;
+    uint32_t ordinal = lfn->LDIR_0rd & 0x1F;
+
+    if (lfn->LDIR_0rd & FAT32_LFN_LAST_ENTRY) {
+        if (ordinal == 0 || ordinal > LFN_MAX_ENTRIES) {
+            lfn_run_reset(run);
+            return;
+        }
+        run->entries = ordinal;
+        run->checksum = lfn->LDIR_Chksum;
+        run->cluster = cluster;
+        run->slot = slot;
+    } else if (run->next == 0 || ordinal != run->next || lfn->LDIR_Chksum != run->checksum) {
+        lfn_run_reset(run);
+        return;
+    }
+
+    const uint8_t *raw = (const uint8_t*)lfn;
+    uint16_t *units = run->units + (ordinal - 1) * FAT32_LFN_CHARS_PER_ENTRY;
+    memcpy(units, raw + offsetof(FAT32_LFNEntry, LDIR_Name1), 5 * sizeof(uint16_t));
+    memcpy(units + 5, raw + offsetof(FAT32_LFNEntry, LDIR_Name2), 6 * sizeof(uint16_t));
+    memcpy(units + 11, raw + offsetof(FAT32_LFNEntry, LDIR_Name3), 2 * sizeof(uint16_t));
+    run->next = ordinal - 1;
+}
+
+static bool lfn_run_complete(const LongNameRun *run, const FAT32_DirEntry *entry, size_t *length) {
+    if (run->entries == 0 || run->next != 0 || run->checksum != lfn_checksum(entry->DIR_Name)) {
+        return false;
+    }
+
+    size_t n = run->entries * FAT32_LFN_CHARS_PER_ENTRY;
+    for (size_t i = 0; i < n; i++) {
+        if (run->units[i] == 0x0000) {
+            n = i;
+            break;
+        }
+    }
+
+    if (n == 0 || n > FAT32_LFN_MAX_CHARS) {
+        return false;
+    }
+    *length = n;
+    return true;
+}
+
+static void lfn_fill_entry(FAT32_LFNEntry *lfn, const uint16_t *units, size_t length,
+                           uint32_t ordinal, bool last, uint8_t checksum) {
+    uint16_t chars[FAT32_LFN_CHARS_PER_ENTRY];
+    size_t first = (ordinal - 1) * FAT32_LFN_CHARS_PER_ENTRY;
+    for (size_t i = 0; i < FAT32_LFN_CHARS_PER_ENTRY; i++) {
+        if (first + i < length) {
+            chars[i] = units[first + i];
+        } else {
+            chars[i] = first + i == length ? 0x0000 : 0xFFFF;
+        }
+    }
+
+    uint8_t *raw = (uint8_t*)lfn;
+    memset(raw, 0, sizeof(FAT32_LFNEntry));
+    lfn->LDIR_0rd = (uint8_t)(ordinal | (last ? FAT32_LFN_LAST_ENTRY : 0));
+    lfn->LDIR_Attr = FAT32_ATTR_LFN;
+    lfn->LDIR_Chksum = checksum;
+    memcpy(raw + offsetof(FAT32_LFNEntry, LDIR_Name1), chars, 5 * sizeof(uint16_t));
+    memcpy(raw + offsetof(FAT32_LFNEntry, LDIR_Name2), chars + 5, 6 * sizeof(uint16_t));
+    memcpy(raw + offsetof(FAT32_LFNEntry, LDIR_Name3), chars + 11, 2 * sizeof(uint16_t));
+}
+
+static bool dir_next_slot(FAT32_FileSystem *fs, uint32_t *cluster, uint32_t *slot) {
+    if (++(*slot) < fs->bytes_per_cluster / sizeof(FAT32_DirEntry)) {
+        return true;
+    }
+
+    *slot = 0;
+    *cluster = fat32_get_next_cluster(fs, *cluster);
+    return *cluster >= 2 && *cluster < FAT32_CLUSTER_END;
+}
+
+static bool read_dir_entry(FAT32_FileSystem *fs, uint32_t cluster, int index, FAT32_DirEntry *out) {
+    uint8_t *cluster_data = cluster_get(fs, cluster, true);
+    if (!cluster_data) {
+        return false;
+    }
+
+    memcpy(out, cluster_data + (size_t)index * sizeof(FAT32_DirEntry), sizeof(FAT32_DirEntry));
+    cluster_put(fs, cluster, cluster_data, false);
+    return true;
+}
+
+static bool read_long_name(FAT32_FileSystem *fs, uint32_t cluster, uint32_t slot, LongNameRun *run,
+                           size_t *length, uint32_t *entry_cluster, uint32_t *entry_slot) {
+    lfn_run_reset(run);
+
+    for (uint32_t i = 0; i <= LFN_MAX_ENTRIES; i++) {
+        FAT32_DirEntry entry;
+        if (!read_dir_entry(fs, cluster, (int)slot, &entry) || is_unused_entry(&entry)) {
+            return false;
+        }
+
+        if (!is_lfn_entry(&entry)) {
+            if (!lfn_run_complete(run, &entry, length)) {
+                return false;
+            }
+            *entry_cluster = cluster;
+            *entry_slot = slot;
+            return true;
+        }
+
+        if (i > 0 && (((const FAT32_LFNEntry*)&entry)->LDIR_0rd & FAT32_LFN_LAST_ENTRY)) {
+            return false;
+        }
+        lfn_run_add(run, &entry, cluster, slot);
+        if (run->entries == 0 || !dir_next_slot(fs, &cluster, &slot)) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+static DirIndex *dir_index_load(FAT32_FileSystem *fs, uint32_t dir_cluster) {
+    TRACE_FUNCTION();
+    DirIndex *index = dirindex_get(&fs->dir_index, dir_cluster);
+    if (index) {
+        fs->stats.dir_index_hits++;
+        return index;
+    }
+
+    fs->stats.dir_index_misses++;
+
+    index = dirindex_create(&fs->dir_index, dir_cluster);
+    if (!index) {
+        return NULL;
+    }
+
+    uint32_t current_cluster = dir_cluster;
+    uint32_t entries_per_cluster = fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
+    LongNameRun run;
+    lfn_run_reset(&run);
+
+    while (current_cluster >= 2 && current_cluster < FAT32_CLUSTER_END) {
+        uint8_t *cluster_data = cluster_get(fs, current_cluster, true);
+        fs->stats.dir_clusters_scanned++;
+        if (!cluster_data) {
+            dirindex_drop(&fs->dir_index, dir_cluster);
+            return NULL;
+        }
+
+        FAT32_DirEntry *entries = (FAT32_DirEntry*)cluster_data;
+        bool success = true;
+        for (uint32_t i = 0; i < entries_per_cluster && success; i++) {
+            if (is_unused_entry(&entries[i])) {
+                lfn_run_reset(&run);
+                if (!index->has_free_hint) {
+                    index->has_free_hint = true;
+                    index->free_cluster = current_cluster;
+                    index->free_slot = i;
+                }
+                continue;
+            }
+
+            if (is_lfn_entry(&entries[i])) {
+                lfn_run_add(&run, &entries[i], current_cluster, i);
+                continue;
+            }
+
+            success = dirindex_insert(&fs->dir_index, index, entries[i].DIR_Name, current_cluster, i);
+
+            size_t length;
+            if (success && lfn_run_complete(&run, &entries[i], &length)) {
+                success = dirindex_insert_long(&fs->dir_index, index, lfn_name_hash(run.units, length),
+                                               entries[i].DIR_Name, run.cluster, run.slot);
+            }
+            lfn_run_reset(&run);
+        }
+        cluster_put(fs, current_cluster, cluster_data, false);
+
+        if (!success) {
+            dirindex_drop(&fs->dir_index, dir_cluster);
+            return NULL;
+        }
+
+        current_cluster = fat32_get_next_cluster(fs, current_cluster);
+    }
+
+    return index;
+}
+
+static int find_entry_by_name(FAT32_FileSystem *fs,
+    uint32_t dir_cluster, const char *name, uint32_t *out_cluster) {
+    TRACE_FUNCTION();
+    fs->stats.lookups++;
+
+    uint16_t units[FAT32_LFN_MAX_CHARS];
+    size_t length;
+    if (!utf8_to_utf16(name, units, FAT32_LFN_MAX_CHARS, &length) || length == 0) {
+        return -1;
+    }
+
+    char short_name[11];
+    bool has_short_name = short_name_basis(short_name, name);
+
+    LongNameRun run;
+    DirIndex *index = dir_index_load(fs, dir_cluster);
+    if (index) {
+        uint32_t slot;
+        if (has_short_name && dirindex_lookup(index, short_name, out_cluster, &slot)) {
+            return (int)slot;
+        }
+
+        uint32_t cursor = 0;
+        uint32_t cluster;
+        while (dirindex_next_long(index, lfn_name_hash(units, length), &cursor, &cluster, &slot)) {
+            size_t run_length;
+            uint32_t entry_cluster;
+            uint32_t entry_slot;
+            if (read_long_name(fs, cluster, slot, &run, &run_length, &entry_cluster, &entry_slot) &&
+                lfn_name_equal(run.units, run_length, units, length)) {
+                if (out_cluster) {
+                    *out_cluster = entry_cluster;
+                }
+                return (int)entry_slot;
+            }
+        }
+        return -1;
+    }
+
+    uint32_t current_cluster = dir_cluster;
+    uint32_t entries_per_cluster = fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
+    int entry_index = -1;
+    lfn_run_reset(&run);
+
+    while (current_cluster >= 2 && current_cluster < FAT32_CLUSTER_END) {
+        uint8_t *cluster_data = cluster_get(fs, current_cluster, true);
+        fs->stats.dir_clusters_scanned++;
+        if (!cluster_data) {
+            return -1;
+        }
+
+        FAT32_DirEntry *entries = (FAT32_DirEntry*)cluster_data;
+        for (uint32_t i = 0; i < entries_per_cluster; i++) {
+            if (is_unused_entry(&entries[i])) {
+                lfn_run_reset(&run);
+                continue;
+            }
+
+            if (is_lfn_entry(&entries[i])) {
+                lfn_run_add(&run, &entries[i], current_cluster, i);
+                continue;
+            }
+
+            size_t run_length;
+            if ((has_short_name && memcmp(entries[i].DIR_Name, short_name, 11) == 0) ||
+                (lfn_run_complete(&run, &entries[i], &run_length) &&
+                 lfn_name_equal(run.units, run_length, units, length))) {
+                entry_index = (int)i;
+                break;
+            }
+            lfn_run_reset(&run);
+        }
+        cluster_put(fs, current_cluster, cluster_data, false);
+
+        if (entry_index >= 0) {
+            if (out_cluster) {
+                *out_cluster = current_cluster;
+            }
+            break;
+        }
+
+        current_cluster = fat32_get_next_cluster(fs, current_cluster);
+    }
+
+    return entry_index;
+}
+
+static bool short_name_exists(FAT32_FileSystem *fs, uint32_t dir_cluster, const char short_name[11]) {
+    DirIndex *index = dir_index_load(fs, dir_cluster);
+    if (index) {
+        return dirindex_lookup(index, short_name, NULL, NULL);
+    }
+
+    uint32_t current_cluster = dir_cluster;
+    uint32_t entries_per_cluster = fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
+    bool found = false;
+
+    while (!found && current_cluster >= 2 && current_cluster < FAT32_CLUSTER_END) {
+        uint8_t *cluster_data = cluster_get(fs, current_cluster, true);
+        fs->stats.dir_clusters_scanned++;
+        if (!cluster_data) {
+            return true;
+        }
+
+        FAT32_DirEntry *entries = (FAT32_DirEntry*)cluster_data;
+        for (uint32_t i = 0; i < entries_per_cluster && !found; i++) {
+            found = !is_unused_entry(&entries[i]) && !is_lfn_entry(&entries[i]) &&
+                    memcmp(entries[i].DIR_Name, short_name, 11) == 0;
+        }
+        cluster_put(fs, current_cluster, cluster_data, false);
+
+        current_cluster = fat32_get_next_cluster(fs, current_cluster);
+    }
+
+    return found;
+}
+
+static bool make_unique_short_name(FAT32_FileSystem *fs, uint32_t dir_cluster, const char *name,
+                                   char short_name[11]) {
+    char basis[11];
+    if (short_name_basis(basis, name) && !short_name_exists(fs, dir_cluster, basis)) {
+        memcpy(short_name, basis, 11);
+        return true;
+    }
+
+    for (uint32_t number = 1; number <= 999999; number++) {
+        memcpy(short_name, basis, 11);
+        short_name_set_tail(short_name, number);
+        if (!short_name_exists(fs, dir_cluster, short_name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool find_free_run(FAT32_FileSystem *fs, uint32_t dir_cluster, uint32_t count,
+                          uint32_t *out_cluster, uint32_t *out_slot,
+                          uint32_t *first_free_cluster, uint32_t *first_free_slot) {
+    TRACE_FUNCTION();
+    uint32_t current_cluster = dir_cluster;
+    uint32_t entries_per_cluster = fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
+    uint32_t first_slot = 0;
+    uint32_t run_length = 0;
+    bool seen_free = false;
+
+    DirIndex *index = dirindex_get(&fs->dir_index, dir_cluster);
+    if (index && index->has_free_hint) {
+        current_cluster = index->free_cluster;
+        first_slot = index->free_slot;
+    }
+    *out_cluster = current_cluster;
+    *out_slot = first_slot;
+    *first_free_cluster = current_cluster;
+    *first_free_slot = first_slot;
+
+    while (current_cluster >= 2 && current_cluster < FAT32_CLUSTER_END) {
+        uint8_t *cluster_data = cluster_get(fs, current_cluster, true);
+        fs->stats.dir_clusters_scanned++;
+        if (!cluster_data) {
+            return false;
+        }
+
+        FAT32_DirEntry *entries = (FAT32_DirEntry*)cluster_data;
+        for (uint32_t i = first_slot; i < entries_per_cluster && run_length < count; i++) {
+            if (!is_unused_entry(&entries[i])) {
+                run_length = 0;
+                continue;
+            }
+
+            if (run_length == 0) {
+                *out_cluster = current_cluster;
+                *out_slot = i;
+            }
+            if (!seen_free) {
+                seen_free = true;
+                *first_free_cluster = current_cluster;
+                *first_free_slot = i;
+            }
+            run_length++;
+        }
+        first_slot = 0;
+        cluster_put(fs, current_cluster, cluster_data, false);
+
+        if (run_length == count) {
+            return true;
+        }
+
+        uint32_t next_cluster = fat32_get_next_cluster(fs, current_cluster);
+
+        if (next_cluster >= FAT32_CLUSTER_END) {
+            uint32_t new_cluster = fat32_allocate_cluster(fs);
+            if (new_cluster == 0) {
+                return false;
+            }
+
+            uint8_t *new_data = cluster_get(fs, new_cluster, false);
+            if (!new_data || !cluster_put(fs, new_cluster, new_data, true)) {
+                fat32_set_cluster_value(fs, new_cluster, FAT32_CLUSTER_FREE);
+                return false;
+            }
+
+            fat32_set_cluster_value(fs, current_cluster, new_cluster);
+
+            fat32_set_cluster_value(fs, new_cluster, FAT32_CLUSTER_END);
+
+            next_cluster = new_cluster;
+        }
+        current_cluster = next_cluster;
+    }
+    return false;
+}
+
+#define PATH_MAX_COMPONENTS 128
+#define PATH_KEY_SIZE 256
+#define FILL_CHUNK_CLUSTERS 256
+
+static bool parse_path(const char *path, char *buffer, char *components[], int *component_count) {
+    if (!path || path[0] != '/' || strlen(path) >= PATH_KEY_SIZE)
+        return false;
+
+    *component_count = 0;
+    strcpy(buffer, path);
+
+    char *save = NULL;
+    for (char *token = strtok_r(buffer, "/", &save); token; token = strtok_r(NULL, "/", &save)) {
+        if (*component_count >= PATH_MAX_COMPONENTS) {
+            return false;
+        }
+        components[(*component_count)++] = token;
+    }
+
+    return true;
+}
+
+static void path_key(char *key, char *components[], int component_count, size_t *prefix_lengths) {
+    size_t length = 0;
+
+    key[0] = '/';
+    key[1] = '\0';
+
+    for (int i = 0; i < component_count; i++) {
+        key[length++] = '/';
+        for (const char *c = components[i]; *c; c++) {
+            key[length++] = (char)toupper((unsigned char)*c);
+        }
+        key[length] = '\0';
+        if (prefix_lengths) {
+            prefix_lengths[i] = length;
+        }
+    }
+}
+
+static bool resolve_path(FAT32_FileSystem *fs, const char *path, uint32_t *out_cluster, uint8_t *out_attr) {
+    TRACE_FUNCTION();
+    char path_buffer[PATH_KEY_SIZE];
+    char *path_components[PATH_MAX_COMPONENTS];
+    int path_component_count = 0;
+
+    if (!parse_path(path, path_buffer, path_components, &path_component_count)) {
+        return false;
+    }
+
+    char key[PATH_KEY_SIZE];
+    size_t prefix_lengths[PATH_MAX_COMPONENTS];
+    path_key(key, path_components, path_component_count, prefix_lengths);
+
+    uint32_t cluster = fs->bootSector.BPB_RootClus;
+    uint8_t attr = FAT32_ATTR_DIRECTORY;
+    int start = 0;
+
+    for (int i = path_component_count; i > 0; i--) {
+        char saved = key[prefix_lengths[i - 1]];
+        key[prefix_lengths[i - 1]] = '\0';
+        bool found = dentry_lookup(&fs->dentries, key, &cluster, &attr);
+        key[prefix_lengths[i - 1]] = saved;
+
+        if (found) {
+            start = i;
+            break;
+        }
+    }
+
+    fs->stats.path_resolutions++;
+    if (start == path_component_count) {
+        fs->stats.dentry_hits++;
+    } else {
+        fs->stats.dentry_misses++;
+    }
+
+    for (int i = start; i < path_component_count; i++) {
+        if (!(attr & FAT32_ATTR_DIRECTORY)) {
+            return false;
+        }
+
+        uint32_t entry_cluster;
+        int entry_index = find_entry_by_name(fs, cluster, path_components[i], &entry_cluster);
+        if (entry_index < 0) {
+            return false;
+        }
+
+        FAT32_DirEntry entry;
+        if (!read_dir_entry(fs, entry_cluster, entry_index, &entry)) {
+            return false;
+        }
+
+        attr = entry.DIR_Attr;
+        cluster = ((uint32_t)entry.DIR_FstClusHI << 16) | entry.DIR_FstClusLO;
+        if (cluster == 0 && (attr & FAT32_ATTR_DIRECTORY)) {
+            cluster = fs->bootSector.BPB_RootClus;
+        }
+
+        char saved = key[prefix_lengths[i]];
+        key[prefix_lengths[i]] = '\0';
+        dentry_insert(&fs->dentries, key, cluster, attr);
+        key[prefix_lengths[i]] = saved;
+    }
+
+    *out_cluster = cluster;
+    if (out_attr) {
+        *out_attr = attr;
+    }
+    return true;
+}
+
+static bool resolve_directory(FAT32_FileSystem *fs, const char *path, uint32_t *out_cluster) {
+    uint8_t attr;
+    uint32_t cluster;
+
+    if (!resolve_path(fs, path, &cluster, &attr) || !(attr & FAT32_ATTR_DIRECTORY)) {
+        return false;
+    }
+
+    *out_cluster = cluster;
+    return true;
+}
+
+static void invalidate_path(FAT32_FileSystem *fs, const char *path) {
+    char path_buffer[PATH_KEY_SIZE];
+    char *path_components[PATH_MAX_COMPONENTS];
+    int path_component_count = 0;
+
+    if (!parse_path(path, path_buffer, path_components, &path_component_count)) {
+        dentry_clear(&fs->dentries);
+        return;
+    }
+
+    char key[PATH_KEY_SIZE];
+    path_key(key, path_components, path_component_count, NULL);
+    dentry_invalidate(&fs->dentries, key);
+}
+
+static void invalidate_child_path(FAT32_FileSystem *fs, const char *dir_path, const char *name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", strcmp(dir_path, "/") == 0 ? "" : dir_path, name);
+    invalidate_path(fs, path);
+}
+#if 0
+bool fat32_init(FAT32_FileSystem *fs, const char *filename) {
+    if (!fs || !filename) {
+        return false;
+    }
+
+    fs->fat = NULL;
+
+    if (!disk_init(&fs->disk, filename)) {
+        return false;
+    }
+
+    strcpy(fs->current_path, "/");
+
+    fseek(fs->disk.file, 0, SEEK_END);
+    long file_size = ftell(fs->disk.file);
+    fseek(fs->disk.file, 0, SEEK_SET);
+
+    if (file_size > 1024 * 1024) {
+        LOG_DEBUG("File exists with size %ld bytes, assuming formatted", file_size);
+        fs->is_formatted = true;
+    } else {
+        LOG_DEBUG("Small or empty file, not formatted");
+        fs->is_formatted = false;
+    }
+
+    if (fat32_read_boot_sector(fs)) {
+        fs->sectors_per_cluster = fs->bootSector.BPB_SecPerClus;
+        fs->fat_size = fs->bootSector.BPB_FATSz32;
+        fs->bytes_per_cluster = fs->bootSector.BPB_BytesPerSec * fs->sectors_per_cluster;
+        fs->first_data_sector = fs->bootSector.BPB_RsvdSecCnt +
+                                (fs->bootSector.BPB_NumFATs * fs->fat_size);
+        uint32_t total_sectors = fs->bootSector.BPB_TotSec32;
+        uint32_t data_sectors = total_sectors - fs->first_data_sector;
+        fs->data_cluster_count = data_sectors / fs->sectors_per_cluster;
+        fs->current_dir_cluster = fs->bootSector.BPB_RootClus;
+
+        if (fs->is_formatted) {
+            fat32_read_fat(fs);
+        }
+    }
+
+    return true;
+}
+#endif
+bool fat32_init(FAT32_FileSystem *fs, const char *filename) {
+    return fat32_init_with_options(fs, filename, NULL);
+}
+
+bool fat32_init_with_options(FAT32_FileSystem *fs, const char *filename, const DiskOptions *options) {
+    TRACE_FUNCTION();
+    if (!fs || !filename) {
+        return false;
+    }
+
+    memset(&fs->fat_cache, 0, sizeof(fs->fat_cache));
+    fs->fat_cache_budget = FATCACHE_DEFAULT_BUDGET;
+    memset(&fs->fat_map, 0, sizeof(fs->fat_map));
+    fs->fat_extents = false;
+    fs->free_map = NULL;
+    fs->free_block_count = NULL;
+    fs->free_block_total = 0;
+    fs->free_count = 0;
+    fs->next_free = 2;
+    fs->fsinfo_dirty = false;
+    fs->defer_sync = false;
+    fs->defer_mirrors = false;
+    memset(&fs->stats, 0, sizeof(FAT32_Stats));
+    memset(&fs->cache, 0, sizeof(fs->cache));
+    fs->cache_budget = CACHE_DEFAULT_BUDGET;
+    fs->is_formatted = false;
+
+    if (!dirindex_init(&fs->dir_index, DIRINDEX_DEFAULT_BUDGET)) {
+        return false;
+    }
+
+    if (!dentry_init(&fs->dentries, DENTRY_DEFAULT_CAPACITY)) {
+        dirindex_destroy(&fs->dir_index);
+        return false;
+    }
+
+    if (!disk_init_with_options(&fs->disk, filename, options)) {
+        dirindex_destroy(&fs->dir_index);
+        dentry_destroy(&fs->dentries);
+        return false;
+    }
+
+    strcpy(fs->current_path, "/");
+
+    if (disk_get_total_sectors(&fs->disk) < 2) {
+        LOG_DEBUG("File is too small, not formatted");
+        return true;
+    }
+
+    if (!fat32_read_boot_sector(fs)) {
+        LOG_ERROR("Failed to read boot sector");
+        return true;
+    }
+
+    if (fs->bootSector.BootSignature == FAT32_SIGNATURE &&
+        fs->bootSector.BPB_SecPerClus != 0 &&
+        strncmp(fs->bootSector.BS_FilSysType, "FAT32   ", 8) == 0) {
+
+        fs->is_formatted = true;
+        LOG_INFO("Valid FAT32 filesystem detected");
+
+        fs->sectors_per_cluster = fs->bootSector.BPB_SecPerClus;
+        fs->fat_size = fs->bootSector.BPB_FATSz32;
+        fs->bytes_per_cluster = fs->bootSector.BPB_BytesPerSec * fs->sectors_per_cluster;
+        fs->first_data_sector = fs->bootSector.BPB_RsvdSecCnt +
+                                (fs->bootSector.BPB_NumFATs * fs->fat_size);
+
+        uint32_t total_sectors = fs->bootSector.BPB_TotSec32;
+        uint32_t data_sectors = total_sectors - fs->first_data_sector;
+        fs->data_cluster_count = data_sectors / fs->sectors_per_cluster;
+        fs->current_dir_cluster = fs->bootSector.BPB_RootClus;
+
+        cache_setup(fs);
+
+        if (fat32_read_fat(fs) && !fat32_read_fsinfo(fs)) {
+            LOG_WARN("FSInfo sector invalid, counting free clusters");
+            free_index_build(fs);
+            fs->fsinfo_dirty = true;
+        }
+    } else {
+        LOG_INFO("File exists but is not a valid FAT32 filesystem");
+        fs->is_formatted = false;
+    }
+
+    return true;
+}
+
+bool fat32_set_cache_budget(FAT32_FileSystem *fs, size_t budget_bytes) {
+    if (!fs) {
+        return false;
+    }
+
+    fs->cache_budget = budget_bytes;
+    if (!fs->is_formatted) {
+        return true;
+    }
+
+    if (fs->cache.buckets && !cache_flush(&fs->cache)) {
+        return false;
+    }
+    return cache_setup(fs);
+}
+
+bool fat32_set_fat_cache_budget(FAT32_FileSystem *fs, size_t budget_bytes) {
+    if (!fs) {
+        return false;
+    }
+
+    fs->fat_cache_budget = budget_bytes;
+    if (!fs->fat_cache.buckets) {
+        return true;
+    }
+    return fatcache_set_budget(&fs->fat_cache, budget_bytes);
+}
+
+bool fat32_set_fat_extents(FAT32_FileSystem *fs, bool enable) {
+    if (!fs) {
+        return false;
+    }
+
+    fs->fat_extents = enable;
+    if (!fs->fat_cache.buckets || enable == (fs->fat_map.runs != NULL)) {
+        return true;
+    }
+
+    if (enable) {
+        return fat_map_load(fs, false);
+    }
+
+    if (!fat_map_flush(fs)) {
+        return false;
+    }
+    fat_map_close(fs, false);
+    return true;
+}
+
+bool fat32_set_dir_index_budget(FAT32_FileSystem *fs, size_t budget_bytes) {
+    if (!fs || !fs->dir_index.buckets) {
+        return false;
+    }
+
+    dirindex_set_budget(&fs->dir_index, budget_bytes);
+    return true;
+}
+
+bool fat32_read_boot_sector(FAT32_FileSystem *fs) {
+    if (!fs) {
+        return false;
+    }
+
+    return disk_read_sector(&fs->disk, 0, &fs->bootSector);
+}
+
+bool fat32_write_boot_sector(FAT32_FileSystem *fs) {
+    if (!fs) {
+        return false;
+    }
+
+    return disk_write_sector(&fs->disk, 0, &fs->bootSector);
+}
+
+bool fat32_read_fsinfo(FAT32_FileSystem *fs) {
+    if (!fs) {
+        return false;
+    }
+
+    uint16_t sector = fs->bootSector.BPB_FSInfo;
+    if (sector == 0 || sector >= fs->bootSector.BPB_RsvdSecCnt) {
+        return false;
+    }
+
+    FAT32_FSInfo fsinfo;
+    if (!disk_read_sector(&fs->disk, sector, &fsinfo)) {
+        return false;
+    }
+
+    if (fsinfo.FSI_LeadSig != FAT32_FSINFO_LEAD_SIG ||
+        fsinfo.FSI_StrucSig != FAT32_FSINFO_STRUC_SIG ||
+        fsinfo.FSI_TrailSig != FAT32_FSINFO_TRAIL_SIG ||
+        fsinfo.FSI_Free_Count == FAT32_FSINFO_UNKNOWN ||
+        fsinfo.FSI_Free_Count > fs->data_cluster_count) {
+        return false;
+    }
+
+    fs->free_count = fsinfo.FSI_Free_Count;
+    fs->next_free = 2;
+    if (fsinfo.FSI_Nxt_Free >= 2 && fsinfo.FSI_Nxt_Free < cluster_limit(fs)) {
+        fs->next_free = fsinfo.FSI_Nxt_Free;
+    }
+    fs->fsinfo_dirty = false;
+
+    return true;
+}
+
+static bool write_fsinfo_sector(FAT32_FileSystem *fs, uint32_t sector) {
+    FAT32_FSInfo fsinfo;
+    memset(&fsinfo, 0, sizeof(fsinfo));
+    fsinfo.FSI_LeadSig = FAT32_FSINFO_LEAD_SIG;
+    fsinfo.FSI_StrucSig = FAT32_FSINFO_STRUC_SIG;
+    fsinfo.FSI_Free_Count = fs->free_count;
+    fsinfo.FSI_Nxt_Free = fs->next_free;
+    fsinfo.FSI_TrailSig = FAT32_FSINFO_TRAIL_SIG;
+
+    return disk_write_sector(&fs->disk, sector, &fsinfo);
+}
+
+bool fat32_write_fsinfo(FAT32_FileSystem *fs) {
+    TRACE_FUNCTION();
+    if (!fs) {
+        return false;
+    }
+
+    if (!write_fsinfo_sector(fs, fs->bootSector.BPB_FSInfo)) {
+        return false;
+    }
+
+    fs->fsinfo_dirty = false;
+    return true;
+}
+
+bool fat32_get_free_space(FAT32_FileSystem *fs, uint32_t *free_clusters, uint32_t *total_clusters) {
+    if (!fs || !fs->is_formatted || !free_clusters || !total_clusters) {
+        return false;
+    }
+
+    *free_clusters = fs->free_count;
+    *total_clusters = fs->data_cluster_count;
+    return true;
+}
+
+bool fat32_check_fs(FAT32_FileSystem *fs) {
+    TRACE_FUNCTION();
+    if (!fs) {
+        LOG_ERROR("fs is NULL");
+        return false;
+    }
+
+    LOG_DEBUG("Boot signature value: 0x%04X, expected: 0x%04X",
+       fs->bootSector.BootSignature, FAT32_SIGNATURE);
+
+    if (fs->bootSector.BootSignature == 0) {
+        LOG_WARN("Boot signature is 0");
+        return false;
+    }
+
+    if (strncmp(fs->bootSector.BS_FilSysType, "FAT32   ", 8) != 0) {
+        LOG_WARN("Invalid file system type: %.8s (expected FAT32   )",
+               fs->bootSector.BS_FilSysType);
+        return false;
+    }
+
+    if (fs->bootSector.BPB_BytesPerSec != 512 ||
+        fs->bootSector.BPB_SecPerClus == 0 ||
+        fs->bootSector.BPB_NumFATs == 0 ||
+        fs->bootSector.BPB_FATSz32 == 0) {
+        LOG_WARN("Invalid BPB parameters: BytesPerSec=%d, SecPerClus=%d, NumFATs=%d, FATSz32=%d",
+               fs->bootSector.BPB_BytesPerSec, fs->bootSector.BPB_SecPerClus,
+               fs->bootSector.BPB_NumFATs, fs->bootSector.BPB_FATSz32);
+        return false;
+        }
+
+    return true;
+}
+
+static bool mirrors_mark_stale(FAT32_FileSystem *fs, bool stale) {
+    uint16_t flags = stale ? FAT32_EXTFLAGS_NO_MIRROR : 0;
+    if (fs->bootSector.BPB_ExtFlags == flags) {
+        return true;
+    }
+
+    fs->bootSector.BPB_ExtFlags = flags;
+    return fat32_write_boot_sector(fs);
+}
+
+static bool mirrors_defer(FAT32_FileSystem *fs, bool defer) {
+    if (defer) {
+        if (fs->bootSector.BPB_NumFATs < 2) {
+            return true;
+        }
+        return mirrors_mark_stale(fs, true) && fatcache_set_defer_mirrors(&fs->fat_cache, true);
+    }
+
+    return fat32_flush_fat(fs) && fatcache_set_defer_mirrors(&fs->fat_cache, false)
+           && mirrors_mark_stale(fs, false);
+}
+
+static bool mirrors_repair(FAT32_FileSystem *fs) {
+    if (!(fs->bootSector.BPB_ExtFlags & FAT32_EXTFLAGS_NO_MIRROR)) {
+        return true;
+    }
+
+    uint8_t active = fs->bootSector.BPB_ExtFlags & FAT32_EXTFLAGS_ACTIVE_MASK;
+    if (active >= fs->bootSector.BPB_NumFATs) {
+        active = 0;
+    }
+
+    LOG_WARN("FAT mirrors are out of date, copying FAT %u over them", active);
+    return fatcache_copy(&fs->fat_cache, active, 0, fs->fat_size) && mirrors_mark_stale(fs, false);
+}
+
+bool fat32_read_fat(FAT32_FileSystem *fs) {
+    TRACE_FUNCTION();
+    if (!fs || !fs->is_formatted) {
+        return false;
+    }
+
+    if (!fat_cache_setup(fs)) {
+        return false;
+    }
+
+    if (!mirrors_repair(fs)) {
+        LOG_ERROR("Failed to copy the active FAT over its mirrors");
+        return false;
+    }
+    if (fs->defer_mirrors && !mirrors_defer(fs, true)) {
+        return false;
+    }
+
+    if (fs->fat_extents && !fat_map_load(fs, false)) {
+        LOG_WARN("Failed to load the FAT as runs, using the FAT page cache");
+    }
+    return true;
+}
+
+bool fat32_write_fat(FAT32_FileSystem *fs) {
+    return fat32_flush_fat(fs);
+}
+
+bool fat32_flush_fat(FAT32_FileSystem *fs) {
+    TRACE_FUNCTION();
+    if (!fs || !fs->fat_cache.buckets) {
+        return false;
+    }
+
+    uint64_t written = fs->fat_cache.sectors_written;
+    if (!fatcache_flush(&fs->fat_cache) || !fat_map_flush(fs)) {
+        return false;
+    }
+
+    if (fs->fat_cache.sectors_written != written) {
+        fs->stats.fat_flushes++;
+    }
+    return true;
+}
+
+static bool sync_filesystem(FAT32_FileSystem *fs, bool mirrors) {
+    if (!fs || !fs->is_formatted) {
+        return false;
+    }
+
+    fs->stats.syncs++;
+
+    if (fs->cache.buckets && !cache_flush(&fs->cache)) {
+        return false;
+    }
+
+    if (!fat32_flush_fat(fs)) {
+        return false;
+    }
+
+    if (mirrors && !fatcache_sync_mirrors(&fs->fat_cache)) {
+        return false;
+    }
+
+    if (fs->fsinfo_dirty) {
+        return fat32_write_fsinfo(fs);
+    }
+    return true;
+}
+
+bool fat32_sync(FAT32_FileSystem *fs) {
+    TRACE_FUNCTION();
+    return sync_filesystem(fs, true);
+}
+
+bool fat32_set_deferred_mirrors(FAT32_FileSystem *fs, bool defer) {
+    if (!fs) {
+        return false;
+    }
+
+    fs->defer_mirrors = defer;
+    if (!fs->fat_cache.buckets || defer == fs->fat_cache.defer_mirrors) {
+        return true;
+    }
+    return mirrors_defer(fs, defer);
+}
+
+bool fat32_set_deferred_sync(FAT32_FileSystem *fs, bool defer) {
+    if (!fs) {
+        return false;
+    }
+
+    fs->defer_sync = defer;
+    if (!defer && fs->is_formatted) {
+        return fat32_sync(fs);
+    }
+    return true;
+}
+
+static bool commit_changes(FAT32_FileSystem *fs) {
+    return fs->defer_sync || sync_filesystem(fs, false);
+}
+
+void fat32_get_stats(FAT32_FileSystem *fs, FAT32_Stats *stats) {
+    if (!fs || !stats) {
+        return;
+    }
+
+    *stats = fs->stats;
+    disk_get_stats(&fs->disk, &stats->disk);
+    stats->cache_hits += fs->cache.hits;
+    stats->cache_misses += fs->cache.misses;
+    stats->fat_page_hits += fs->fat_cache.hits;
+    stats->fat_page_misses += fs->fat_cache.misses;
+    stats->fat_sectors_written += fs->fat_cache.sectors_written;
+    stats->fat_mirror_syncs += fs->fat_cache.mirror_syncs;
+    stats->fat_mirror_sectors += fs->fat_cache.mirror_sectors;
+}
+
+void fat32_reset_stats(FAT32_FileSystem *fs) {
+    if (!fs) {
+        return;
+    }
+
+    memset(&fs->stats, 0, sizeof(FAT32_Stats));
+    disk_reset_stats(&fs->disk);
+    fs->cache.hits = 0;
+    fs->cache.misses = 0;
+    fs->fat_cache.hits = 0;
+    fs->fat_cache.misses = 0;
+    fs->fat_cache.sectors_written = 0;
+    fs->fat_cache.mirror_syncs = 0;
+    fs->fat_cache.mirror_sectors = 0;
+}
+
+
+uint32_t fat32_get_next_cluster(FAT32_FileSystem *fs, uint32_t cluster) {
+    if (!fs || !fs->fat_cache.buckets || !fs->is_formatted || cluster < 2 || cluster >= fs->data_cluster_count + 2) {
+        return FAT32_CLUSTER_END;
+    }
+
+    uint32_t value;
+    if (!fat_get(fs, cluster, &value)) {
+        return FAT32_CLUSTER_END;
+    }
+    return value;
+}
+
+uint32_t fat32_allocate_cluster(FAT32_FileSystem *fs) {
+    TRACE_FUNCTION();
+    if (!fs || !fs->fat_cache.buckets || !fs->is_formatted) {
+        return 0;
+    }
+
+    uint32_t cluster = free_index_find(fs);
+    if (cluster == 0 || !fat_set(fs, cluster, FAT32_CLUSTER_END)) {
+        return 0;
+    }
+
+    free_index_set(fs, cluster, false);
+    fs->free_count--;
+    fs->next_free = cluster + 1;
+    fs->fsinfo_dirty = true;
+    fs->stats.clusters_allocated++;
+
+    return cluster;
+}
+
+bool fat32_allocate_clusters(FAT32_FileSystem *fs, uint32_t count, uint32_t link_from,
+                             uint32_t *first_cluster) {
+    TRACE_FUNCTION();
+    if (!fs || !fs->fat_cache.buckets || !fs->is_formatted || count == 0 || !first_cluster) {
+        return false;
+    }
+
+    if (!fs->fat_map.runs && !fs->free_map && !free_index_init(fs)) {
+        return false;
+    }
+    if (fs->free_count < count) {
+        return false;
+    }
+
+    FreeRun *runs = NULL;
+    uint32_t run_count = 0;
+    if (!free_index_find_runs(fs, count, &runs, &run_count)) {
+        return false;
+    }
+
+    uint32_t allocated = 0;
+    bool success = true;
+    for (uint32_t r = 0; success && r < run_count; r++) {
+        uint32_t end = runs[r].start + runs[r].length;
+        for (uint32_t cluster = runs[r].start; success && cluster < end; cluster++) {
+            uint32_t next = cluster + 1;
+            if (next == end) {
+                next = r + 1 < run_count ? runs[r + 1].start : FAT32_CLUSTER_END;
+            }
+
+            success = fat_set(fs, cluster, next);
+            if (success) {
+                free_index_set(fs, cluster, false);
+                fs->free_count--;
+                fs->stats.clusters_allocated++;
+                allocated++;
+            }
+        }
+    }
+
+    if (success && link_from != 0) {
+        success = fat32_set_cluster_value(fs, link_from, runs[0].start);
+    }
+
+    fs->fsinfo_dirty = true;
+    if (!success) {
+        release_runs(fs, runs, run_count, allocated);
+        free(runs);
+        return false;
+    }
+
+    *first_cluster = runs[0].start;
+    fs->next_free = runs[run_count - 1].start + runs[run_count - 1].length;
+    free(runs);
+    return true;
+}
+
+bool fat32_set_cluster_value(FAT32_FileSystem *fs, uint32_t cluster, uint32_t value) {
+    if (!fs || !fs->fat_cache.buckets || !fs->is_formatted || cluster < 2 || cluster >= fs->data_cluster_count + 2) {
+        return false;
+    }
+
+    uint32_t old_value;
+    if (!fat_get(fs, cluster, &old_value) || !fat_set(fs, cluster, value)) {
+        return false;
+    }
+
+    bool was_free = old_value == FAT32_CLUSTER_FREE;
+    bool is_free = (value & 0x0FFFFFFF) == FAT32_CLUSTER_FREE;
+
+    if (was_free != is_free) {
+        free_index_set(fs, cluster, is_free);
+        if (is_free) {
+            fs->free_count++;
+        } else {
+            fs->free_count--;
+        }
+        fs->fsinfo_dirty = true;
+
+        if (is_free) {
+            fs->stats.clusters_freed++;
+        } else {
+            fs->stats.clusters_allocated++;
+        }
+    }
+    return true;
+}
+
+uint64_t fat32_sector_for_cluster(FAT32_FileSystem *fs, uint32_t cluster) {
+    if (!fs || cluster < 2 ) {
         return 0;
     }
 
-    return fs->first_data_sector + (cluster - 2) * fs->sectors_per_cluster;
+    return fs->first_data_sector + (uint64_t)(cluster - 2) * fs->sectors_per_cluster;
+}
+
+bool fat32_read_cluster(FAT32_FileSystem *fs, uint32_t cluster, void *buffer) {
+    if (!fs || !buffer || !fs->is_formatted || cluster < 2 ) {
+        return false;
+    }
+
+    uint8_t *data = cluster_get(fs, cluster, true);
+    if (!data) {
+        return false;
+    }
+
+    memcpy(buffer, data, fs->bytes_per_cluster);
+    return cluster_put(fs, cluster, data, false);
+}
+
+bool fat32_write_cluster(FAT32_FileSystem *fs, uint32_t cluster, const void *buffer) {
+    if (!fs || !buffer || cluster < 2) {
+        return false;
+    }
+
+    uint8_t *data = cluster_get(fs, cluster, false);
+    if (!data) {
+        return false;
+    }
+
+    memcpy(data, buffer, fs->bytes_per_cluster);
+    return cluster_put(fs, cluster, data, true);
+}
+
+
+static uint32_t default_sectors_per_cluster(uint64_t total_sectors) {
+    uint64_t mib = total_sectors / 2048;
+
+    if (mib <= 260) {
+        return 1;
+    } else if (mib <= 8 * 1024) {
+        return 8;
+    } else if (mib <= 16 * 1024) {
+        return 16;
+    } else if (mib <= 32 * 1024) {
+        return 32;
+    }
+    return 64;
+}
+
+static bool format_geometry(uint32_t total_sectors, uint32_t sectors_per_cluster, uint32_t align,
+                            uint32_t num_fats, uint32_t *reserved, uint64_t *fat_size, uint64_t *clusters) {
+    uint32_t align_sectors = align / 512;
+    if (align_sectors < sectors_per_cluster) {
+        align_sectors = sectors_per_cluster;
+    }
+
+    if (total_sectors <= FAT32_MIN_RESERVED_SECTORS) {
+        return false;
+    }
+
+    uint64_t upper = (total_sectors - FAT32_MIN_RESERVED_SECTORS) / sectors_per_cluster;
+    *fat_size = ((upper + 2) * 4 + 512 - 1) / 512;
+
+    uint64_t metadata = FAT32_MIN_RESERVED_SECTORS + *fat_size * num_fats;
+    uint64_t first_data_sector = (metadata + align_sectors - 1) / align_sectors * align_sectors;
+    uint64_t reserved_sectors = first_data_sector - *fat_size * num_fats;
+    if (reserved_sectors > UINT16_MAX || first_data_sector >= total_sectors) {
+        return false;
+    }
+
+    *reserved = (uint32_t)reserved_sectors;
+    *clusters = (total_sectors - first_data_sector) / sectors_per_cluster;
+    return *clusters > 0;
+}
+
+bool fat32_format(FAT32_FileSystem *fs) {
+    return fat32_format_ex(fs, NULL);
+}
+
+bool fat32_format_ex(FAT32_FileSystem *fs, const FAT32_FormatOptions *options) {
+    TRACE_FUNCTION();
+    if (!fs) {
+        return false;
+    }
+
+    FAT32_FormatOptions defaults = { .mode = FAT32_FORMAT_QUICK, .threads = 1 };
+    if (!options) {
+        options = &defaults;
+    }
+
+    if (options->cluster_size != 0 && (options->cluster_size < 512 || options->cluster_size > 65536 ||
+                                       (options->cluster_size & (options->cluster_size - 1)) != 0)) {
+        LOG_ERROR("Invalid cluster size %u", options->cluster_size);
+        return false;
+    }
+    if (options->align != 0 && (options->align < 512 || options->align > FAT32_MAX_ALIGN ||
+                                (options->align & (options->align - 1)) != 0)) {
+        LOG_ERROR("Invalid alignment %u", options->align);
+        return false;
+    }
+
+    memset(&fs->bootSector, 0, sizeof(FAT32_BootSector));
+
+    fs->bootSector.BS_jmpBoot[0] = 0xEB;
+    fs->bootSector.BS_jmpBoot[1] = 0x58;
+    fs->bootSector.BS_jmpBoot[2] = 0x90;
+
+    memcpy(fs->bootSector.BS_OEMName, "MSWIN4.1", 8);
+    fs->bootSector.BPB_BytesPerSec = 512;
+    fs->bootSector.BPB_NumFATs = 2;
+    fs->bootSector.BPB_RootEntCnt = 0;
+    fs->bootSector.BPB_TotSec16 = 0;
+    fs->bootSector.BPB_Media = 0xF8;
+    fs->bootSector.BPB_FATSz16 = 0;
+    fs->bootSector.BPB_SecPerTrk = 63;
+    fs->bootSector.BPB_NumHeads = 255;
+    fs->bootSector.BPB_HiddSec = 0;
+
+    uint64_t disk_sectors = disk_get_total_sectors(&fs->disk);
+    LOG_DEBUG("Total sectors: %llu", (unsigned long long)disk_sectors);
+
+    uint32_t total_sectors = disk_sectors > UINT32_MAX ? UINT32_MAX : (uint32_t)disk_sectors;
+    fs->bootSector.BPB_TotSec32 = total_sectors;
+
+    uint32_t sectors_per_cluster = options->cluster_size / 512;
+    if (sectors_per_cluster == 0) {
+        sectors_per_cluster = default_sectors_per_cluster(total_sectors);
+    }
+    uint32_t align = options->align;
+    if (align == 0) {
+        align = total_sectors >= FAT32_LARGE_VOLUME_SECTORS ? 1024 * 1024 : 4096;
+    }
+
+    uint32_t reserved = 0;
+    uint64_t clusters = 0;
+    uint64_t fat_size = 0;
+
+    for (;;) {
+        if (!format_geometry(total_sectors, sectors_per_cluster, align, fs->bootSector.BPB_NumFATs,
+                             &reserved, &fat_size, &clusters)) {
+            LOG_ERROR("Disk too small to format");
+            return false;
+        }
+
+        if (clusters <= FAT32_MAX_CLUSTERS || options->cluster_size != 0 || sectors_per_cluster >= 128) {
+            break;
+        }
+        sectors_per_cluster *= 2;
+    }
+
+    if (clusters > FAT32_MAX_CLUSTERS) {
+        LOG_ERROR("Volume too large for FAT32 with %u-byte clusters", sectors_per_cluster * 512);
+        return false;
+    }
+
+    fs->bootSector.BPB_SecPerClus = (uint8_t)sectors_per_cluster;
+    fs->bootSector.BPB_RsvdSecCnt = (uint16_t)reserved;
+
+    LOG_DEBUG("Cluster size: %u bytes", sectors_per_cluster * 512);
+    LOG_DEBUG("Reserved sectors: %u", reserved);
+    LOG_DEBUG("FAT size: %llu sectors", (unsigned long long)fat_size);
+    LOG_DEBUG("Clusters: %llu", (unsigned long long)clusters);
+
+    fs->bootSector.BPB_FATSz32 = (uint32_t)fat_size;
+    fs->bootSector.BPB_ExtFlags = 0;
+    fs->bootSector.BPB_FSVer = 0;
+    fs->bootSector.BPB_RootClus = FAT32_ROOTDIR_CLUSTER;
+    fs->bootSector.BPB_FSInfo = 1;
+    fs->bootSector.BPB_BkBootSec = 6;
+    memset(fs->bootSector.BPB_Reserved, 0, 12);
+
+    fs->bootSector.BS_DrvNum = 0x80;
+    fs->bootSector.BS_Reserved1 = 0;
+    fs->bootSector.BS_BootSig = 0x29;
+    fs->bootSector.BS_VolID = (uint32_t)time(NULL);
+    memcpy(fs->bootSector.BS_VolLab, "NO NAME    ", 11);
+    memcpy(fs->bootSector.BS_FilSysType, "FAT32   ", 8);
+
+    memset(fs->bootSector.BootCode, 0, 420);
+    fs->bootSector.BootSignature = FAT32_SIGNATURE;
+
+    fs->sectors_per_cluster = fs->bootSector.BPB_SecPerClus;
+    fs->fat_size = fs->bootSector.BPB_FATSz32;
+    fs->bytes_per_cluster = fs->bootSector.BPB_BytesPerSec * fs->sectors_per_cluster;
+    fs->first_data_sector = fs->bootSector.BPB_RsvdSecCnt +
+                            (fs->bootSector.BPB_NumFATs * fs->fat_size);
+
+    bool cleared = false;
+    if (options->mode == FAT32_FORMAT_FULL) {
+        LOG_DEBUG("Zeroing sectors 1-%u with %u thread(s)", fs->first_data_sector - 1,
+                  options->threads > 1 ? options->threads : 1);
+        cleared = disk_write_zeros(&fs->disk, 1, fs->first_data_sector - 1, options->threads);
+    } else {
+        LOG_DEBUG("Clearing sectors 1-%u", fs->first_data_sector - 1);
+        cleared = disk_zero_range(&fs->disk, 1, fs->first_data_sector - 1);
+    }
+    if (!cleared) {
+        LOG_ERROR("Failed to clear the reserved area and FATs");
+        return false;
+    }
+
+    LOG_DEBUG("Writing boot sector...");
+    if (!fat32_write_boot_sector(fs) ||
+        !disk_write_sector(&fs->disk, fs->bootSector.BPB_BkBootSec, &fs->bootSector)) {
+        LOG_ERROR("Failed to write boot sector");
+        return false;
+    }
+    LOG_DEBUG("Boot sector written successfully");
+
+    uint32_t data_sector_count = total_sectors - fs->first_data_sector;
+    fs->data_cluster_count = data_sector_count / fs->sectors_per_cluster;
+
+    cache_invalidate(&fs->cache);
+    dirindex_clear(&fs->dir_index);
+    dentry_clear(&fs->dentries);
+    if (!cache_setup(fs)) {
+        LOG_ERROR("Failed to set up cluster cache");
+        return false;
+    }
+
+    LOG_DEBUG("First data sector: %u", fs->first_data_sector);
+    LOG_DEBUG("Data clusters: %u", fs->data_cluster_count);
+
+    if (!fat_cache_setup(fs)) {
+        LOG_ERROR("Failed to set up FAT page cache");
+        return false;
+    }
+
+    fatcache_set(&fs->fat_cache, 0, 0x0FFFFF00 | fs->bootSector.BPB_Media);
+    fatcache_set(&fs->fat_cache, 1, 0x0FFFFFFF);
+    fatcache_set(&fs->fat_cache, FAT32_ROOTDIR_CLUSTER, FAT32_CLUSTER_END);
+
+    LOG_DEBUG("Writing FAT head at sector %u", fs->bootSector.BPB_RsvdSecCnt);
+    if (!fat32_flush_fat(fs)) {
+        LOG_ERROR("Failed to write FAT");
+        return false;
+    }
+    LOG_DEBUG("FAT written successfully");
+
+    free_index_destroy(fs);
+    fs->free_count = fs->data_cluster_count - 1;
+    fs->next_free = FAT32_ROOTDIR_CLUSTER + 1;
+
+    if (fs->fat_extents && !fat_map_load(fs, true)) {
+        LOG_WARN("Failed to load the FAT as runs, using the FAT page cache");
+    }
+    if (fs->defer_mirrors && !mirrors_defer(fs, true)) {
+        LOG_ERROR("Failed to defer FAT mirror updates");
+        return false;
+    }
+
+    if (!fat32_write_fsinfo(fs) ||
+        !write_fsinfo_sector(fs, fs->bootSector.BPB_BkBootSec + 1)) {
+        LOG_ERROR("Failed to write FSInfo sector");
+        return false;
+    }
+
+    LOG_DEBUG("Allocating root directory...");
+    uint8_t *root_dir = (uint8_t*)calloc(1, fs->bytes_per_cluster);
+    if (!root_dir) {
+        LOG_ERROR("Failed to allocate memory for root directory");
+        return false;
+    }
+    LOG_DEBUG("Root directory allocated successfully");
+
+    FAT32_DirEntry *dir_entries = (FAT32_DirEntry*)root_dir;
+
+    init_dot_entries(dir_entries, FAT32_ROOTDIR_CLUSTER, FAT32_ROOTDIR_CLUSTER);
+
+    LOG_DEBUG("Writing root directory to cluster %u (sector %llu)",
+           FAT32_ROOTDIR_CLUSTER, (unsigned long long)fat32_sector_for_cluster(fs, FAT32_ROOTDIR_CLUSTER));
+    if (!fat32_write_cluster(fs, FAT32_ROOTDIR_CLUSTER, root_dir)){
+        LOG_ERROR("Failed to write root directory");
+        free(root_dir);
+        return false;
+    }
+    LOG_DEBUG("Root directory written successfully");
+
+    free(root_dir);
+
+    fs->current_dir_cluster = FAT32_ROOTDIR_CLUSTER;
+    strcpy(fs->current_path, "/");
+    fs->is_formatted = true;
+
+    LOG_INFO("Formatting completed successfully");
+    return true;
 }
 
-bool fat32_read_cluster(FAT32_FileSystem *fs, uint32_t cluster, void *buffer) {
-    if (!fs || !buffer || !fs->is_formatted || cluster < 2 ) {
+bool fat32_change_directory(FAT32_FileSystem *fs, const char *path) {
+    TRACE_FUNCTION();
+    if (!fs || !fs->is_formatted || !path) {
+        return false;
+    }
+
+    if (path[0] != '/') {
+        return false;
+    }
+
+    if (strcmp(path, "/") == 0) {
+        fs->current_dir_cluster = fs->bootSector.BPB_RootClus;
+        strcpy(fs->current_path, "/");
+        return true;
+    }
+
+    uint32_t dir_cluster;
+    if (!resolve_directory(fs, path, &dir_cluster)) {
         return false;
     }
 
-    uint32_t first_sector = fat32_sector_for_cluster(fs, cluster);
-    return disk_read_sectors(&fs->disk, first_sector, fs->sectors_per_cluster, buffer);
+    fs->current_dir_cluster = dir_cluster;
+    strcpy(fs->current_path, path);
+
+    return true;
 }
 
-bool fat32_write_cluster(FAT32_FileSystem *fs, uint32_t cluster, const void *buffer) {
-    if (!fs || !buffer || cluster < 2) {
+static bool write_new_entry(FAT32_FileSystem *fs, uint32_t dir_cluster, const char *dir_path,
+                            const char *name, uint8_t attr, uint32_t first_cluster,
+                            uint32_t *out_cluster, int *out_index) {
+    TRACE_FUNCTION();
+    uint16_t units[FAT32_LFN_MAX_CHARS];
+    size_t length;
+    if (!is_valid_filename(name) || !utf8_to_utf16(name, units, FAT32_LFN_MAX_CHARS, &length)) {
+        return false;
+    }
+
+    char short_name[11];
+    uint8_t case_flags = 0;
+    uint32_t lfn_entries = 0;
+    if (!short_name_from_name(short_name, &case_flags, name)) {
+        if (!make_unique_short_name(fs, dir_cluster, name, short_name)) {
+            return false;
+        }
+        lfn_entries = (uint32_t)((length + FAT32_LFN_CHARS_PER_ENTRY - 1) / FAT32_LFN_CHARS_PER_ENTRY);
+    }
+
+    uint32_t run_cluster = 0;
+    uint32_t run_slot = 0;
+    uint32_t free_cluster = 0;
+    uint32_t free_slot = 0;
+    if (!find_free_run(fs, dir_cluster, lfn_entries + 1, &run_cluster, &run_slot, &free_cluster, &free_slot)) {
         return false;
     }
 
-    uint32_t first_sector = fat32_sector_for_cluster(fs, cluster);
-    return disk_write_sectors(&fs->disk, first_sector, fs->sectors_per_cluster, buffer);
+    uint8_t checksum = lfn_checksum(short_name);
+    uint32_t entries_per_cluster = fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
+    uint32_t entry_cluster = run_cluster;
+    uint32_t entry_slot = run_slot;
+    uint32_t written = 0;
+
+    while (true) {
+        uint8_t *cluster_data = cluster_get(fs, entry_cluster, true);
+        if (!cluster_data) {
+            return false;
+        }
+
+        FAT32_DirEntry *entries = (FAT32_DirEntry*)cluster_data;
+        for (; written < lfn_entries && entry_slot < entries_per_cluster; written++, entry_slot++) {
+            uint32_t ordinal = lfn_entries - written;
+            lfn_fill_entry((FAT32_LFNEntry*)&entries[entry_slot], units, length, ordinal,
+                           written == 0, checksum);
+        }
+
+        if (written == lfn_entries && entry_slot < entries_per_cluster) {
+            FAT32_DirEntry *entry = &entries[entry_slot];
+            memcpy(entry->DIR_Name, short_name, 11);
+            entry->DIR_Attr = attr;
+            entry->DIR_NTRes = case_flags;
+            entry->DIR_CrtTimeTenth = 0;
+            entry->DIR_CrtTime = get_fat_time();
+            entry->DIR_CrtDate = get_fat_date();
+            entry->DIR_LstAccDate = get_fat_date();
+            entry->DIR_FstClusHI = (first_cluster >> 16) & 0xFFFF;
+            entry->DIR_FstClusLO = first_cluster & 0xFFFF;
+            entry->DIR_WrtTime = get_fat_time();
+            entry->DIR_WrtDate = get_fat_date();
+            entry->DIR_FileSize = 0;
+            written++;
+        }
+
+        if (!cluster_put(fs, entry_cluster, cluster_data, true)) {
+            return false;
+        }
+
+        if (written > lfn_entries) {
+            break;
+        }
+
+        entry_cluster = fat32_get_next_cluster(fs, entry_cluster);
+        entry_slot = 0;
+        if (entry_cluster < 2 || entry_cluster >= FAT32_CLUSTER_END) {
+            return false;
+        }
+    }
+
+    invalidate_child_path(fs, dir_path, name);
+
+    DirIndex *index = dirindex_get(&fs->dir_index, dir_cluster);
+    if (index) {
+        bool indexed = dirindex_insert(&fs->dir_index, index, short_name, entry_cluster, entry_slot);
+        if (indexed && lfn_entries > 0) {
+            indexed = dirindex_insert_long(&fs->dir_index, index, lfn_name_hash(units, length),
+                                           short_name, run_cluster, run_slot);
+        }
+
+        if (indexed) {
+            index->has_free_hint = true;
+            if (free_cluster == run_cluster && free_slot == run_slot) {
+                index->free_cluster = entry_cluster;
+                index->free_slot = entry_slot + 1;
+            } else {
+                index->free_cluster = free_cluster;
+                index->free_slot = free_slot;
+            }
+        } else {
+            dirindex_drop(&fs->dir_index, dir_cluster);
+        }
+    }
+
+    if (out_cluster) {
+        *out_cluster = entry_cluster;
+    }
+    if (out_index) {
+        *out_index = (int)entry_slot;
+    }
+    return true;
 }
 
+bool fat32_create_directory(FAT32_FileSystem *fs, const char *name) {
+    TRACE_FUNCTION();
+    if (!fs || !fs->is_formatted || !name || name[0] == '\0') {
+        return false;
+    }
+
+    if (find_entry_by_name(fs, fs->current_dir_cluster, name, NULL) >= 0) {
+        return false;
+    }
 
-bool fat32_format(FAT32_FileSystem *fs) {
+    uint32_t new_dir_cluster = fat32_allocate_cluster(fs);
+    if (new_dir_cluster == 0) {
+        return false;
+    }
+
+    dirindex_drop(&fs->dir_index, new_dir_cluster);
+
+    if (!write_new_entry(fs, fs->current_dir_cluster, fs->current_path, name,
+                         FAT32_ATTR_DIRECTORY, new_dir_cluster, NULL, NULL)) {
+        fat32_set_cluster_value(fs, new_dir_cluster, FAT32_CLUSTER_FREE);
+        return false;
+    }
+
+    uint8_t *new_dir_data = cluster_get(fs, new_dir_cluster, false);
+    if (!new_dir_data) {
+        fat32_set_cluster_value(fs, new_dir_cluster, FAT32_CLUSTER_FREE);
+        return false;
+    }
+
+    init_dot_entries((FAT32_DirEntry*)new_dir_data, new_dir_cluster, fs->current_dir_cluster);
+
+    if (!cluster_put(fs, new_dir_cluster, new_dir_data, true)) {
+        fat32_set_cluster_value(fs, new_dir_cluster, FAT32_CLUSTER_FREE);
+        return false;
+    }
+
+    return commit_changes(fs);
+}
+
+bool fat32_create_file(FAT32_FileSystem *fs, const char *name) {
+    TRACE_FUNCTION();
+    if (!fs || !fs->is_formatted || !name || name[0] == '\0') {
+        return false;
+    }
+
+    if (find_entry_by_name(fs, fs->current_dir_cluster, name, NULL) >= 0) {
+        return false;
+    }
+
+    if (!write_new_entry(fs, fs->current_dir_cluster, fs->current_path, name,
+                         FAT32_ATTR_ARCHIVE, 0, NULL, NULL)) {
+        return false;
+    }
+
+    return commit_changes(fs);
+}
+
+void fat32_close(FAT32_FileSystem *fs) {
+    TRACE_FUNCTION();
     if (!fs) {
+        return;
+    }
+
+    if (fs->is_formatted) {
+        fat32_sync(fs);
+        if (fs->fat_cache.defer_mirrors) {
+            mirrors_defer(fs, false);
+        }
+    }
+    cache_destroy(&fs->cache);
+    fat_map_close(fs, true);
+    fat_cache_close(fs, true);
+    disk_sync(&fs->disk);
+
+    free_index_destroy(fs);
+    dirindex_destroy(&fs->dir_index);
+    dentry_destroy(&fs->dentries);
+
+    disk_close(&fs->disk);
+
+    fs->is_formatted = false;
+}
+
+bool fat32_list_directory(FAT32_FileSystem *fs, const char *path, FAT32_DirEntry *entries,
+                          uint32_t max_entries, uint32_t *count) {
+    TRACE_FUNCTION();
+    if (!fs || !fs->is_formatted || !entries || !count) {
         return false;
     }
 
-    memset(&fs->bootSector, 0, sizeof(FAT32_BootSector));
+    *count = 0;
 
-    fs->bootSector.BS_jmpBoot[0] = 0xEB;
-    fs->bootSector.BS_jmpBoot[1] = 0x58;
-    fs->bootSector.BS_jmpBoot[2] = 0x90;
+    uint32_t dir_cluster;
 
-    memcpy(fs->bootSector.BS_OEMName, "MSWIN4.1", 8);
-    fs->bootSector.BPB_BytesPerSec = 512;
-    fs->bootSector.BPB_SecPerClus = 4;
-    fs->bootSector.BPB_RsvdSecCnt = 32;
-    fs->bootSector.BPB_NumFATs = 2;
-    fs->bootSector.BPB_RootEntCnt = 0;
-    fs->bootSector.BPB_TotSec16 = 0;
-    fs->bootSector.BPB_Media = 0xF8;
-    fs->bootSector.BPB_FATSz16 = 0;
-    fs->bootSector.BPB_SecPerTrk = 63;
-    fs->bootSector.BPB_NumHeads = 255;
-    fs->bootSector.BPB_HiddSec = 0;
+    if (path == NULL) {
+        dir_cluster = fs->current_dir_cluster;
+    } else if (!resolve_directory(fs, path, &dir_cluster)) {
+        return false;
+    }
 
-    uint32_t total_sectors = disk_get_total_sectors(&fs->disk);
-    printf("Debug: Total sectors: %u\n", total_sectors);
+    uint32_t current_cluster = dir_cluster;
+    uint32_t entries_per_cluster = fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
 
-    fs->bootSector.BPB_TotSec32 = total_sectors;
+    while (current_cluster >= 2 && current_cluster < FAT32_CLUSTER_END) {
+        uint8_t *cluster_data = cluster_get(fs, current_cluster, true);
+        fs->stats.dir_clusters_scanned++;
+        if (!cluster_data) {
+            return false;
+        }
 
-    uint32_t data_sectors = total_sectors - fs->bootSector.BPB_RsvdSecCnt;
-    uint32_t clusters = data_sectors / fs->bootSector.BPB_SecPerClus;
+        FAT32_DirEntry *dir_entries = (FAT32_DirEntry*)cluster_data;
 
-    uint32_t fat_size = ((clusters * 4) + 512 - 1) / 512;
+        for (uint32_t i = 0; i < entries_per_cluster && *count < max_entries; i++) {
+            if (dir_entries[i].DIR_Name[0] == 0x00) {
+                break;
+            }
 
-    data_sectors = total_sectors - fs->bootSector.BPB_RsvdSecCnt - (fat_size * fs->bootSector.BPB_NumFATs);
-    clusters = data_sectors / fs->bootSector.BPB_SecPerClus;
-    fat_size = ((clusters * 4) + 512 - 1) / 512;
+            if ((uint8_t)dir_entries[i].DIR_Name[0] == 0xE5 || is_lfn_entry(&dir_entries[i])) {
+                continue;
+            }
 
-    printf("Debug: FAT size: %u sectors\n", fat_size);
-    printf("Debug: Clusters: %u\n", clusters);
+            memcpy(&entries[*count], &dir_entries[i], sizeof(FAT32_DirEntry));
+            (*count)++;
+        }
 
-    fs->bootSector.BPB_FATSz32 = fat_size;
-    fs->bootSector.BPB_ExtFlags = 0;
-    fs->bootSector.BPB_FSVer = 0;
-    fs->bootSector.BPB_RootClus = FAT32_ROOTDIR_CLUSTER;
-    fs->bootSector.BPB_FSInfo = 1;
-    fs->bootSector.BPB_BkBootSec = 6;
-    memset(fs->bootSector.BPB_Reserved, 0, 12);
+        cluster_put(fs, current_cluster, cluster_data, false);
 
-    fs->bootSector.BS_DrvNum = 0x80;
-    fs->bootSector.BS_Reserved1 = 0;
-    fs->bootSector.BS_BootSig = 0x29;
-    fs->bootSector.BS_VolID = (uint32_t)time(NULL);
-    memcpy(fs->bootSector.BS_VolLab, "NO NAME    ", 11);
-    memcpy(fs->bootSector.BS_FilSysType, "FAT32   ", 8);
+        current_cluster = fat32_get_next_cluster(fs, current_cluster);
+    }
 
-    memset(fs->bootSector.BootCode, 0, 420);
-    fs->bootSector.BootSignature = FAT32_SIGNATURE;
+    return true;
+}
+
+bool fat32_read_directory(FAT32_FileSystem *fs, const char *path, FAT32_DirInfo *infos,
+                          uint32_t max_entries, uint32_t *count) {
+    TRACE_FUNCTION();
+    if (!fs || !fs->is_formatted || !infos || !count) {
+        return false;
+    }
+
+    *count = 0;
+
+    uint32_t dir_cluster;
 
-    printf("Debug: Writing boot sector...\n");
-    if (!fat32_write_boot_sector(fs)) {
-        printf("Debug: Failed to write boot sector\n");
+    if (path == NULL) {
+        dir_cluster = fs->current_dir_cluster;
+    } else if (!resolve_directory(fs, path, &dir_cluster)) {
         return false;
     }
-    printf("Debug: Boot sector written successfully\n");
 
-    fs->sectors_per_cluster = fs->bootSector.BPB_SecPerClus;
-    fs->fat_size = fs->bootSector.BPB_FATSz32;
-    fs->bytes_per_cluster = fs->bootSector.BPB_BytesPerSec * fs->sectors_per_cluster;
-    fs->first_data_sector = fs->bootSector.BPB_RsvdSecCnt +
-                            (fs->bootSector.BPB_NumFATs * fs->fat_size);
+    uint32_t current_cluster = dir_cluster;
+    uint32_t entries_per_cluster = fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
+    LongNameRun run;
+    lfn_run_reset(&run);
+
+    while (current_cluster >= 2 && current_cluster < FAT32_CLUSTER_END) {
+        uint8_t *cluster_data = cluster_get(fs, current_cluster, true);
+        fs->stats.dir_clusters_scanned++;
+        if (!cluster_data) {
+            return false;
+        }
+
+        FAT32_DirEntry *dir_entries = (FAT32_DirEntry*)cluster_data;
+
+        for (uint32_t i = 0; i < entries_per_cluster && *count < max_entries; i++) {
+            if (dir_entries[i].DIR_Name[0] == 0x00) {
+                break;
+            }
+
+            if ((uint8_t)dir_entries[i].DIR_Name[0] == 0xE5) {
+                lfn_run_reset(&run);
+                continue;
+            }
+
+            if (is_lfn_entry(&dir_entries[i])) {
+                lfn_run_add(&run, &dir_entries[i], current_cluster, i);
+                continue;
+            }
+
+            FAT32_DirInfo *info = &infos[*count];
+            memcpy(&info->entry, &dir_entries[i], sizeof(FAT32_DirEntry));
+
+            size_t length;
+            if (lfn_run_complete(&run, &dir_entries[i], &length)) {
+                utf16_to_utf8(run.units, length, info->name, sizeof(info->name));
+            } else {
+                convert_from_short_name_case(info->name, dir_entries[i].DIR_Name, dir_entries[i].DIR_NTRes);
+            }
+            lfn_run_reset(&run);
+            (*count)++;
+        }
+
+        cluster_put(fs, current_cluster, cluster_data, false);
+
+        current_cluster = fat32_get_next_cluster(fs, current_cluster);
+    }
+
+    return true;
+}
+
+static bool is_chain_end(uint32_t cluster) {
+    return cluster < 2 || cluster >= FAT32_CLUSTER_BAD;
+}
+
+static void free_chain(FAT32_FileSystem *fs, uint32_t cluster) {
+    uint32_t limit = fs->data_cluster_count;
 
-    uint32_t data_sector_count = total_sectors - fs->first_data_sector;
-    fs->data_cluster_count = data_sector_count / fs->sectors_per_cluster;
+    while (!is_chain_end(cluster) && limit-- > 0) {
+        uint32_t next = fat32_get_next_cluster(fs, cluster);
+        fat32_set_cluster_value(fs, cluster, FAT32_CLUSTER_FREE);
+        cluster = next;
+    }
+}
 
-    printf("Debug: First data sector: %u\n", fs->first_data_sector);
-    printf("Debug: Data clusters: %u\n", fs->data_cluster_count);
+static bool data_read(FAT32_FileSystem *fs, uint32_t cluster, uint32_t count, void *buffer) {
+    uint64_t sector = fat32_sector_for_cluster(fs, cluster);
+    uint64_t sector_count = (uint64_t)count * fs->sectors_per_cluster;
 
-    printf("Debug: Freeing FAT if exists...\n");
-    if (fs->fat != NULL) {
-        free(fs->fat);
-        fs->fat = NULL;
+    if (fs->cache.buckets && !cache_write_back_range(&fs->cache, sector, sector_count)) {
+        return false;
     }
+    return disk_read_sectors(&fs->disk, sector, (uint32_t)sector_count, buffer);
+}
+
+static bool data_write(FAT32_FileSystem *fs, uint32_t cluster, uint32_t count, const void *buffer) {
+    uint64_t sector = fat32_sector_for_cluster(fs, cluster);
+    uint64_t sector_count = (uint64_t)count * fs->sectors_per_cluster;
+
+    cache_discard_range(&fs->cache, sector, sector_count);
+    return disk_write_sectors(&fs->disk, sector, (uint32_t)sector_count, buffer);
+}
 
-    uint32_t fat_size_bytes = fs->fat_size * fs->bootSector.BPB_BytesPerSec;
-    printf("Debug: Allocating FAT: %u bytes\n", fat_size_bytes);
+static bool file_flush_buffer(FAT32_File *file) {
+    if (!file->buffer_dirty) {
+        return true;
+    }
 
-    fs->fat = (uint32_t*)calloc(1, fat_size_bytes);
-    if (!fs->fat) {
-        printf("Debug: Failed to allocate memory for FAT\n");
+    if (!data_write(file->fs, file->buffer_cluster, 1, file->buffer)) {
         return false;
     }
-    printf("Debug: FAT allocated successfully\n");
 
-    fs->fat[0] = 0x0FFFFF00 | fs->bootSector.BPB_Media;
-    fs->fat[1] = 0x0FFFFFFF;
+    file->buffer_dirty = false;
+    return true;
+}
 
-    fs->fat[FAT32_ROOTDIR_CLUSTER] = FAT32_CLUSTER_END;
+static bool file_load_buffer(FAT32_File *file, uint32_t cluster, bool zero) {
+    if (file->buffer_cluster == cluster) {
+        return true;
+    }
 
-    printf("Debug: Writing FAT to sectors %u-%u\n", fs->bootSector.BPB_RsvdSecCnt,
-           fs->bootSector.BPB_RsvdSecCnt + fs->fat_size - 1);
-    if (!fat32_write_fat(fs)) {
-        printf("Debug: Failed to write FAT\n");
-        free(fs->fat);
-        fs->fat = NULL;
+    if (!file_flush_buffer(file)) {
         return false;
     }
-    printf("Debug: FAT written successfully\n");
 
-    printf("Debug: Allocating root directory...\n");
-    uint8_t *root_dir = (uint8_t*)calloc(1, fs->bytes_per_cluster);
-    if (!root_dir) {
-        printf("Debug: Failed to allocate memory for root directory\n");
-        free(fs->fat);
-        fs->fat = NULL;
+    file->buffer_cluster = 0;
+    if (zero) {
+        memset(file->buffer, 0, file->fs->bytes_per_cluster);
+    } else if (!data_read(file->fs, cluster, 1, file->buffer)) {
         return false;
     }
-    printf("Debug: Root directory allocated successfully\n");
 
-    FAT32_DirEntry *dir_entries = (FAT32_DirEntry*)root_dir;
+    file->buffer_cluster = cluster;
+    return true;
+}
 
-    memset(dir_entries[0].DIR_Name, ' ', 11);
-    dir_entries[0].DIR_Name[0] = '.';
-    dir_entries[0].DIR_Attr = FAT32_ATTR_DIRECTORY;
-    dir_entries[0].DIR_CrtTime = get_fat_time();
-    dir_entries[0].DIR_CrtDate = get_fat_date();
-    dir_entries[0].DIR_LstAccDate = get_fat_date();
-    dir_entries[0].DIR_WrtTime = get_fat_time();
-    dir_entries[0].DIR_WrtDate = get_fat_date();
-    dir_entries[0].DIR_FstClusHI = (FAT32_ROOTDIR_CLUSTER >> 16) & 0xFFFF;
-    dir_entries[0].DIR_FstClusLO = FAT32_ROOTDIR_CLUSTER & 0xFFFF;
-    dir_entries[0].DIR_FileSize = 0;
+static bool file_push_extent(FAT32_File *file, uint32_t physical, uint32_t length) {
+    if (file->extent_count > 0) {
+        FAT32_Extent *last = &file->extents[file->extent_count - 1];
+        if (last->physical + last->length == physical) {
+            last->length += length;
+            file->cluster_count += length;
+            return true;
+        }
+    }
 
-    memset(dir_entries[1].DIR_Name, ' ', 11);
-    dir_entries[1].DIR_Name[0] = '.';
-    dir_entries[1].DIR_Name[1] = '.';
-    dir_entries[1].DIR_Attr = FAT32_ATTR_DIRECTORY;
-    dir_entries[1].DIR_CrtTime = get_fat_time();
-    dir_entries[1].DIR_CrtDate = get_fat_date();
-    dir_entries[1].DIR_LstAccDate = get_fat_date();
-    dir_entries[1].DIR_WrtTime = get_fat_time();
-    dir_entries[1].DIR_WrtDate = get_fat_date();
-    dir_entries[1].DIR_FstClusHI = (FAT32_ROOTDIR_CLUSTER >> 16) & 0xFFFF;
-    dir_entries[1].DIR_FstClusLO = FAT32_ROOTDIR_CLUSTER & 0xFFFF;
-    dir_entries[1].DIR_FileSize = 0;
+    if (file->extent_count == file->extent_capacity) {
+        uint32_t capacity = file->extent_capacity ? file->extent_capacity * 2 : 8;
+        FAT32_Extent *extents = (FAT32_Extent*)realloc(file->extents, capacity * sizeof(FAT32_Extent));
+        if (!extents) {
+            return false;
+        }
+        file->extents = extents;
+        file->extent_capacity = capacity;
+    }
 
-    printf("Debug: Writing root directory to cluster %u (sector %u)\n",
-           FAT32_ROOTDIR_CLUSTER, fat32_sector_for_cluster(fs, FAT32_ROOTDIR_CLUSTER));
-    if (!fat32_write_cluster(fs, FAT32_ROOTDIR_CLUSTER, root_dir)){
-        printf("Debug: Failed to write root directory\n");
-        free(root_dir);
-        free(fs->fat);
-        fs->fat = NULL;
-        return false;
+    FAT32_Extent *extent = &file->extents[file->extent_count++];
+    extent->logical = file->cluster_count;
+    extent->physical = physical;
+    extent->length = length;
+    file->cluster_count += length;
+    return true;
+}
+
+static uint32_t file_next_run(FAT32_FileSystem *fs, uint32_t cluster, uint32_t *length) {
+    uint32_t next;
+    if (fs->fat_map.runs && cluster >= 2 && fatmap_run(&fs->fat_map, cluster, length, &next)) {
+        return next;
     }
-    printf("Debug: Root directory written successfully\n");
 
-    free(root_dir);
+    *length = 1;
+    return fat32_get_next_cluster(fs, cluster);
+}
 
-    fs->current_dir_cluster = FAT32_ROOTDIR_CLUSTER;
-    strcpy(fs->current_path, "/");
-    fs->is_formatted = true;
+static bool file_load_extents(FAT32_File *file) {
+    TRACE_FUNCTION();
+    if (file->extents_loaded) {
+        return true;
+    }
+
+    file->extent_count = 0;
+    file->cluster_count = 0;
+
+    uint32_t cluster = file->first_cluster;
+    uint32_t limit = file->fs->data_cluster_count;
+
+    while (!is_chain_end(cluster) && file->cluster_count < limit) {
+        uint32_t length;
+        uint32_t next = file_next_run(file->fs, cluster, &length);
+        if (length > limit - file->cluster_count) {
+            length = limit - file->cluster_count;
+        }
+        if (!file_push_extent(file, cluster, length)) {
+            return false;
+        }
+        cluster = next;
+    }
 
-    printf("Debug: Formatting completed successfully\n");
+    file->extents_loaded = true;
     return true;
 }
 
-bool fat32_change_directory(FAT32_FileSystem *fs, const char *path) {
-    if (!fs || !fs->is_formatted || !path) {
+static bool file_append_cluster(FAT32_File *file) {
+    FAT32_FileSystem *fs = file->fs;
+
+    uint32_t cluster = fat32_allocate_cluster(fs);
+    if (cluster == 0) {
         return false;
     }
 
-    if (path[0] != '/') {
+    if (!file_push_extent(file, cluster, 1)) {
+        fat32_set_cluster_value(fs, cluster, FAT32_CLUSTER_FREE);
         return false;
     }
 
-    if (strcmp(path, "/") == 0) {
-        fs->current_dir_cluster = fs->bootSector.BPB_RootClus;
-        strcpy(fs->current_path, "/");
-        return true;
+    if (file->cluster_count == 1) {
+        file->first_cluster = cluster;
+        file->modified = true;
+    } else {
+        FAT32_Extent *last = &file->extents[file->extent_count - 1];
+        uint32_t previous = last->length > 1 ? cluster - 1
+                          : file->extents[file->extent_count - 2].physical
+                            + file->extents[file->extent_count - 2].length - 1;
+        fat32_set_cluster_value(fs, previous, cluster);
     }
+    return true;
+}
 
-    char path_components[256][13];
-    int path_components_count = 0;
+static bool file_append_clusters(FAT32_File *file, uint32_t count) {
+    FAT32_FileSystem *fs = file->fs;
+    uint32_t last = 0;
+    if (file->extent_count > 0) {
+        FAT32_Extent *extent = &file->extents[file->extent_count - 1];
+        last = extent->physical + extent->length - 1;
+    }
 
-    if (!parse_path(path, path_components, &path_components_count)) {
+    uint32_t first;
+    if (!fat32_allocate_clusters(fs, count, last, &first)) {
         return false;
     }
 
-    uint32_t dir_cluster = fs->bootSector.BPB_RootClus;
+    if (file->cluster_count == 0) {
+        file->first_cluster = first;
+        file->modified = true;
+    }
 
-    for (int i = 0; i < path_components_count; i++) {
-        int entry_index = find_entry_by_name(fs, dir_cluster, path_components[i]);
-        if (entry_index < 0) {
-            return false;
+    uint32_t cluster = first;
+    while (count > 0) {
+        uint32_t length;
+        uint32_t next = file_next_run(fs, cluster, &length);
+        if (length > count) {
+            length = count;
         }
-
-        uint8_t *cluster_data = (uint8_t*)malloc(fs->bytes_per_cluster);
-        if (!cluster_data) {
+        if (!file_push_extent(file, cluster, length)) {
+            file->extents_loaded = false;
             return false;
         }
+        count -= length;
+        cluster = next;
+    }
+    return true;
+}
 
-        uint32_t current_cluster = dir_cluster;
-        while (entry_index >= fs->bytes_per_cluster / sizeof(FAT32_DirEntry)) {
-            entry_index -= fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
-            current_cluster = fat32_get_next_cluster(fs, current_cluster);
-        }
+static uint32_t file_map(FAT32_File *file, uint32_t index, uint32_t max_clusters,
+                         bool allocate, uint32_t *run) {
+    if (!file_load_extents(file)) {
+        return 0;
+    }
 
-        if (!fat32_read_cluster(fs, current_cluster, cluster_data)) {
-            free(cluster_data);
-            return false;
+    if (allocate && file->cluster_count < index + max_clusters
+        && !file_append_clusters(file, index + max_clusters - file->cluster_count)) {
+        while (file->cluster_count < index + max_clusters && file_append_cluster(file)) {
         }
+    }
 
-        FAT32_DirEntry *dir_entries = (FAT32_DirEntry*)cluster_data;
+    if (index >= file->cluster_count) {
+        return 0;
+    }
 
-        if (!(dir_entries[entry_index].DIR_Attr & FAT32_ATTR_DIRECTORY)) {
-            free(cluster_data);
-            return false;
+    uint32_t low = 0;
+    uint32_t high = file->extent_count - 1;
+    while (low < high) {
+        uint32_t mid = low + (high - low + 1) / 2;
+        if (file->extents[mid].logical <= index) {
+            low = mid;
+        } else {
+            high = mid - 1;
         }
+    }
 
-        dir_cluster = ((uint32_t)dir_entries[entry_index].DIR_FstClusHI << 16)
-                               | dir_entries[entry_index].DIR_FstClusLO;
+    FAT32_Extent *extent = &file->extents[low];
+    uint32_t skip = index - extent->logical;
+    uint32_t available = extent->length - skip;
+    *run = available < max_clusters ? available : max_clusters;
+    return extent->physical + skip;
+}
 
-        free(cluster_data);
+static bool make_absolute_path(FAT32_FileSystem *fs, const char *path, char *out) {
+    if (path[0] == '/') {
+        if (strlen(path) >= 256) {
+            return false;
+        }
+        strcpy(out, path);
+        path_normalize(out);
+        return true;
     }
 
-    fs->current_dir_cluster = dir_cluster;
-    strcpy(fs->current_path, path);
+    if (strlen(fs->current_path) + strlen(path) + 2 > 256) {
+        return false;
+    }
 
+    path_combine(out, fs->current_path, path);
     return true;
 }
 
-bool fat32_create_directory(FAT32_FileSystem *fs, const char *name) {
-    if (!fs || !fs->is_formatted || !name || name[0] == '\0') {
+bool fat32_open(FAT32_FileSystem *fs, const char *path, uint32_t flags, FAT32_File *file) {
+    TRACE_FUNCTION();
+    if (!fs || !fs->is_formatted || !path || path[0] == '\0' || !file) {
         return false;
     }
 
-    if (find_entry_by_name(fs, fs->current_dir_cluster, name) >= 0) {
+    if (!(flags & (FAT32_O_READ | FAT32_O_WRITE))) {
         return false;
     }
 
-    uint32_t new_dir_cluster = fat32_allocate_cluster(fs);
-    if (new_dir_cluster == 0) {
+    if ((flags & (FAT32_O_CREATE | FAT32_O_TRUNC | FAT32_O_APPEND)) && !(flags & FAT32_O_WRITE)) {
         return false;
     }
 
-    uint32_t free_entry_cluster;
-    int free_entry_index = find_free_entry(fs, fs->current_dir_cluster, &free_entry_cluster);
-    if (free_entry_index < 0) {
-        fat32_set_cluster_value(fs, new_dir_cluster, FAT32_CLUSTER_FREE);
+    memset(file, 0, sizeof(FAT32_File));
+    if (!make_absolute_path(fs, path, file->path)) {
         return false;
     }
 
-    uint8_t *parent_cluster_data = (uint8_t*)malloc(fs->bytes_per_cluster);
-    if (!parent_cluster_data) {
-        fat32_set_cluster_value(fs, new_dir_cluster, FAT32_CLUSTER_FREE);
+    char parent_path[256];
+    char name[256];
+    path_get_parent(parent_path, file->path);
+    path_get_filename(name, file->path);
+    if (name[0] == '\0') {
         return false;
     }
 
-    if (!fat32_read_cluster(fs, free_entry_cluster, parent_cluster_data)) {
-        free(parent_cluster_data);
-        fat32_set_cluster_value(fs, new_dir_cluster, FAT32_CLUSTER_FREE);
+    uint32_t dir_cluster;
+    if (!resolve_directory(fs, parent_path, &dir_cluster)) {
         return false;
     }
 
-    FAT32_DirEntry *parent_entries = (FAT32_DirEntry*)parent_cluster_data;
+    uint32_t entry_cluster;
+    int entry_index = find_entry_by_name(fs, dir_cluster, name, &entry_cluster);
+    if (entry_index < 0) {
+        if (!(flags & FAT32_O_CREATE)) {
+            return false;
+        }
 
-    char short_name[11];
-    convert_to_short_name(short_name, name);
-    memcpy(parent_entries[free_entry_index].DIR_Name, short_name, 11);
-
-    parent_entries[free_entry_index].DIR_Attr = FAT32_ATTR_DIRECTORY;
-    parent_entries[free_entry_index].DIR_NTRes = 0;
-    parent_entries[free_entry_index].DIR_CrtTimeTenth = 0;
-    parent_entries[free_entry_index].DIR_CrtTime = get_fat_time();
-    parent_entries[free_entry_index].DIR_CrtDate = get_fat_date();
-    parent_entries[free_entry_index].DIR_LstAccDate = get_fat_date();
-    parent_entries[free_entry_index].DIR_FstClusHI = (new_dir_cluster >> 16) & 0xFFFF;
-    parent_entries[free_entry_index].DIR_FstClusLO = new_dir_cluster & 0xFFFF;
-    parent_entries[free_entry_index].DIR_WrtTime = get_fat_time();
-    parent_entries[free_entry_index].DIR_WrtDate = get_fat_date();
-    parent_entries[free_entry_index].DIR_FileSize = 0;
-
-    if (!fat32_write_cluster(fs, free_entry_cluster, parent_cluster_data)) {
-        free(parent_cluster_data);
-        fat32_set_cluster_value(fs, new_dir_cluster, FAT32_CLUSTER_FREE);
-        return false;
-    }
+        if (!write_new_entry(fs, dir_cluster, parent_path, name, FAT32_ATTR_ARCHIVE, 0,
+                             &entry_cluster, &entry_index)) {
+            return false;
+        }
+        file->modified = true;
+    } else {
+        FAT32_DirEntry entry;
+        if (!read_dir_entry(fs, entry_cluster, entry_index, &entry)) {
+            return false;
+        }
 
-    free(parent_cluster_data);
+        if (entry.DIR_Attr & (FAT32_ATTR_DIRECTORY | FAT32_ATTR_VOLUME_ID)) {
+            return false;
+        }
 
-    uint8_t *new_dir_data = (uint8_t*)calloc(1, fs->bytes_per_cluster);
-    if (!new_dir_data) {
-        fat32_set_cluster_value(fs, new_dir_cluster, FAT32_CLUSTER_FREE);
-        return false;
+        if ((flags & FAT32_O_WRITE) && (entry.DIR_Attr & FAT32_ATTR_READ_ONLY)) {
+            return false;
+        }
+
+        file->first_cluster = ((uint32_t)entry.DIR_FstClusHI << 16) | entry.DIR_FstClusLO;
+        file->size = entry.DIR_FileSize;
     }
 
-    FAT32_DirEntry *new_dir_entries = (FAT32_DirEntry*)new_dir_data;
-
-    memset(new_dir_entries[0].DIR_Name, ' ', 11);
-    new_dir_entries[0].DIR_Name[0] = '.';
-    new_dir_entries[0].DIR_Attr = FAT32_ATTR_DIRECTORY;
-    new_dir_entries[0].DIR_CrtTime = get_fat_time();
-    new_dir_entries[0].DIR_CrtDate = get_fat_date();
-    new_dir_entries[0].DIR_LstAccDate = get_fat_date();
-    new_dir_entries[0].DIR_WrtTime = get_fat_time();
-    new_dir_entries[0].DIR_WrtDate = get_fat_date();
-    new_dir_entries[0].DIR_FstClusHI = (new_dir_cluster >> 16) & 0xFFFF;
-    new_dir_entries[0].DIR_FstClusLO = new_dir_cluster & 0xFFFF;
-    new_dir_entries[0].DIR_FileSize = 0;
-
-    memset(new_dir_entries[1].DIR_Name, ' ', 11);
-    new_dir_entries[1].DIR_Name[0] = '.';
-    new_dir_entries[1].DIR_Name[1] = '.';
-    new_dir_entries[1].DIR_Attr = FAT32_ATTR_DIRECTORY;
-    new_dir_entries[1].DIR_CrtTime = get_fat_time();
-    new_dir_entries[1].DIR_CrtDate = get_fat_date();
-    new_dir_entries[1].DIR_LstAccDate = get_fat_date();
-    new_dir_entries[1].DIR_WrtTime = get_fat_time();
-    new_dir_entries[1].DIR_WrtDate = get_fat_date();
-    new_dir_entries[1].DIR_FstClusHI = (fs->current_dir_cluster >> 16) & 0xFFFF;
-    new_dir_entries[1].DIR_FstClusLO = fs->current_dir_cluster & 0xFFFF;
-    new_dir_entries[1].DIR_FileSize = 0;
-
-    if (!fat32_write_cluster(fs, new_dir_cluster, new_dir_data)) {
-        free(new_dir_data);
-        fat32_set_cluster_value(fs, new_dir_cluster, FAT32_CLUSTER_FREE);
+    file->buffer = (uint8_t*)malloc(fs->bytes_per_cluster);
+    if (!file->buffer) {
         return false;
     }
 
-    free(new_dir_data);
+    file->fs = fs;
+    file->flags = flags;
+    file->entry_cluster = entry_cluster;
+    file->entry_index = (uint32_t)entry_index;
+
+    if ((flags & FAT32_O_TRUNC) && (file->first_cluster != 0 || file->size != 0)) {
+        free_chain(fs, file->first_cluster);
+        file->first_cluster = 0;
+        file->size = 0;
+        file->modified = true;
+        file->extent_count = 0;
+        file->cluster_count = 0;
+        file->extents_loaded = true;
+    }
+
+    if (flags & FAT32_O_APPEND) {
+        file->position = file->size;
+    }
 
     return true;
 }
 
-bool fat32_create_file(FAT32_FileSystem *fs, const char *name) {
-    if (!fs || !fs->is_formatted || !name || name[0] == '\0') {
-        return false;
-    }
+static uint32_t file_read_at(FAT32_File *file, uint8_t *dest, uint32_t length, uint32_t position) {
+    FAT32_FileSystem *fs = file->fs;
+    uint32_t done = 0;
 
-    if (find_entry_by_name(fs, fs->current_dir_cluster, name) >= 0) {
-        return false;
+    if (position >= file->size) {
+        return 0;
     }
-
-    uint32_t free_entry_cluster;
-    int free_entry_index = find_free_entry(fs, fs->current_dir_cluster, &free_entry_cluster);
-    if (free_entry_index < 0) {
-        return false;
+    if (length > file->size - position) {
+        length = file->size - position;
     }
 
-    uint8_t *parent_cluster_data = (uint8_t*)malloc(fs->bytes_per_cluster);
-    if (!parent_cluster_data) {
-        return false;
+    while (done < length) {
+        uint32_t index = position / fs->bytes_per_cluster;
+        uint32_t offset = position % fs->bytes_per_cluster;
+        uint32_t remaining = length - done;
+        uint32_t chunk;
+        uint32_t run;
+
+        if (offset == 0 && remaining >= fs->bytes_per_cluster) {
+            uint32_t cluster = file_map(file, index, remaining / fs->bytes_per_cluster, false, &run);
+            if (cluster == 0) {
+                break;
+            }
+
+            if (file->buffer_dirty && file->buffer_cluster >= cluster
+                && file->buffer_cluster < cluster + run && !file_flush_buffer(file)) {
+                break;
+            }
+
+            if (!data_read(fs, cluster, run, dest + done)) {
+                break;
+            }
+            chunk = run * fs->bytes_per_cluster;
+        } else {
+            uint32_t cluster = file_map(file, index, 1, false, &run);
+            if (cluster == 0 || !file_load_buffer(file, cluster, false)) {
+                break;
+            }
+
+            chunk = fs->bytes_per_cluster - offset;
+            if (chunk > remaining) {
+                chunk = remaining;
+            }
+            memcpy(dest + done, file->buffer + offset, chunk);
+        }
+
+        done += chunk;
+        position += chunk;
     }
 
-    if (!fat32_read_cluster(fs, free_entry_cluster, parent_cluster_data)) {
-        free(parent_cluster_data);
-        return false;
+    return done;
+}
+
+static uint32_t file_write_at(FAT32_File *file, const uint8_t *src, uint32_t length, uint32_t position) {
+    FAT32_FileSystem *fs = file->fs;
+    uint32_t done = 0;
+
+    if (length > UINT32_MAX - position) {
+        length = UINT32_MAX - position;
     }
 
-    FAT32_DirEntry *parent_entries = (FAT32_DirEntry*)parent_cluster_data;
+    while (done < length) {
+        uint32_t index = position / fs->bytes_per_cluster;
+        uint32_t offset = position % fs->bytes_per_cluster;
+        uint32_t remaining = length - done;
+        uint32_t chunk;
+        uint32_t run;
 
-    char short_name[11];
-    convert_to_short_name(short_name, name);
-    memcpy(parent_entries[free_entry_index].DIR_Name, short_name, 11);
+        if (offset == 0 && remaining >= fs->bytes_per_cluster) {
+            uint32_t cluster = file_map(file, index, remaining / fs->bytes_per_cluster, true, &run);
+            if (cluster == 0) {
+                break;
+            }
+
+            if (file->buffer_cluster >= cluster && file->buffer_cluster < cluster + run) {
+                file->buffer_cluster = 0;
+                file->buffer_dirty = false;
+            }
 
-    parent_entries[free_entry_index].DIR_Attr = FAT32_ATTR_ARCHIVE;
-    parent_entries[free_entry_index].DIR_NTRes = 0;
-    parent_entries[free_entry_index].DIR_CrtTimeTenth = 0;
-    parent_entries[free_entry_index].DIR_CrtTime = get_fat_time();
-    parent_entries[free_entry_index].DIR_CrtDate = get_fat_date();
-    parent_entries[free_entry_index].DIR_LstAccDate = get_fat_date();
-    parent_entries[free_entry_index].DIR_FstClusHI = 0;
-    parent_entries[free_entry_index].DIR_FstClusLO = 0;
-    parent_entries[free_entry_index].DIR_WrtTime = get_fat_time();
-    parent_entries[free_entry_index].DIR_WrtDate = get_fat_date();
-    parent_entries[free_entry_index].DIR_FileSize = 0;
+            if (!data_write(fs, cluster, run, src + done)) {
+                break;
+            }
+            chunk = run * fs->bytes_per_cluster;
+        } else {
+            uint32_t cluster = file_map(file, index, 1, true, &run);
+            bool past_end = (uint64_t)index * fs->bytes_per_cluster >= file->size;
+            if (cluster == 0 || !file_load_buffer(file, cluster, past_end)) {
+                break;
+            }
 
-    if (!fat32_write_cluster(fs, free_entry_cluster, parent_cluster_data)) {
-        free(parent_cluster_data);
-        return false;
-    }
+            chunk = fs->bytes_per_cluster - offset;
+            if (chunk > remaining) {
+                chunk = remaining;
+            }
+            memcpy(file->buffer + offset, src + done, chunk);
+            file->buffer_dirty = true;
+        }
 
-    free(parent_cluster_data);
+        done += chunk;
+        position += chunk;
+        if (position > file->size) {
+            file->size = position;
+        }
+        file->modified = true;
+    }
 
-    return true;
+    return done;
 }
 
-void fat32_close(FAT32_FileSystem *fs) {
-    if (!fs) {
-        return;
+static bool file_fill_gap(FAT32_File *file, uint32_t position) {
+    if (position <= file->size) {
+        return true;
     }
 
-    if (fs->disk.file) {
-        fflush(fs->disk.file);
+    FAT32_FileSystem *fs = file->fs;
+    uint32_t needed = (uint32_t)(((uint64_t)position + fs->bytes_per_cluster - 1) / fs->bytes_per_cluster);
+    if (!file_load_extents(file)
+        || (needed > file->cluster_count && !file_append_clusters(file, needed - file->cluster_count))) {
+        return false;
     }
 
-    if (fs->fat) {
-        free(fs->fat);
-        fs->fat = NULL;
+    uint32_t chunk_size = FILL_CHUNK_CLUSTERS * fs->bytes_per_cluster;
+    if (chunk_size > position - file->size) {
+        chunk_size = position - file->size;
+    }
+    uint8_t *zeros = (uint8_t*)calloc(1, chunk_size);
+    if (!zeros) {
+        return false;
     }
 
-    disk_close(&fs->disk);
+    bool success = true;
+    while (success && file->size < position) {
+        uint32_t length = position - file->size;
+        if (length > chunk_size) {
+            length = chunk_size;
+        }
+        success = file_write_at(file, zeros, length, file->size) == length;
+    }
 
-    fs->is_formatted = false;
+    free(zeros);
+    return success;
 }
 
-bool fat32_list_directory(FAT32_FileSystem *fs, const char *path, FAT32_DirEntry *entries,
-                          uint32_t max_entries, uint32_t *count) {
-    if (!fs || !fs->is_formatted || !entries || !count) {
+bool fat32_read(FAT32_File *file, void *buffer, uint32_t length, uint32_t *bytes_read) {
+    TRACE_FUNCTION();
+    if (!file || !file->fs || !buffer || !(file->flags & FAT32_O_READ)) {
         return false;
     }
 
-    *count = 0;
+    uint32_t expected = file->position < file->size ? file->size - file->position : 0;
+    if (expected > length) {
+        expected = length;
+    }
 
-    uint32_t dir_cluster;
+    uint32_t done = file_read_at(file, (uint8_t*)buffer, length, file->position);
+    file->position += done;
 
-    if (path == NULL) {
-        dir_cluster = fs->current_dir_cluster;
-    } else {
-        char path_components[256][13];
-        int path_component_count = 0;
+    if (bytes_read) {
+        *bytes_read = done;
+    }
+    return done == expected;
+}
 
-        if (!parse_path(path, path_components, &path_component_count)) {
-            return false;
-        }
+bool fat32_write(FAT32_File *file, const void *buffer, uint32_t length, uint32_t *bytes_written) {
+    TRACE_FUNCTION();
+    if (!file || !file->fs || !buffer || !(file->flags & FAT32_O_WRITE)) {
+        return false;
+    }
 
-        dir_cluster = fs->bootSector.BPB_RootClus;
+    if (file->flags & FAT32_O_APPEND) {
+        file->position = file->size;
+    }
 
-        for (int i = 0; i < path_component_count; i++) {
-            int entry_index = find_entry_by_name(fs, dir_cluster, path_components[i]);
-            if (entry_index < 0) {
-                return false;
-            }
+    uint32_t done = file_write_at(file, (const uint8_t*)buffer, length, file->position);
+    file->position += done;
 
-            uint8_t *cluster_data = (uint8_t*)malloc(fs->bytes_per_cluster);
-            if (!cluster_data) {
-                return false;
-            }
+    if (bytes_written) {
+        *bytes_written = done;
+    }
+    return done == length;
+}
 
-            uint32_t current_cluster = dir_cluster;
-            while (entry_index >= fs->bytes_per_cluster / sizeof(FAT32_DirEntry)) {
-                entry_index -= fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
-                current_cluster = fat32_get_next_cluster(fs, current_cluster);
-            }
+bool fat32_pread(FAT32_File *file, void *buffer, uint32_t length, uint32_t offset, uint32_t *bytes_read) {
+    TRACE_FUNCTION();
+    if (!file || !file->fs || !buffer || !(file->flags & FAT32_O_READ)) {
+        return false;
+    }
 
-            if (!fat32_read_cluster(fs, current_cluster, cluster_data)) {
-                free(cluster_data);
-                return false;
-            }
+    uint32_t expected = offset < file->size ? file->size - offset : 0;
+    if (expected > length) {
+        expected = length;
+    }
 
-            FAT32_DirEntry *dir_entries = (FAT32_DirEntry*)cluster_data;
+    uint32_t done = file_read_at(file, (uint8_t*)buffer, length, offset);
 
-            if (!(dir_entries[entry_index].DIR_Attr & FAT32_ATTR_DIRECTORY)) {
-                free(cluster_data);
-                return false;
-            }
+    if (bytes_read) {
+        *bytes_read = done;
+    }
+    return done == expected;
+}
 
-            dir_cluster = ((uint32_t)dir_entries[entry_index].DIR_FstClusHI << 16) |
-                dir_entries[entry_index].DIR_FstClusLO;
+bool fat32_pwrite(FAT32_File *file, const void *buffer, uint32_t length, uint32_t offset,
+                  uint32_t *bytes_written) {
+    TRACE_FUNCTION();
+    if (!file || !file->fs || !buffer || !(file->flags & FAT32_O_WRITE)) {
+        return false;
+    }
 
-            free(cluster_data);
-        }
+    uint32_t done = 0;
+    if (file_fill_gap(file, offset)) {
+        done = file_write_at(file, (const uint8_t*)buffer, length, offset);
     }
 
-    uint8_t *cluster_data = (uint8_t*)malloc(fs->bytes_per_cluster);
-    if (!cluster_data) {
-        return false;
+    if (bytes_written) {
+        *bytes_written = done;
     }
+    return done == length;
+}
 
-    uint32_t current_cluster = dir_cluster;
+bool fat32_preallocate(FAT32_FileSystem *fs, const char *path, uint32_t bytes, bool zero) {
+    TRACE_FUNCTION();
+    FAT32_File file;
+    if (!fat32_open(fs, path, FAT32_O_WRITE | FAT32_O_CREATE, &file)) {
+        return false;
+    }
 
-    while (current_cluster >= 2 && current_cluster < FAT32_CLUSTER_END) {
-        if (!fat32_read_cluster(fs, current_cluster, cluster_data)) {
-            free(cluster_data);
-            return false;
-        }
+    uint32_t needed = (uint32_t)(((uint64_t)bytes + fs->bytes_per_cluster - 1) / fs->bytes_per_cluster);
+    bool success = file_load_extents(&file);
+    if (success && needed > file.cluster_count) {
+        success = file_append_clusters(&file, needed - file.cluster_count) && commit_changes(fs);
+    }
 
-        FAT32_DirEntry *dir_entries = (FAT32_DirEntry*)cluster_data;
-        uint32_t entries_per_cluster = fs->bytes_per_cluster / sizeof(FAT32_DirEntry);
+    if (success && zero) {
+        success = file_fill_gap(&file, bytes);
+    }
 
-        for (uint32_t i = 0; i < entries_per_cluster && *count < max_entries; i++) {
-            if (dir_entries[i].DIR_Name[0] == 0x00) {
-                break;
-            }
+    return fat32_close_file(&file) && success;
+}
 
-            if (dir_entries[i].DIR_Name[0] == 0xE5) {
-                continue;
-            }
+bool fat32_close_file(FAT32_File *file) {
+    TRACE_FUNCTION();
+    if (!file || !file->fs) {
+        return false;
+    }
 
-            memcpy(&entries[*count], &dir_entries[i], sizeof(FAT32_DirEntry));
-            (*count)++;
+    FAT32_FileSystem *fs = file->fs;
+    bool success = file_flush_buffer(file);
+
+    if (file->modified) {
+        uint8_t *cluster_data = cluster_get(fs, file->entry_cluster, true);
+        if (cluster_data) {
+            FAT32_DirEntry *entry = (FAT32_DirEntry*)cluster_data + file->entry_index;
+            entry->DIR_Attr |= FAT32_ATTR_ARCHIVE;
+            entry->DIR_FstClusHI = (file->first_cluster >> 16) & 0xFFFF;
+            entry->DIR_FstClusLO = file->first_cluster & 0xFFFF;
+            entry->DIR_FileSize = file->size;
+            entry->DIR_WrtTime = get_fat_time();
+            entry->DIR_WrtDate = get_fat_date();
+            entry->DIR_LstAccDate = entry->DIR_WrtDate;
+            success = cluster_put(fs, file->entry_cluster, cluster_data, true) && success;
+        } else {
+            success = false;
         }
 
-        current_cluster = fat32_get_next_cluster(fs, current_cluster);
+        invalidate_path(fs, file->path);
+        success = commit_changes(fs) && success;
     }
 
-    free(cluster_data);
-    return true;
-}
\ No newline at end of file
+    free(file->buffer);
+    free(file->extents);
+    memset(file, 0, sizeof(FAT32_File));
+    return success;
+}
@@ -0,0 +1,407 @@
+#include "../include/fatcache.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ENTRIES_PER_SECTOR (DISK_SECTOR_SIZE / sizeof(uint32_t))
+#define COPY_SECTORS 256
+
+static uint32_t page_hash(FatCache *cache, uint32_t index) {
+    return (index * 2654435761u) & cache->bucket_mask;
+}
+
+static FatPage *page_lookup(FatCache *cache, uint32_t index) {
+    FatPage *page = cache->buckets[page_hash(cache, index)];
+    while (page && page->index != index) {
+        page = page->hash_next;
+    }
+    return page;
+}
+
+static void lru_unlink(FatCache *cache, FatPage *page) {
+    if (page->lru_prev) {
+        page->lru_prev->lru_next = page->lru_next;
+    } else {
+        cache->lru_head = page->lru_next;
+    }
+
+    if (page->lru_next) {
+        page->lru_next->lru_prev = page->lru_prev;
+    } else {
+        cache->lru_tail = page->lru_prev;
+    }
+
+    page->lru_prev = NULL;
+    page->lru_next = NULL;
+}
+
+static void lru_push_front(FatCache *cache, FatPage *page) {
+    page->lru_prev = NULL;
+    page->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = page;
+    }
+    cache->lru_head = page;
+    if (!cache->lru_tail) {
+        cache->lru_tail = page;
+    }
+}
+
+static void hash_remove(FatCache *cache, FatPage *page) {
+    FatPage **link = &cache->buckets[page_hash(cache, page->index)];
+    while (*link && *link != page) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) {
+        *link = page->hash_next;
+    }
+    page->hash_next = NULL;
+}
+
+static uint32_t page_sectors(FatCache *cache, uint32_t index) {
+    uint32_t first = index * FATCACHE_PAGE_SECTORS;
+    uint32_t left = cache->fat_sectors - first;
+    return left < FATCACHE_PAGE_SECTORS ? left : FATCACHE_PAGE_SECTORS;
+}
+
+static bool write_back(FatCache *cache, FatPage *page) {
+    if (!page->dirty) {
+        return true;
+    }
+
+    uint32_t sectors = page_sectors(cache, page->index);
+    uint32_t sector = 0;
+    while (sector < sectors) {
+        if (!(page->dirty & (1u << sector))) {
+            sector++;
+            continue;
+        }
+
+        uint32_t run_start = sector;
+        while (sector < sectors && (page->dirty & (1u << sector))) {
+            sector++;
+        }
+        uint32_t run_length = sector - run_start;
+        const uint32_t *data = page->entries + run_start * ENTRIES_PER_SECTOR;
+
+        if (!fatcache_write(cache, page->index * FATCACHE_PAGE_SECTORS + run_start, run_length, data)) {
+            return false;
+        }
+    }
+
+    page->dirty = 0;
+    cache->dirty_pages--;
+    return true;
+}
+
+static FatPage *evict_page(FatCache *cache) {
+    FatPage *victim = cache->lru_tail;
+    while (victim && victim->dirty) {
+        victim = victim->lru_prev;
+    }
+
+    if (!victim) {
+        victim = cache->lru_tail;
+        if (!victim || !write_back(cache, victim)) {
+            return NULL;
+        }
+    }
+
+    lru_unlink(cache, victim);
+    hash_remove(cache, victim);
+    return victim;
+}
+
+static FatPage *take_page(FatCache *cache) {
+    if (cache->count < cache->capacity) {
+        FatPage *page = (FatPage*)calloc(1, sizeof(FatPage));
+        if (!page) {
+            return NULL;
+        }
+
+        page->entries = (uint32_t*)malloc(FATCACHE_PAGE_SIZE);
+        if (!page->entries) {
+            free(page);
+            return NULL;
+        }
+
+        cache->count++;
+        return page;
+    }
+
+    return evict_page(cache);
+}
+
+static FatPage *load_page(FatCache *cache, uint32_t cluster) {
+    if (!cache || !cache->buckets || cluster >= cache->fat_sectors * ENTRIES_PER_SECTOR) {
+        return NULL;
+    }
+
+    uint32_t index = cluster / FATCACHE_PAGE_ENTRIES;
+    FatPage *page = page_lookup(cache, index);
+    if (page) {
+        cache->hits++;
+        if (cache->lru_head != page) {
+            lru_unlink(cache, page);
+            lru_push_front(cache, page);
+        }
+        return page;
+    }
+
+    cache->misses++;
+    page = take_page(cache);
+    if (!page) {
+        return NULL;
+    }
+
+    uint32_t sectors = page_sectors(cache, index);
+    if (!disk_read_sectors(cache->disk, (uint64_t)cache->fat_start + index * FATCACHE_PAGE_SECTORS,
+                           sectors, page->entries)) {
+        free(page->entries);
+        free(page);
+        cache->count--;
+        return NULL;
+    }
+    memset(page->entries + sectors * ENTRIES_PER_SECTOR, 0,
+           (FATCACHE_PAGE_SECTORS - sectors) * DISK_SECTOR_SIZE);
+
+    page->index = index;
+    page->dirty = 0;
+
+    uint32_t bucket = page_hash(cache, index);
+    page->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = page;
+    lru_push_front(cache, page);
+    return page;
+}
+
+static bool setup_buckets(FatCache *cache) {
+    uint32_t bucket_count = 1;
+    while (bucket_count < cache->capacity * 2) {
+        bucket_count <<= 1;
+    }
+
+    FatPage **buckets = (FatPage**)calloc(bucket_count, sizeof(FatPage*));
+    if (!buckets) {
+        return false;
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_mask = bucket_count - 1;
+
+    for (FatPage *page = cache->lru_head; page; page = page->lru_next) {
+        uint32_t bucket = page_hash(cache, page->index);
+        page->hash_next = cache->buckets[bucket];
+        cache->buckets[bucket] = page;
+    }
+    return true;
+}
+
+static uint32_t budget_capacity(size_t budget_bytes) {
+    size_t capacity = budget_bytes / FATCACHE_PAGE_SIZE;
+    if (capacity < FATCACHE_MIN_PAGES) {
+        capacity = FATCACHE_MIN_PAGES;
+    }
+    return capacity > UINT32_MAX / 2 ? UINT32_MAX / 2 : (uint32_t)capacity;
+}
+
+bool fatcache_init(FatCache *cache, Disk *disk, uint32_t fat_start, uint32_t fat_sectors,
+                   uint8_t fat_copies, size_t budget_bytes) {
+    if (!cache || !disk || fat_sectors == 0 || fat_copies == 0) {
+        return false;
+    }
+
+    memset(cache, 0, sizeof(FatCache));
+    cache->disk = disk;
+    cache->fat_start = fat_start;
+    cache->fat_sectors = fat_sectors;
+    cache->fat_copies = fat_copies;
+    cache->capacity = budget_capacity(budget_bytes);
+
+    return setup_buckets(cache);
+}
+
+bool fatcache_get(FatCache *cache, uint32_t cluster, uint32_t *value) {
+    FatPage *page = load_page(cache, cluster);
+    if (!page) {
+        return false;
+    }
+
+    *value = page->entries[cluster % FATCACHE_PAGE_ENTRIES];
+    return true;
+}
+
+bool fatcache_set(FatCache *cache, uint32_t cluster, uint32_t value) {
+    FatPage *page = load_page(cache, cluster);
+    if (!page) {
+        return false;
+    }
+
+    uint32_t offset = cluster % FATCACHE_PAGE_ENTRIES;
+    page->entries[offset] = value;
+    if (!page->dirty) {
+        cache->dirty_pages++;
+    }
+    page->dirty |= (uint8_t)(1u << (offset / ENTRIES_PER_SECTOR));
+    return true;
+}
+
+bool fatcache_flush(FatCache *cache) {
+    if (!cache || !cache->buckets) {
+        return false;
+    }
+
+    bool success = true;
+    for (FatPage *page = cache->lru_head; page && cache->dirty_pages > 0; page = page->lru_next) {
+        if (!write_back(cache, page)) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool fatcache_write(FatCache *cache, uint32_t sector, uint32_t count, const void *data) {
+    if (!cache || !cache->disk || count == 0 || sector + count > cache->fat_sectors) {
+        return false;
+    }
+
+    uint8_t copies = cache->defer_mirrors ? 1 : cache->fat_copies;
+    for (uint8_t i = 0; i < copies; i++) {
+        uint64_t target = (uint64_t)cache->fat_start + (uint64_t)i * cache->fat_sectors + sector;
+        if (!disk_write_sectors(cache->disk, target, count, data)) {
+            return false;
+        }
+        cache->sectors_written += count;
+    }
+
+    if (copies < cache->fat_copies) {
+        if (cache->stale_end == 0) {
+            cache->stale_first = sector;
+            cache->stale_end = sector + count;
+        } else {
+            if (sector < cache->stale_first) {
+                cache->stale_first = sector;
+            }
+            if (sector + count > cache->stale_end) {
+                cache->stale_end = sector + count;
+            }
+        }
+    }
+    return true;
+}
+
+bool fatcache_copy(FatCache *cache, uint8_t source, uint32_t sector, uint32_t count) {
+    if (!cache || !cache->disk || source >= cache->fat_copies || sector + count > cache->fat_sectors) {
+        return false;
+    }
+    if (cache->fat_copies < 2 || count == 0) {
+        return true;
+    }
+
+    uint32_t chunk = count < COPY_SECTORS ? count : COPY_SECTORS;
+    uint8_t *buffer = (uint8_t*)malloc((size_t)chunk * DISK_SECTOR_SIZE);
+    if (!buffer) {
+        return false;
+    }
+
+    bool success = true;
+    for (uint32_t done = 0; success && done < count; done += chunk) {
+        uint32_t length = count - done < chunk ? count - done : chunk;
+        uint64_t offset = (uint64_t)cache->fat_start + sector + done;
+        success = disk_read_sectors(cache->disk, offset + (uint64_t)source * cache->fat_sectors,
+                                    length, buffer);
+
+        for (uint8_t i = 0; success && i < cache->fat_copies; i++) {
+            if (i == source) {
+                continue;
+            }
+            success = disk_write_sectors(cache->disk, offset + (uint64_t)i * cache->fat_sectors,
+                                         length, buffer);
+            cache->sectors_written += length;
+            cache->mirror_sectors += length;
+        }
+    }
+
+    free(buffer);
+    return success;
+}
+
+bool fatcache_set_defer_mirrors(FatCache *cache, bool defer) {
+    if (!cache || !cache->buckets) {
+        return false;
+    }
+
+    if (!defer && !fatcache_sync_mirrors(cache)) {
+        return false;
+    }
+    cache->defer_mirrors = defer;
+    return true;
+}
+
+bool fatcache_sync_mirrors(FatCache *cache) {
+    if (!cache || !cache->buckets) {
+        return false;
+    }
+    if (cache->stale_end == 0) {
+        return true;
+    }
+
+    if (!fatcache_copy(cache, 0, cache->stale_first, cache->stale_end - cache->stale_first)) {
+        return false;
+    }
+
+    cache->stale_first = 0;
+    cache->stale_end = 0;
+    cache->mirror_syncs++;
+    return true;
+}
+
+void fatcache_invalidate(FatCache *cache) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    FatPage *page = cache->lru_head;
+    while (page) {
+        FatPage *next = page->lru_next;
+        free(page->entries);
+        free(page);
+        page = next;
+    }
+
+    memset(cache->buckets, 0, (size_t)(cache->bucket_mask + 1) * sizeof(FatPage*));
+    cache->lru_head = NULL;
+    cache->lru_tail = NULL;
+    cache->count = 0;
+    cache->dirty_pages = 0;
+}
+
+bool fatcache_set_budget(FatCache *cache, size_t budget_bytes) {
+    if (!cache || !cache->buckets) {
+        return false;
+    }
+
+    cache->capacity = budget_capacity(budget_bytes);
+    while (cache->count > cache->capacity) {
+        FatPage *page = evict_page(cache);
+        if (!page) {
+            return false;
+        }
+        free(page->entries);
+        free(page);
+        cache->count--;
+    }
+
+    return setup_buckets(cache);
+}
+
+void fatcache_destroy(FatCache *cache) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    fatcache_flush(cache);
+    fatcache_invalidate(cache);
+    free(cache->buckets);
+    cache->buckets = NULL;
+}
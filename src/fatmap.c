@@ -0,0 +1,327 @@
+#include "../include/fatmap.h"
+#include "../include/disk.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ENTRIES_PER_SECTOR (DISK_SECTOR_SIZE / sizeof(uint32_t))
+#define FIRST_CLUSTER 2
+
+static uint32_t run_end(const FatRun *run) {
+    return run->start + run->length;
+}
+
+static uint32_t run_value(const FatRun *run, uint32_t cluster) {
+    if (run->kind == FATMAP_FILL || cluster == run_end(run) - 1) {
+        return run->next;
+    }
+    return cluster + 1;
+}
+
+static bool run_is_fill(const FatRun *run) {
+    return run->kind == FATMAP_FILL || run->length == 1;
+}
+
+static bool runs_join(FatRun *left, const FatRun *right) {
+    if (left->kind == FATMAP_CHAIN && right->kind == FATMAP_CHAIN && left->next == right->start) {
+        left->length += right->length;
+        left->next = right->next;
+        return true;
+    }
+
+    if (run_is_fill(left) && run_is_fill(right) && left->next == right->next) {
+        left->length += right->length;
+        left->kind = FATMAP_FILL;
+        return true;
+    }
+    return false;
+}
+
+static uint32_t find_run(const FatMap *map, uint32_t cluster) {
+    uint32_t low = 0;
+    uint32_t high = map->count;
+    while (high - low > 1) {
+        uint32_t mid = low + (high - low) / 2;
+        if (map->runs[mid].start <= cluster) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static bool reserve_runs(FatMap *map, uint32_t extra) {
+    if (map->count + extra <= map->capacity) {
+        return true;
+    }
+
+    uint32_t capacity = map->capacity ? map->capacity : 16;
+    while (capacity < map->count + extra) {
+        capacity *= 2;
+    }
+
+    FatRun *runs = (FatRun*)realloc(map->runs, (size_t)capacity * sizeof(FatRun));
+    if (!runs) {
+        return false;
+    }
+    map->runs = runs;
+    map->capacity = capacity;
+    return true;
+}
+
+static void mark_dirty(FatMap *map, uint32_t cluster) {
+    uint32_t sector = cluster / ENTRIES_PER_SECTOR;
+    if (sector < map->sectors) {
+        map->dirty[sector / 8] |= (uint8_t)(1u << (sector % 8));
+    }
+}
+
+static void join_range(FatMap *map, uint32_t first, uint32_t last) {
+    uint32_t i = first;
+    while (i < last && i + 1 < map->count) {
+        if (runs_join(&map->runs[i], &map->runs[i + 1])) {
+            memmove(&map->runs[i + 1], &map->runs[i + 2], (map->count - i - 2) * sizeof(FatRun));
+            map->count--;
+            last--;
+        } else {
+            i++;
+        }
+    }
+}
+
+bool fatmap_init(FatMap *map, uint32_t sectors) {
+    if (!map || sectors == 0) {
+        return false;
+    }
+
+    memset(map, 0, sizeof(FatMap));
+    map->first = FIRST_CLUSTER;
+    map->limit = FIRST_CLUSTER;
+    map->sectors = sectors;
+    map->dirty = (uint8_t*)calloc((sectors + 7) / 8, 1);
+    return map->dirty != NULL;
+}
+
+bool fatmap_append(FatMap *map, uint32_t count, uint32_t value) {
+    if (!map || !map->dirty) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    FatRun run = { map->limit, count, value, count == 1 ? FATMAP_CHAIN : FATMAP_FILL };
+    map->limit += count;
+
+    if (map->count > 0 && runs_join(&map->runs[map->count - 1], &run)) {
+        return true;
+    }
+
+    if (!reserve_runs(map, 1)) {
+        map->limit -= count;
+        return false;
+    }
+    map->runs[map->count++] = run;
+    return true;
+}
+
+bool fatmap_get(const FatMap *map, uint32_t cluster, uint32_t *value) {
+    if (!map || !value) {
+        return false;
+    }
+
+    if (cluster < FIRST_CLUSTER) {
+        *value = map->head[cluster];
+        return true;
+    }
+    if (cluster >= map->limit) {
+        return false;
+    }
+
+    *value = run_value(&map->runs[find_run(map, cluster)], cluster);
+    return true;
+}
+
+bool fatmap_set(FatMap *map, uint32_t cluster, uint32_t value) {
+    if (!map || !map->dirty) {
+        return false;
+    }
+
+    if (cluster < FIRST_CLUSTER) {
+        map->head[cluster] = value;
+        mark_dirty(map, cluster);
+        return true;
+    }
+    if (cluster >= map->limit) {
+        return false;
+    }
+
+    uint32_t index = find_run(map, cluster);
+    FatRun run = map->runs[index];
+    if (run_value(&run, cluster) == value) {
+        return true;
+    }
+
+    FatRun pieces[3];
+    uint32_t count = 0;
+    if (cluster > run.start) {
+        pieces[count++] = (FatRun){ run.start, cluster - run.start,
+                                    run.kind == FATMAP_FILL ? run.next : cluster, run.kind };
+    }
+    pieces[count++] = (FatRun){ cluster, 1, value, FATMAP_CHAIN };
+    if (cluster + 1 < run_end(&run)) {
+        pieces[count++] = (FatRun){ cluster + 1, run_end(&run) - cluster - 1, run.next, run.kind };
+    }
+
+    if (!reserve_runs(map, count - 1)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (pieces[i].length == 1) {
+            pieces[i].kind = FATMAP_CHAIN;
+        }
+    }
+
+    memmove(&map->runs[index + count], &map->runs[index + 1],
+            (map->count - index - 1) * sizeof(FatRun));
+    memcpy(&map->runs[index], pieces, count * sizeof(FatRun));
+    map->count += count - 1;
+
+    join_range(map, index > 0 ? index - 1 : 0, index + count);
+    mark_dirty(map, cluster);
+    return true;
+}
+
+bool fatmap_run(const FatMap *map, uint32_t cluster, uint32_t *length, uint32_t *next) {
+    if (!map || !length || !next || cluster < FIRST_CLUSTER || cluster >= map->limit) {
+        return false;
+    }
+
+    const FatRun *run = &map->runs[find_run(map, cluster)];
+    if (run->kind == FATMAP_FILL) {
+        *length = 1;
+    } else {
+        *length = run_end(run) - cluster;
+    }
+    *next = run->next;
+    return true;
+}
+
+uint32_t fatmap_find(const FatMap *map, uint32_t from, uint32_t limit, bool want_free) {
+    if (!map || map->count == 0) {
+        return limit;
+    }
+    if (from < FIRST_CLUSTER) {
+        from = FIRST_CLUSTER;
+    }
+
+    for (uint32_t i = find_run(map, from); i < map->count && from < limit; i++) {
+        const FatRun *run = &map->runs[i];
+        uint32_t end = run_end(run);
+        if (from >= end) {
+            continue;
+        }
+
+        uint32_t last = end - 1;
+        bool last_free = run->next == 0;
+        if (run->kind == FATMAP_FILL) {
+            if (last_free == want_free) {
+                return from < limit ? from : limit;
+            }
+        } else if (want_free) {
+            if (last_free) {
+                return last < limit ? last : limit;
+            }
+        } else if (from < last || !last_free) {
+            return from < limit ? from : limit;
+        }
+        from = end;
+    }
+    return limit;
+}
+
+uint32_t fatmap_count_free(const FatMap *map) {
+    if (!map) {
+        return 0;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < map->count; i++) {
+        if (map->runs[i].next == 0) {
+            count += map->runs[i].kind == FATMAP_FILL ? map->runs[i].length : 1;
+        }
+    }
+    return count;
+}
+
+void fatmap_read(const FatMap *map, uint32_t cluster, uint32_t count, uint32_t *entries) {
+    uint32_t k = 0;
+    while (k < count && cluster + k < FIRST_CLUSTER) {
+        entries[k] = map->head[cluster + k];
+        k++;
+    }
+
+    if (k < count && cluster + k < map->limit) {
+        uint32_t i = find_run(map, cluster + k);
+        while (k < count && i < map->count) {
+            const FatRun *run = &map->runs[i];
+            if (cluster + k >= run_end(run)) {
+                i++;
+                continue;
+            }
+            entries[k] = run_value(run, cluster + k);
+            k++;
+        }
+    }
+
+    while (k < count) {
+        entries[k++] = 0;
+    }
+}
+
+bool fatmap_is_dirty(const FatMap *map, uint32_t sector) {
+    if (!map || !map->dirty || sector >= map->sectors) {
+        return false;
+    }
+    return (map->dirty[sector / 8] & (1u << (sector % 8))) != 0;
+}
+
+uint32_t fatmap_next_dirty(const FatMap *map, uint32_t from) {
+    if (!map || !map->dirty) {
+        return from;
+    }
+
+    while (from < map->sectors) {
+        uint8_t bits = (uint8_t)(map->dirty[from / 8] >> (from % 8));
+        if (bits) {
+            from += (uint32_t)__builtin_ctz(bits);
+            return from < map->sectors ? from : map->sectors;
+        }
+        from = (from / 8 + 1) * 8;
+    }
+    return map->sectors;
+}
+
+void fatmap_clear_dirty(FatMap *map) {
+    if (map && map->dirty) {
+        memset(map->dirty, 0, (map->sectors + 7) / 8);
+    }
+}
+
+size_t fatmap_memory(const FatMap *map) {
+    if (!map) {
+        return 0;
+    }
+    return (size_t)map->capacity * sizeof(FatRun) + (map->sectors + 7) / 8;
+}
+
+void fatmap_destroy(FatMap *map) {
+    if (!map) {
+        return;
+    }
+
+    free(map->runs);
+    free(map->dirty);
+    memset(map, 0, sizeof(FatMap));
+}
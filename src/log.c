@@ -0,0 +1,60 @@
+#include "../include/log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static LogLevel current_level = LOG_DEFAULT_LEVEL;
+static LogCallback current_callback;
+static void *current_user_data;
+
+static const char *level_names[] = { "none", "error", "warn", "info", "debug" };
+static const char *level_prefixes[] = { "", "Error", "Warning", "Info", "Debug" };
+
+void log_set_level(LogLevel level) {
+    current_level = level;
+}
+
+LogLevel log_get_level(void) {
+    return current_level;
+}
+
+bool log_is_enabled(LogLevel level) {
+    return level != LOG_LEVEL_NONE && level <= current_level;
+}
+
+void log_set_callback(LogCallback callback, void *user_data) {
+    current_callback = callback;
+    current_user_data = user_data;
+}
+
+bool log_parse_level(const char *text, LogLevel *level) {
+    if (!text || !level) {
+        return false;
+    }
+
+    for (int i = LOG_LEVEL_NONE; i <= LOG_LEVEL_DEBUG; i++) {
+        if (strcmp(text, level_names[i]) == 0) {
+            *level = (LogLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void log_write(LogLevel level, const char *format, ...) {
+    if (level <= LOG_LEVEL_NONE || level > LOG_LEVEL_DEBUG) {
+        return;
+    }
+
+    char message[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    if (current_callback) {
+        current_callback(level, message, current_user_data);
+    } else {
+        fprintf(stderr, "%s: %s\n", level_prefixes[level], message);
+    }
+}
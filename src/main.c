@@ -1,26 +1,77 @@
-#include "../include/fat32.h">"
+#include "../include/fat32.h"
 #include "../include/commands.h"
+#include "../include/utils.h"
+#include "../include/trace.h"
+#include "../include/log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #define MAX_COMMAND_LENGTH 512
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <disk_file>\n", argv[0]);
-        return EXIT_FAILURE;
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--mmap] [--fat-extents] [--defer-mirrors] [--size <size>] [--batch <script>]\n"
+            "       [--commit-every <n>] [--trace <file>] [--log-level <none|error|warn|info|debug>] <disk_file>\n",
+            program);
+}
+
+static bool parse_count(const char *text, uint32_t *out) {
+    char *end = NULL;
+    unsigned long value = strtoul(text, &end, 10);
+    if (text[0] < '0' || text[0] > '9' || *end != '\0' || value == 0 || value > UINT32_MAX) {
+        return false;
     }
+    *out = (uint32_t)value;
+    return true;
+}
 
-    FAT32_FileSystem fs;
-    if (!fat32_init(&fs, argv[1])) {
-        fprintf(stderr, "Failed to initialize disk: %s\n", argv[1]);
-        return EXIT_FAILURE;
+static int run_batch(FAT32_FileSystem *fs, FILE *input, const char *source, uint32_t commit_every) {
+    char command[MAX_COMMAND_LENGTH];
+    uint32_t line = 0;
+    uint32_t pending = 0;
+    uint32_t failures = 0;
+
+    fat32_set_deferred_sync(fs, true);
+
+    while (fgets(command, MAX_COMMAND_LENGTH, input) != NULL) {
+        line++;
+        command[strcspn(command, "\r\n")] = '\0';
+
+        if (command[0] == '\0' || command[0] == '#') {
+            continue;
+        }
+
+        if (strcmp(command, "exit") == 0 || strcmp(command, "quit") == 0) {
+            break;
+        }
+
+        if (!process_command(fs, command)) {
+            fprintf(stderr, "%s:%u: command failed: %s\n", source, line, command);
+            failures++;
+        }
+
+        if (commit_every > 0 && ++pending >= commit_every) {
+            if (fs->is_formatted && !fat32_sync(fs)) {
+                fprintf(stderr, "%s:%u: failed to commit changes\n", source, line);
+                failures++;
+            }
+            pending = 0;
+        }
     }
 
+    if (!fat32_set_deferred_sync(fs, false)) {
+        fprintf(stderr, "%s: failed to commit changes\n", source);
+        failures++;
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void run_interactive(FAT32_FileSystem *fs) {
     char command[MAX_COMMAND_LENGTH];
     while (1) {
-        printf("%s>", fs.current_path);
+        printf("%s>", fs->current_path);
 
         if (fgets(command, MAX_COMMAND_LENGTH, stdin) == NULL) {
             break;
@@ -35,11 +86,113 @@ int main(int argc, char *argv[]) {
             break;
         }
 
-        process_command(&fs, command);
+        process_command(fs, command);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    DiskOptions options = { .backend = DISK_BACKEND_FILE, .size = 0 };
+    const char *disk_file = NULL;
+    const char *script = NULL;
+    uint32_t commit_every = 0;
+    const char *trace_file = NULL;
+    bool fat_extents = false;
+    bool defer_mirrors = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mmap") == 0) {
+            options.backend = DISK_BACKEND_MMAP;
+        } else if (strcmp(argv[i], "--fat-extents") == 0) {
+            fat_extents = true;
+        } else if (strcmp(argv[i], "--defer-mirrors") == 0) {
+            defer_mirrors = true;
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (!parse_size(argv[++i], &options.size) || options.size < DISK_SECTOR_SIZE) {
+                fprintf(stderr, "Invalid size: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            script = argv[++i];
+        } else if (strcmp(argv[i], "--commit-every") == 0 && i + 1 < argc) {
+            if (!parse_count(argv[++i], &commit_every)) {
+                fprintf(stderr, "Invalid commit interval: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            LogLevel level;
+            if (!log_parse_level(argv[++i], &level)) {
+                fprintf(stderr, "Invalid log level: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            log_set_level(level);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (argv[i][0] != '-' && !disk_file) {
+            disk_file = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!disk_file) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (trace_file) {
+        if (!TRACE_COMPILED) {
+            fprintf(stderr, "Warning: trace spans are not compiled in (configure with -DFAT32_TRACE=ON)\n");
+        }
+        if (!trace_enable(TRACE_DEFAULT_CAPACITY)) {
+            fprintf(stderr, "Failed to allocate the trace buffer\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    FAT32_FileSystem fs;
+    if (!fat32_init_with_options(&fs, disk_file, &options)) {
+        fprintf(stderr, "Failed to initialize disk: %s\n", disk_file);
+        trace_disable();
+        return EXIT_FAILURE;
+    }
+
+    if (fat_extents && !fat32_set_fat_extents(&fs, true)) {
+        fprintf(stderr, "Failed to load the FAT as runs, using the FAT page cache\n");
+    }
+    if (defer_mirrors && !fat32_set_deferred_mirrors(&fs, true)) {
+        fprintf(stderr, "Failed to defer FAT mirror updates\n");
+    }
+
+    int status = EXIT_SUCCESS;
+    if (script || !isatty(STDIN_FILENO)) {
+        FILE *input = stdin;
+        if (script && strcmp(script, "-") != 0) {
+            input = fopen(script, "r");
+        }
+
+        if (input) {
+            status = run_batch(&fs, input, input == stdin ? "<stdin>" : script, commit_every);
+            if (input != stdin) {
+                fclose(input);
+            }
+        } else {
+            fprintf(stderr, "Failed to open script: %s\n", script);
+            status = EXIT_FAILURE;
+        }
+    } else {
+        run_interactive(&fs);
     }
 
     fat32_close(&fs);
 
-    return EXIT_SUCCESS;
+    if (trace_file) {
+        if (!trace_write_chrome(trace_file)) {
+            fprintf(stderr, "Failed to write trace: %s\n", trace_file);
+            status = EXIT_FAILURE;
+        }
+        trace_disable();
+    }
 
+    return status;
 }
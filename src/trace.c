@@ -0,0 +1,122 @@
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static TraceEvent *events;
+static uint32_t capacity;
+static uint32_t head;
+static uint32_t count;
+static uint64_t dropped;
+static uint64_t origin_ns;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+bool trace_enable(uint32_t event_capacity) {
+    if (event_capacity == 0) {
+        return false;
+    }
+
+    TraceEvent *buffer = (TraceEvent*)malloc((size_t)event_capacity * sizeof(TraceEvent));
+    if (!buffer) {
+        return false;
+    }
+
+    free(events);
+    events = buffer;
+    capacity = event_capacity;
+    head = 0;
+    count = 0;
+    dropped = 0;
+    origin_ns = now_ns();
+    return true;
+}
+
+void trace_disable(void) {
+    free(events);
+    events = NULL;
+    capacity = 0;
+    head = 0;
+    count = 0;
+}
+
+bool trace_is_enabled(void) {
+    return events != NULL;
+}
+
+TraceSpan trace_span_begin(const char *name) {
+    TraceSpan span = { NULL, 0 };
+    if (events) {
+        span.name = name;
+        span.start_ns = now_ns() - origin_ns;
+    }
+    return span;
+}
+
+void trace_span_end(TraceSpan *span) {
+    if (!span->name || !events) {
+        return;
+    }
+
+    TraceEvent *event = &events[head];
+    event->name = span->name;
+    event->start_ns = span->start_ns;
+    event->duration_ns = now_ns() - origin_ns - span->start_ns;
+
+    head = (head + 1) % capacity;
+    if (count < capacity) {
+        count++;
+    } else {
+        dropped++;
+    }
+}
+
+uint32_t trace_event_count(void) {
+    return count;
+}
+
+bool trace_get_event(uint32_t index, TraceEvent *event) {
+    if (!events || index >= count || !event) {
+        return false;
+    }
+
+    *event = events[(head + capacity - count + index) % capacity];
+    return true;
+}
+
+uint64_t trace_dropped_count(void) {
+    return dropped;
+}
+
+bool trace_write_chrome(const char *path) {
+    if (!path) {
+        return false;
+    }
+
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\"traceEvents\":[");
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        TraceEvent event;
+        if (!trace_get_event(i, &event)) {
+            continue;
+        }
+        fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"fat32\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":1,\"tid\":1}",
+                written++ == 0 ? "" : ",", event.name, event.start_ns / 1e3, event.duration_ns / 1e3);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_spans\":%llu}}\n",
+            (unsigned long long)dropped);
+
+    bool success = !ferror(file);
+    return fclose(file) == 0 && success;
+}
@@ -1,4 +1,5 @@
 #include "../include/utils.h"
+#include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 
@@ -154,15 +155,20 @@ bool is_valid_filename(const char *name) {
         return false;
     }
 
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        return false;
+    }
+
     const char *invalid_chars = "\"\\/:*?<>|";
 
     for (const char *p = name; *p; p++) {
-        if (strchr(invalid_chars, *p) || *p < 32) {
+        if (strchr(invalid_chars, *p) || (unsigned char)*p < 32) {
             return false;
         }
     }
 
-    return true;
+    char last = name[strlen(name) - 1];
+    return last != '.' && last != ' ';
 }
 
 
@@ -221,4 +227,341 @@ void convert_from_short_name(char *dest, const char *src) {
     }
 
     dest[j] = '\0';
+}
+
+void convert_from_short_name_case(char *dest, const char *src, uint8_t case_flags) {
+    if (!dest || !src) {
+        return;
+    }
+
+    int j = 0;
+
+    for (int i = 0; i < 8 && src[i] != ' '; i++) {
+        dest[j++] = (case_flags & SHORT_NAME_LOWER_BASE) ? (char)tolower((unsigned char)src[i]) : src[i];
+    }
+
+    if (src[8] != ' ') {
+        dest[j++] = '.';
+
+        for (int i = 8; i < 11 && src[i] != ' '; i++) {
+            dest[j++] = (case_flags & SHORT_NAME_LOWER_EXT) ? (char)tolower((unsigned char)src[i]) : src[i];
+        }
+    }
+
+    dest[j] = '\0';
+}
+
+static bool is_short_name_char(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || (c != 0 && strchr("!#$%&'()-@^_`{}~", c));
+}
+
+bool short_name_from_name(char short_name[11], uint8_t *case_flags, const char *name) {
+    if (!short_name || !case_flags || !name || name[0] == '\0' || name[0] == '.') {
+        return false;
+    }
+
+    const char *dot = strchr(name, '.');
+    size_t base_length = dot ? (size_t)(dot - name) : strlen(name);
+    size_t ext_length = dot ? strlen(dot + 1) : 0;
+    if (base_length > 8 || ext_length > 3 || (dot && (ext_length == 0 || strchr(dot + 1, '.')))) {
+        return false;
+    }
+
+    memset(short_name, ' ', 11);
+    *case_flags = 0;
+
+    for (int part = 0; part < 2; part++) {
+        const char *src = part == 0 ? name : dot + 1;
+        size_t length = part == 0 ? base_length : ext_length;
+        bool lower = false;
+        bool upper = false;
+
+        for (size_t i = 0; i < length; i++) {
+            unsigned char c = (unsigned char)src[i];
+            if (c >= 'a' && c <= 'z') {
+                lower = true;
+                c = (unsigned char)(c - 'a' + 'A');
+            } else if (c >= 'A' && c <= 'Z') {
+                upper = true;
+            }
+            if (!is_short_name_char(c)) {
+                return false;
+            }
+            short_name[(part == 0 ? 0 : 8) + i] = (char)c;
+        }
+
+        if (lower && upper) {
+            return false;
+        }
+        if (lower) {
+            *case_flags |= part == 0 ? SHORT_NAME_LOWER_BASE : SHORT_NAME_LOWER_EXT;
+        }
+    }
+
+    return true;
+}
+
+bool short_name_basis(char short_name[11], const char *name) {
+    memset(short_name, ' ', 11);
+
+    const char *start = name;
+    while (*start == '.' || *start == ' ') {
+        start++;
+    }
+    bool exact = start == name;
+
+    const char *last_dot = strrchr(start, '.');
+    int length = 0;
+    int ext_length = 0;
+
+    for (const char *p = start; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        bool in_ext = last_dot && p > last_dot;
+
+        if (p == last_dot) {
+            continue;
+        }
+        if (c == ' ' || c == '.') {
+            exact = false;
+            continue;
+        }
+        if (c >= 0x80) {
+            while (((unsigned char)p[1] & 0xC0) == 0x80) {
+                p++;
+            }
+            c = '_';
+            exact = false;
+        } else if (c >= 'a' && c <= 'z') {
+            c = (unsigned char)(c - 'a' + 'A');
+        } else if (!is_short_name_char(c)) {
+            c = '_';
+            exact = false;
+        }
+
+        if (in_ext) {
+            if (ext_length < 3) {
+                short_name[8 + ext_length++] = (char)c;
+            } else {
+                exact = false;
+            }
+        } else if (length < 8) {
+            short_name[length++] = (char)c;
+        } else {
+            exact = false;
+        }
+    }
+
+    if (length == 0) {
+        short_name[0] = '_';
+        exact = false;
+    }
+    return exact;
+}
+
+bool short_name_set_tail(char short_name[11], uint32_t number) {
+    if (number == 0 || number > 999999) {
+        return false;
+    }
+
+    char tail[8];
+    int tail_length = snprintf(tail, sizeof(tail), "~%u", number);
+
+    int base_length = 8;
+    while (base_length > 0 && short_name[base_length - 1] == ' ') {
+        base_length--;
+    }
+    if (base_length > 8 - tail_length) {
+        base_length = 8 - tail_length;
+    }
+
+    memcpy(short_name + base_length, tail, (size_t)tail_length);
+    return true;
+}
+
+uint8_t lfn_checksum(const char short_name[11]) {
+    uint8_t sum = 0;
+    for (int i = 0; i < 11; i++) {
+        sum = (uint8_t)(((sum & 1) << 7) + (sum >> 1) + (uint8_t)short_name[i]);
+    }
+    return sum;
+}
+
+bool utf8_to_utf16(const char *src, uint16_t *dest, size_t dest_units, size_t *length) {
+    if (!src || !dest || !length) {
+        return false;
+    }
+
+    const unsigned char *p = (const unsigned char*)src;
+    size_t count = 0;
+
+    while (*p) {
+        uint32_t code;
+        int extra;
+        if (*p < 0x80) {
+            code = *p;
+            extra = 0;
+        } else if ((*p & 0xE0) == 0xC0) {
+            code = *p & 0x1F;
+            extra = 1;
+        } else if ((*p & 0xF0) == 0xE0) {
+            code = *p & 0x0F;
+            extra = 2;
+        } else if ((*p & 0xF8) == 0xF0) {
+            code = *p & 0x07;
+            extra = 3;
+        } else {
+            return false;
+        }
+        p++;
+
+        for (int i = 0; i < extra; i++, p++) {
+            if ((*p & 0xC0) != 0x80) {
+                return false;
+            }
+            code = (code << 6) | (*p & 0x3F);
+        }
+
+        static const uint32_t min_code[] = { 0, 0x80, 0x800, 0x10000 };
+        if (code < min_code[extra] || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
+            return false;
+        }
+
+        if (code >= 0x10000) {
+            if (count + 2 > dest_units) {
+                return false;
+            }
+            code -= 0x10000;
+            dest[count++] = (uint16_t)(0xD800 | (code >> 10));
+            dest[count++] = (uint16_t)(0xDC00 | (code & 0x3FF));
+        } else {
+            if (count + 1 > dest_units) {
+                return false;
+            }
+            dest[count++] = (uint16_t)code;
+        }
+    }
+
+    *length = count;
+    return true;
+}
+
+bool utf16_to_utf8(const uint16_t *src, size_t length, char *dest, size_t dest_size) {
+    if (!src || !dest || dest_size == 0) {
+        return false;
+    }
+
+    size_t out = 0;
+    for (size_t i = 0; i < length; i++) {
+        uint32_t code = src[i];
+        if (code >= 0xD800 && code <= 0xDBFF && i + 1 < length && src[i + 1] >= 0xDC00 && src[i + 1] <= 0xDFFF) {
+            code = 0x10000 + ((code - 0xD800) << 10) + (src[i + 1] - 0xDC00);
+            i++;
+        } else if (code >= 0xD800 && code <= 0xDFFF) {
+            code = 0xFFFD;
+        }
+
+        unsigned char bytes[4];
+        size_t count;
+        if (code < 0x80) {
+            bytes[0] = (unsigned char)code;
+            count = 1;
+        } else if (code < 0x800) {
+            bytes[0] = (unsigned char)(0xC0 | (code >> 6));
+            bytes[1] = (unsigned char)(0x80 | (code & 0x3F));
+            count = 2;
+        } else if (code < 0x10000) {
+            bytes[0] = (unsigned char)(0xE0 | (code >> 12));
+            bytes[1] = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+            bytes[2] = (unsigned char)(0x80 | (code & 0x3F));
+            count = 3;
+        } else {
+            bytes[0] = (unsigned char)(0xF0 | (code >> 18));
+            bytes[1] = (unsigned char)(0x80 | ((code >> 12) & 0x3F));
+            bytes[2] = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+            bytes[3] = (unsigned char)(0x80 | (code & 0x3F));
+            count = 4;
+        }
+
+        if (out + count >= dest_size) {
+            dest[out] = '\0';
+            return false;
+        }
+        memcpy(dest + out, bytes, count);
+        out += count;
+    }
+
+    dest[out] = '\0';
+    return true;
+}
+
+static uint16_t fold_unit(uint16_t unit) {
+    return unit >= 'a' && unit <= 'z' ? (uint16_t)(unit - 'a' + 'A') : unit;
+}
+
+uint32_t lfn_name_hash(const uint16_t *units, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        uint16_t unit = fold_unit(units[i]);
+        hash ^= unit & 0xFF;
+        hash *= 16777619u;
+        hash ^= unit >> 8;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool lfn_name_equal(const uint16_t *a, size_t a_length, const uint16_t *b, size_t b_length) {
+    if (a_length != b_length) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a_length; i++) {
+        if (fold_unit(a[i]) != fold_unit(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parse_size(const char *text, uint64_t *out) {
+    if (!text || !out || !isdigit((unsigned char)*text)) {
+        return false;
+    }
+
+    uint64_t value = 0;
+    const char *p = text;
+    while (isdigit((unsigned char)*p)) {
+        uint64_t digit = (uint64_t)(*p - '0');
+        if (value > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+        p++;
+    }
+
+    unsigned shift = 0;
+    switch (toupper((unsigned char)*p)) {
+        case 'K': shift = 10; p++; break;
+        case 'M': shift = 20; p++; break;
+        case 'G': shift = 30; p++; break;
+        case 'T': shift = 40; p++; break;
+        default: break;
+    }
+
+    if (shift != 0 && (*p == 'i' || *p == 'I') && toupper((unsigned char)p[1]) == 'B') {
+        p += 2;
+    } else if (toupper((unsigned char)*p) == 'B') {
+        p++;
+    }
+
+    if (*p != '\0') {
+        return false;
+    }
+
+    if (shift != 0 && value > (UINT64_MAX >> shift)) {
+        return false;
+    }
+
+    *out = value << shift;
+    return true;
 }
\ No newline at end of file
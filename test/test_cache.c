@@ -0,0 +1,162 @@
+#include "../include/cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#define BLOCK_SECTORS 4
+#define BLOCK_SIZE (BLOCK_SECTORS * DISK_SECTOR_SIZE)
+
+const char* get_temp_filename() {
+    static char filename[64];
+    sprintf(filename, "test_cache_%d.bin", rand());
+    return filename;
+}
+
+void test_cache_hit_and_writeback() {
+    printf("Testing cache hits and write-back...\n");
+
+    const char *test_filename = get_temp_filename();
+    Disk disk;
+    assert(disk_init(&disk, test_filename));
+
+    BufferCache cache;
+    assert(cache_init(&cache, &disk, BLOCK_SECTORS, 16 * BLOCK_SIZE));
+
+    uint8_t disk_data[BLOCK_SIZE];
+    memset(disk_data, 0x11, sizeof(disk_data));
+    assert(disk_write_sectors(&disk, 100, BLOCK_SECTORS, disk_data));
+
+    uint8_t *block = cache_get(&cache, 100, true);
+    assert(block != NULL);
+    assert(block[0] == 0x11 && block[BLOCK_SIZE - 1] == 0x11);
+    block[0] = 0x22;
+    cache_release(&cache, 100, true);
+
+    memset(disk_data, 0x33, sizeof(disk_data));
+    assert(disk_write_sectors(&disk, 100, BLOCK_SECTORS, disk_data));
+
+    block = cache_get(&cache, 100, true);
+    assert(block[0] == 0x22);
+    assert(block[1] == 0x11);
+    cache_release(&cache, 100, false);
+
+    uint8_t read_back[BLOCK_SIZE];
+    assert(disk_read_sectors(&disk, 100, BLOCK_SECTORS, read_back));
+    assert(read_back[0] == 0x33);
+
+    assert(cache_flush(&cache));
+    assert(disk_read_sectors(&disk, 100, BLOCK_SECTORS, read_back));
+    assert(read_back[0] == 0x22);
+    assert(read_back[1] == 0x11);
+
+    block = cache_get(&cache, 200, false);
+    assert(block != NULL);
+    assert(block[0] == 0 && block[BLOCK_SIZE - 1] == 0);
+    cache_release(&cache, 200, false);
+
+    cache_destroy(&cache);
+    disk_close(&disk);
+    remove(test_filename);
+
+    printf("Cache hits and write-back test passed!\n");
+}
+
+void test_cache_eviction() {
+    printf("Testing cache LRU eviction...\n");
+
+    const char *test_filename = get_temp_filename();
+    Disk disk;
+    assert(disk_init(&disk, test_filename));
+
+    BufferCache cache;
+    assert(cache_init(&cache, &disk, BLOCK_SECTORS, CACHE_MIN_BLOCKS * BLOCK_SIZE));
+    assert(cache.capacity == CACHE_MIN_BLOCKS);
+
+    uint8_t *pinned = cache_get(&cache, 0, true);
+    assert(pinned != NULL);
+
+    for (uint32_t i = 1; i <= 10; i++) {
+        uint8_t *block = cache_get(&cache, i * BLOCK_SECTORS, false);
+        assert(block != NULL);
+        block[0] = (uint8_t)i;
+        cache_release(&cache, i * BLOCK_SECTORS, true);
+        assert(cache.count <= CACHE_MIN_BLOCKS);
+    }
+
+    assert(cache.lru_tail->sector == 0);
+    cache_release(&cache, 0, false);
+
+    uint8_t read_back[BLOCK_SIZE];
+    for (uint32_t i = 1; i <= 7; i++) {
+        assert(disk_read_sectors(&disk, i * BLOCK_SECTORS, BLOCK_SECTORS, read_back));
+        assert(read_back[0] == i);
+    }
+
+    assert(disk_read_sectors(&disk, 10 * BLOCK_SECTORS, BLOCK_SECTORS, read_back));
+    assert(read_back[0] == 0);
+
+    cache_destroy(&cache);
+
+    assert(disk_read_sectors(&disk, 10 * BLOCK_SECTORS, BLOCK_SECTORS, read_back));
+    assert(read_back[0] == 10);
+
+    disk_close(&disk);
+    remove(test_filename);
+
+    printf("Cache LRU eviction test passed!\n");
+}
+
+void test_cache_ranges() {
+    printf("Testing cache range write-back and discard...\n");
+
+    const char *test_filename = get_temp_filename();
+    Disk disk;
+    assert(disk_init(&disk, test_filename));
+
+    BufferCache cache;
+    assert(cache_init(&cache, &disk, BLOCK_SECTORS, 16 * BLOCK_SIZE));
+
+    for (uint32_t i = 0; i < 4; i++) {
+        uint8_t *block = cache_get(&cache, i * BLOCK_SECTORS, false);
+        assert(block != NULL);
+        block[0] = (uint8_t)(0x40 + i);
+        cache_release(&cache, i * BLOCK_SECTORS, true);
+    }
+
+    uint8_t read_back[BLOCK_SIZE];
+    assert(cache_write_back_range(&cache, BLOCK_SECTORS, 2 * BLOCK_SECTORS));
+    assert(disk_read_sectors(&disk, 0, BLOCK_SECTORS, read_back));
+    assert(read_back[0] == 0);
+    assert(disk_read_sectors(&disk, 2 * BLOCK_SECTORS, BLOCK_SECTORS, read_back));
+    assert(read_back[0] == 0x42);
+    assert(disk_read_sectors(&disk, 3 * BLOCK_SECTORS, BLOCK_SECTORS, read_back));
+    assert(read_back[0] == 0);
+
+    cache_discard_range(&cache, 2 * BLOCK_SECTORS, 2 * BLOCK_SECTORS);
+    assert(cache.count == 2);
+
+    cache_destroy(&cache);
+
+    assert(disk_read_sectors(&disk, 0, BLOCK_SECTORS, read_back));
+    assert(read_back[0] == 0x40);
+    assert(disk_read_sectors(&disk, 3 * BLOCK_SECTORS, BLOCK_SECTORS, read_back));
+    assert(read_back[0] == 0);
+
+    disk_close(&disk);
+    remove(test_filename);
+
+    printf("Cache range write-back and discard test passed!\n");
+}
+
+int main() {
+    srand(time(NULL));
+
+    test_cache_hit_and_writeback();
+    test_cache_eviction();
+    test_cache_ranges();
+
+    printf("All cache tests passed successfully!\n");
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "../include/dentry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+void test_dentry_lookup_insert() {
+    printf("Testing dentry cache lookup and insert...\n");
+
+    DentryCache cache;
+    assert(dentry_init(&cache, 16));
+
+    uint32_t cluster = 0;
+    uint8_t attr = 0;
+    assert(!dentry_lookup(&cache, "/docs", &cluster, &attr));
+
+    assert(dentry_insert(&cache, "/docs", 10, 0x10));
+    assert(dentry_insert(&cache, "/docs/notes", 11, 0x10));
+    assert(dentry_insert(&cache, "/docs/notes/a.txt", 12, 0x20));
+    assert(dentry_insert(&cache, "/docsx", 13, 0x10));
+    assert(cache.count == 4);
+
+    assert(dentry_lookup(&cache, "/docs/notes", &cluster, &attr));
+    assert(cluster == 11 && attr == 0x10);
+
+    assert(dentry_insert(&cache, "/docs/notes", 21, 0x10));
+    assert(cache.count == 4);
+    assert(dentry_lookup(&cache, "/docs/notes", &cluster, NULL));
+    assert(cluster == 21);
+
+    dentry_invalidate(&cache, "/docs");
+    assert(!dentry_lookup(&cache, "/docs", NULL, NULL));
+    assert(!dentry_lookup(&cache, "/docs/notes", NULL, NULL));
+    assert(!dentry_lookup(&cache, "/docs/notes/a.txt", NULL, NULL));
+    assert(dentry_lookup(&cache, "/docsx", NULL, NULL));
+    assert(cache.count == 1);
+
+    dentry_invalidate(&cache, "/");
+    assert(cache.count == 0);
+
+    dentry_destroy(&cache);
+
+    printf("Dentry cache lookup and insert test passed!\n");
+}
+
+void test_dentry_eviction() {
+    printf("Testing dentry cache LRU eviction...\n");
+
+    DentryCache cache;
+    assert(dentry_init(&cache, 4));
+
+    char path[32];
+    for (int i = 0; i < 4; i++) {
+        sprintf(path, "/dir%d", i);
+        assert(dentry_insert(&cache, path, 100 + i, 0x10));
+    }
+
+    assert(dentry_lookup(&cache, "/dir0", NULL, NULL));
+    assert(dentry_insert(&cache, "/dir4", 104, 0x10));
+    assert(cache.count == 4);
+    assert(!dentry_lookup(&cache, "/dir1", NULL, NULL));
+    assert(dentry_lookup(&cache, "/dir0", NULL, NULL));
+    assert(dentry_lookup(&cache, "/dir4", NULL, NULL));
+
+    dentry_clear(&cache);
+    assert(cache.count == 0);
+    assert(cache.lru_head == NULL && cache.lru_tail == NULL);
+
+    dentry_destroy(&cache);
+
+    printf("Dentry cache LRU eviction test passed!\n");
+}
+
+int main() {
+    test_dentry_lookup_insert();
+    test_dentry_eviction();
+
+    printf("All dentry cache tests passed successfully!\n");
+    return 0;
+}
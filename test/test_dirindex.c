@@ -0,0 +1,165 @@
+#include "../include/dirindex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static void make_name(char name[11], int n) {
+    char temp[12];
+    snprintf(temp, sizeof(temp), "F%07d   ", n);
+    memcpy(name, temp, 11);
+}
+
+void test_dirindex_insert_lookup() {
+    printf("Testing directory index insert and lookup...\n");
+
+    DirIndexCache cache;
+    assert(dirindex_init(&cache, DIRINDEX_DEFAULT_BUDGET));
+
+    DirIndex *index = dirindex_create(&cache, 2);
+    assert(index != NULL);
+    assert(dirindex_get(&cache, 2) == index);
+    assert(dirindex_get(&cache, 3) == NULL);
+
+    char name[11];
+    for (int i = 0; i < 5000; i++) {
+        make_name(name, i);
+        assert(dirindex_insert(&cache, index, name, 100 + i / 128, i % 128));
+    }
+    assert(index->live == 5000);
+
+    uint32_t cluster = 0;
+    uint32_t slot = 0;
+    make_name(name, 4321);
+    assert(dirindex_lookup(index, name, &cluster, &slot));
+    assert(cluster == 100 + 4321 / 128);
+    assert(slot == 4321 % 128);
+
+    make_name(name, 5000);
+    assert(!dirindex_lookup(index, name, NULL, NULL));
+
+    make_name(name, 17);
+    dirindex_remove(index, name);
+    assert(!dirindex_lookup(index, name, NULL, NULL));
+    assert(index->live == 4999);
+    assert(index->has_free_hint);
+    assert(index->free_cluster == 100 && index->free_slot == 17);
+
+    assert(dirindex_insert(&cache, index, name, 7, 9));
+    assert(dirindex_lookup(index, name, &cluster, &slot));
+    assert(cluster == 7 && slot == 9);
+    assert(index->live == 5000);
+
+    dirindex_drop(&cache, 2);
+    assert(dirindex_get(&cache, 2) == NULL);
+    assert(cache.bytes == 0);
+
+    dirindex_destroy(&cache);
+
+    printf("Directory index insert and lookup test passed!\n");
+}
+
+void test_dirindex_eviction() {
+    printf("Testing directory index eviction...\n");
+
+    DirIndexCache cache;
+    size_t one_index = sizeof(DirIndex) + DIRINDEX_MIN_SLOTS * sizeof(DirIndexEntry);
+    assert(dirindex_init(&cache, 3 * one_index));
+
+    assert(dirindex_create(&cache, 10) != NULL);
+    assert(dirindex_create(&cache, 11) != NULL);
+    assert(dirindex_create(&cache, 12) != NULL);
+
+    assert(dirindex_get(&cache, 10) != NULL);
+    assert(dirindex_create(&cache, 13) != NULL);
+    assert(dirindex_get(&cache, 11) == NULL);
+    assert(dirindex_get(&cache, 10) != NULL);
+    assert(cache.bytes <= cache.budget);
+
+    DirIndex *index = dirindex_get(&cache, 13);
+    char name[11];
+    for (int i = 0; i < 13; i++) {
+        make_name(name, i);
+        assert(dirindex_insert(&cache, index, name, 2, i));
+    }
+    assert(dirindex_get(&cache, 13) == index);
+    assert(dirindex_get(&cache, 12) == NULL);
+    assert(cache.bytes <= cache.budget);
+
+    int inserted = 13;
+    while (inserted < 1000) {
+        make_name(name, inserted);
+        if (!dirindex_insert(&cache, index, name, 2, inserted)) {
+            break;
+        }
+        inserted++;
+    }
+    assert(inserted < 1000);
+    assert(dirindex_get(&cache, 10) == NULL);
+    assert(dirindex_get(&cache, 13) == index);
+    assert(cache.bytes <= cache.budget);
+
+    dirindex_set_budget(&cache, 0);
+    assert(cache.lru_head == NULL);
+    assert(cache.bytes == 0);
+    assert(dirindex_create(&cache, 14) == NULL);
+
+    dirindex_destroy(&cache);
+
+    printf("Directory index eviction test passed!\n");
+}
+
+void test_dirindex_long_names() {
+    printf("Testing directory index long name records...\n");
+
+    DirIndexCache cache;
+    assert(dirindex_init(&cache, DIRINDEX_DEFAULT_BUDGET));
+
+    DirIndex *index = dirindex_create(&cache, 2);
+    assert(index != NULL);
+
+    char first[11];
+    char second[11];
+    make_name(first, 1);
+    make_name(second, 2);
+    assert(dirindex_insert(&cache, index, first, 5, 3));
+    assert(dirindex_insert_long(&cache, index, 0x1234, first, 5, 1));
+    assert(dirindex_insert(&cache, index, second, 6, 4));
+    assert(dirindex_insert_long(&cache, index, 0x1234, second, 6, 0));
+
+    uint32_t cluster = 0;
+    uint32_t slot = 0;
+    assert(dirindex_lookup(index, first, &cluster, &slot));
+    assert(cluster == 5 && slot == 3);
+
+    uint32_t cursor = 0;
+    int seen = 0;
+    while (dirindex_next_long(index, 0x1234, &cursor, &cluster, &slot)) {
+        assert((cluster == 5 && slot == 1) || (cluster == 6 && slot == 0));
+        seen++;
+    }
+    assert(seen == 2);
+
+    cursor = 0;
+    assert(!dirindex_next_long(index, 0x4321, &cursor, &cluster, &slot));
+
+    dirindex_remove_long(index, 0x1234, first);
+    cursor = 0;
+    assert(dirindex_next_long(index, 0x1234, &cursor, &cluster, &slot));
+    assert(cluster == 6 && slot == 0);
+    assert(!dirindex_next_long(index, 0x1234, &cursor, &cluster, &slot));
+    assert(dirindex_lookup(index, first, NULL, NULL));
+
+    dirindex_destroy(&cache);
+
+    printf("Directory index long name records test passed!\n");
+}
+
+int main() {
+    test_dirindex_insert_lookup();
+    test_dirindex_eviction();
+    test_dirindex_long_names();
+
+    printf("All directory index tests passed successfully!\n");
+    return 0;
+}
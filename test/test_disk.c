@@ -4,6 +4,7 @@
 #include <string.h>
 #include <assert.h>
 #include <time.h>
+#include <sys/stat.h>
 
 const char* get_temp_filename() {
     static char filename[64];
@@ -18,7 +19,7 @@ void test_disk_init() {
     Disk disk;
     
     assert(disk_init(&disk, test_filename));
-    assert(disk.file != NULL);
+    assert(disk.fd >= 0);
     assert(disk.total_sectors == DISK_DEFAULT_SIZE / DISK_SECTOR_SIZE);
     
     disk_close(&disk);
@@ -56,11 +57,207 @@ void test_disk_sector_operations() {
     printf("Disk sector operations test passed!\n");
 }
 
+void test_disk_mmap_backend() {
+    printf("Testing disk mmap backend...\n");
+
+    const char *test_filename = get_temp_filename();
+    Disk disk;
+    DiskOptions options = { .backend = DISK_BACKEND_MMAP };
+    assert(disk_init_with_options(&disk, test_filename, &options));
+    assert(disk.map != NULL);
+
+    uint8_t write_buffer[DISK_SECTOR_SIZE * 2];
+    uint8_t read_buffer[DISK_SECTOR_SIZE * 2];
+
+    for (int i = 0; i < DISK_SECTOR_SIZE * 2; i++) {
+        write_buffer[i] = (uint8_t)(i * 7);
+    }
+
+    assert(disk_write_sectors(&disk, 10, 2, write_buffer));
+    assert(disk_read_sectors(&disk, 10, 2, read_buffer));
+    assert(memcmp(write_buffer, read_buffer, sizeof(write_buffer)) == 0);
+
+    uint8_t *mapped = disk_sector_ptr(&disk, 10, 2);
+    assert(mapped != NULL);
+    assert(memcmp(mapped, write_buffer, sizeof(write_buffer)) == 0);
+    mapped[0] = 0xAB;
+    assert(disk_sync(&disk));
+    assert(disk_sector_ptr(&disk, disk.total_sectors - 1, 2) == NULL);
+
+    disk_close(&disk);
+
+    assert(disk_init(&disk, test_filename));
+    assert(disk.map == NULL);
+    assert(disk_sector_ptr(&disk, 10, 1) == NULL);
+    assert(disk_read_sectors(&disk, 10, 2, read_buffer));
+    assert(read_buffer[0] == 0xAB);
+    assert(memcmp(write_buffer + 1, read_buffer + 1, sizeof(write_buffer) - 1) == 0);
+
+    disk_close(&disk);
+    remove(test_filename);
+
+    printf("Disk mmap backend test passed!\n");
+}
+
+void test_disk_sparse_create() {
+    printf("Testing sparse disk creation...\n");
+
+    const char *test_filename = get_temp_filename();
+    Disk disk;
+    DiskOptions options = { .backend = DISK_BACKEND_FILE, .size = 1024ull * 1024 * 1024 };
+
+    assert(disk_init_with_options(&disk, test_filename, &options));
+    assert(disk.total_sectors == options.size / DISK_SECTOR_SIZE);
+
+    struct stat st;
+    assert(stat(test_filename, &st) == 0);
+    assert((uint64_t)st.st_size == options.size);
+    assert((uint64_t)st.st_blocks * 512 < options.size / 16);
+
+    uint8_t buffer[DISK_SECTOR_SIZE];
+    memset(buffer, 0xFF, sizeof(buffer));
+    assert(disk_read_sector(&disk, disk.total_sectors - 1, buffer));
+    for (int i = 0; i < DISK_SECTOR_SIZE; i++) {
+        assert(buffer[i] == 0);
+    }
+
+    disk_close(&disk);
+
+    options.size = 4096;
+    assert(disk_init_with_options(&disk, test_filename, &options));
+    assert(disk.total_sectors == 1024ull * 1024 * 1024 / DISK_SECTOR_SIZE);
+
+    disk_close(&disk);
+    remove(test_filename);
+
+    printf("Sparse disk creation test passed!\n");
+}
+
+void test_disk_stats() {
+    printf("Testing disk I/O counters...\n");
+
+    const char *test_filename = get_temp_filename();
+    Disk disk;
+    assert(disk_init(&disk, test_filename));
+
+    DiskStats stats;
+    disk_get_stats(&disk, &stats);
+    assert(stats.read_ops == 0 && stats.write_ops == 0 && stats.syscalls == 0);
+
+    uint8_t buffer[8 * DISK_SECTOR_SIZE];
+    memset(buffer, 0x5A, sizeof(buffer));
+    assert(disk_write_sector(&disk, 3, buffer));
+    assert(disk_write_sectors(&disk, 10, 8, buffer));
+    assert(disk_read_sectors(&disk, 10, 8, buffer));
+    assert(!disk_read_sector(&disk, disk.total_sectors, buffer));
+    assert(disk_sync(&disk));
+
+    disk_get_stats(&disk, &stats);
+    assert(stats.write_ops == 2);
+    assert(stats.sectors_written == 9);
+    assert(stats.read_ops == 1);
+    assert(stats.sectors_read == 8);
+    assert(stats.seeks == 3);
+    assert(stats.syncs == 1);
+    assert(stats.syscalls == 4);
+
+    assert(disk_read_sectors(&disk, 18, 2, buffer));
+    disk_get_stats(&disk, &stats);
+    assert(stats.seeks == 3);
+
+    disk_reset_stats(&disk);
+    disk_get_stats(&disk, &stats);
+    assert(stats.sectors_written == 0 && stats.syncs == 0 && stats.syscalls == 0);
+
+    disk_close(&disk);
+    remove(test_filename);
+
+    printf("Disk I/O counters test passed!\n");
+}
+
+static void fill_sectors(Disk *disk, uint64_t start, uint64_t count, uint8_t value) {
+    uint8_t buffer[64 * DISK_SECTOR_SIZE];
+    memset(buffer, value, sizeof(buffer));
+    while (count > 0) {
+        uint32_t n = count < 64 ? (uint32_t)count : 64;
+        assert(disk_write_sectors(disk, start, n, buffer));
+        start += n;
+        count -= n;
+    }
+}
+
+static bool sector_is(Disk *disk, uint64_t sector, uint8_t value) {
+    uint8_t buffer[DISK_SECTOR_SIZE];
+    assert(disk_read_sector(disk, sector, buffer));
+    for (int i = 0; i < DISK_SECTOR_SIZE; i++) {
+        if (buffer[i] != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_disk_zero() {
+    printf("Testing disk zeroing...\n");
+
+    const char *test_filename = get_temp_filename();
+    DiskBackend backends[] = { DISK_BACKEND_FILE, DISK_BACKEND_MMAP };
+
+    for (int b = 0; b < 2; b++) {
+        Disk disk;
+        DiskOptions options = { .backend = backends[b], .size = 64ull * 1024 * 1024 };
+        assert(disk_init_with_options(&disk, test_filename, &options));
+
+        uint64_t start = 5;
+        uint64_t count = 3 * 8192 + 77;
+        fill_sectors(&disk, start - 1, count + 2, 0xC3);
+
+        disk_reset_stats(&disk);
+        assert(disk_write_zeros(&disk, start, count, 4));
+        DiskStats stats;
+        disk_get_stats(&disk, &stats);
+        assert(stats.write_ops == 1);
+        assert(stats.sectors_written == count);
+
+        assert(sector_is(&disk, start - 1, 0xC3));
+        assert(sector_is(&disk, start + count, 0xC3));
+        for (uint64_t sector = start; sector < start + count; sector += 997) {
+            assert(sector_is(&disk, sector, 0));
+        }
+        assert(sector_is(&disk, start + count - 1, 0));
+
+        fill_sectors(&disk, start - 1, count + 2, 0x3C);
+        disk_reset_stats(&disk);
+        assert(disk_zero_range(&disk, start, count));
+        disk_get_stats(&disk, &stats);
+        assert(stats.sectors_zeroed + stats.sectors_written == count);
+
+        assert(sector_is(&disk, start - 1, 0x3C));
+        assert(sector_is(&disk, start + count, 0x3C));
+        for (uint64_t sector = start; sector < start + count; sector += 997) {
+            assert(sector_is(&disk, sector, 0));
+        }
+        assert(sector_is(&disk, start + count - 1, 0));
+
+        assert(!disk_write_zeros(&disk, disk.total_sectors - 1, 2, 1));
+        assert(!disk_zero_range(&disk, disk.total_sectors, 1));
+
+        disk_close(&disk);
+        remove(test_filename);
+    }
+
+    printf("Disk zeroing test passed!\n");
+}
+
 int main() {
     srand(time(NULL));
     
     test_disk_init();
     test_disk_sector_operations();
+    test_disk_mmap_backend();
+    test_disk_sparse_create();
+    test_disk_stats();
+    test_disk_zero();
     
     printf("All disk tests passed successfully!\n");
     return 0;
@@ -115,12 +115,1405 @@ void test_fat32_file_operations() {
     printf("FAT32 file operations test passed!\n");
 }
 
+static uint32_t read_fat_entry_from_disk(FAT32_FileSystem *fs, uint8_t fat_index, uint32_t cluster) {
+    uint32_t sector_data[DISK_SECTOR_SIZE / sizeof(uint32_t)];
+    uint32_t sector = fs->bootSector.BPB_RsvdSecCnt + fat_index * fs->fat_size
+                      + cluster / (DISK_SECTOR_SIZE / sizeof(uint32_t));
+    assert(disk_read_sector(&fs->disk, sector, sector_data));
+    return sector_data[cluster % (DISK_SECTOR_SIZE / sizeof(uint32_t))];
+}
+
+void test_fat32_fat_writeback() {
+    printf("Testing FAT32 dirty sector write-back...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+
+    uint32_t cluster = 300;
+    assert(fat32_set_cluster_value(&fs, cluster, FAT32_CLUSTER_END));
+    assert(fat32_get_next_cluster(&fs, cluster) == FAT32_CLUSTER_END);
+    assert(read_fat_entry_from_disk(&fs, 0, cluster) == FAT32_CLUSTER_FREE);
+    assert(read_fat_entry_from_disk(&fs, 1, cluster) == FAT32_CLUSTER_FREE);
+
+    assert(fat32_sync(&fs));
+    assert(read_fat_entry_from_disk(&fs, 0, cluster) == FAT32_CLUSTER_END);
+    assert(read_fat_entry_from_disk(&fs, 1, cluster) == FAT32_CLUSTER_END);
+
+    assert(fat32_create_directory(&fs, "newdir"));
+    uint32_t dir_cluster = 3;
+    assert(fat32_get_next_cluster(&fs, dir_cluster) == FAT32_CLUSTER_END);
+    assert(read_fat_entry_from_disk(&fs, 0, dir_cluster) == FAT32_CLUSTER_END);
+    assert(read_fat_entry_from_disk(&fs, 1, dir_cluster) == FAT32_CLUSTER_END);
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 dirty sector write-back test passed!\n");
+}
+
+void test_fat32_allocation_index() {
+    printf("Testing FAT32 free cluster index...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+
+    uint32_t initial_free = fs.free_count;
+    assert(initial_free == fs.data_cluster_count - 1);
+
+    uint32_t first = fat32_allocate_cluster(&fs);
+    uint32_t second = fat32_allocate_cluster(&fs);
+    assert(first == FAT32_ROOTDIR_CLUSTER + 1);
+    assert(second == first + 1);
+    assert(fs.free_count == initial_free - 2);
+
+    uint32_t allocated = 2;
+    while (fat32_allocate_cluster(&fs) != 0) {
+        allocated++;
+    }
+    assert(allocated == initial_free);
+    assert(fs.free_count == 0);
+
+    uint32_t middle = fs.data_cluster_count / 2;
+    assert(fat32_set_cluster_value(&fs, middle, FAT32_CLUSTER_FREE));
+    assert(fs.free_count == 1);
+    assert(fat32_allocate_cluster(&fs) == middle);
+    assert(fat32_allocate_cluster(&fs) == 0);
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 free cluster index test passed!\n");
+}
+
+void test_fat32_fsinfo() {
+    printf("Testing FAT32 FSInfo sector...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+
+    FAT32_FSInfo fsinfo;
+    assert(disk_read_sector(&fs.disk, fs.bootSector.BPB_FSInfo, &fsinfo));
+    assert(fsinfo.FSI_LeadSig == FAT32_FSINFO_LEAD_SIG);
+    assert(fsinfo.FSI_StrucSig == FAT32_FSINFO_STRUC_SIG);
+    assert(fsinfo.FSI_TrailSig == FAT32_FSINFO_TRAIL_SIG);
+    assert(fsinfo.FSI_Free_Count == fs.data_cluster_count - 1);
+
+    assert(fat32_create_directory(&fs, "dir1"));
+    assert(fat32_create_directory(&fs, "dir2"));
+
+    uint32_t free_clusters = 0;
+    uint32_t total_clusters = 0;
+    assert(fat32_get_free_space(&fs, &free_clusters, &total_clusters));
+    assert(total_clusters == fs.data_cluster_count);
+    assert(free_clusters == total_clusters - 3);
+
+    assert(disk_read_sector(&fs.disk, fs.bootSector.BPB_FSInfo, &fsinfo));
+    assert(fsinfo.FSI_Free_Count == free_clusters);
+    assert(fsinfo.FSI_Nxt_Free == 5);
+
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fs.is_formatted);
+    assert(fs.free_map == NULL);
+    assert(fat32_get_free_space(&fs, &free_clusters, &total_clusters));
+    assert(free_clusters == total_clusters - 3);
+    assert(fat32_allocate_cluster(&fs) == 5);
+    assert(fs.free_count == total_clusters - 4);
+
+    memset(&fsinfo, 0, sizeof(fsinfo));
+    assert(disk_write_sector(&fs.disk, fs.bootSector.BPB_FSInfo, &fsinfo));
+    fs.fsinfo_dirty = false;
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fs.free_map != NULL);
+    assert(fat32_get_free_space(&fs, &free_clusters, &total_clusters));
+    assert(free_clusters == total_clusters - 4);
+
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fs.free_map == NULL);
+    assert(fs.free_count == total_clusters - 4);
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 FSInfo sector test passed!\n");
+}
+
+void test_fat32_mmap_backend() {
+    printf("Testing FAT32 on the mmap backend...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+    DiskOptions options = { .backend = DISK_BACKEND_MMAP };
+
+    assert(fat32_init_with_options(&fs, test_filename, &options));
+    assert(fat32_format(&fs));
+    assert(fat32_create_directory(&fs, "mapped"));
+    assert(fat32_change_directory(&fs, "/mapped"));
+    assert(fat32_create_file(&fs, "inner.txt"));
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fs.is_formatted);
+    assert(fat32_change_directory(&fs, "/mapped"));
+
+    FAT32_DirEntry entries[10];
+    uint32_t count = 0;
+    assert(fat32_list_directory(&fs, NULL, entries, 10, &count));
+    assert(count == 3);
+    assert(strncmp(entries[2].DIR_Name, "INNER   TXT", 11) == 0);
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 mmap backend test passed!\n");
+}
+
+void test_fat32_small_cache() {
+    printf("Testing FAT32 with a small cluster cache...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_set_cache_budget(&fs, 0));
+    assert(fat32_format(&fs));
+    assert(fs.cache.capacity == CACHE_MIN_BLOCKS);
+
+    char name[16];
+    for (int i = 0; i < 100; i++) {
+        sprintf(name, "dir%d", i);
+        assert(fat32_create_directory(&fs, name));
+    }
+    assert(fat32_change_directory(&fs, "/dir42"));
+    assert(fat32_create_file(&fs, "inside.txt"));
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    FAT32_DirEntry entries[128];
+    uint32_t count = 0;
+    assert(fat32_list_directory(&fs, NULL, entries, 128, &count));
+    assert(count == 102);
+    assert(fat32_list_directory(&fs, "/dir42", entries, 128, &count));
+    assert(count == 3);
+    assert(strncmp(entries[2].DIR_Name, "INSIDE  TXT", 11) == 0);
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 small cluster cache test passed!\n");
+}
+
+void test_fat32_large_image() {
+    printf("Testing FAT32 on an image larger than 4 GiB...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+    DiskOptions options = { .backend = DISK_BACKEND_FILE, .size = 6ull * 1024 * 1024 * 1024 };
+
+    assert(fat32_init_with_options(&fs, test_filename, &options));
+    assert(fat32_format(&fs));
+    assert(fs.bootSector.BPB_TotSec32 == options.size / DISK_SECTOR_SIZE);
+
+    uint64_t boundary_sector = 4ull * 1024 * 1024 * 1024 / DISK_SECTOR_SIZE;
+    uint32_t boundary = (uint32_t)((boundary_sector - fs.first_data_sector) / fs.sectors_per_cluster) + 2;
+    assert(fat32_sector_for_cluster(&fs, boundary) == boundary_sector);
+    assert(boundary + 64 < fs.data_cluster_count + 2);
+
+    uint8_t *buffer = (uint8_t*)malloc(fs.bytes_per_cluster);
+    assert(buffer != NULL);
+
+    fs.next_free = boundary - 16;
+    for (uint32_t i = 0; i < 32; i++) {
+        uint32_t cluster = fat32_allocate_cluster(&fs);
+        assert(cluster == boundary - 16 + i);
+        memset(buffer, (uint8_t)cluster, fs.bytes_per_cluster);
+        memcpy(buffer, &cluster, sizeof(cluster));
+        assert(fat32_write_cluster(&fs, cluster, buffer));
+    }
+
+    assert(fat32_create_directory(&fs, "high"));
+    assert(fat32_change_directory(&fs, "/high"));
+    assert(fat32_create_file(&fs, "deep.txt"));
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fs.is_formatted);
+    assert(fs.bootSector.BootSignature == FAT32_SIGNATURE);
+
+    for (uint32_t cluster = boundary - 16; cluster < boundary + 16; cluster++) {
+        uint32_t stamp = 0;
+        assert(fat32_read_cluster(&fs, cluster, buffer));
+        memcpy(&stamp, buffer, sizeof(stamp));
+        assert(stamp == cluster);
+        assert(buffer[fs.bytes_per_cluster - 1] == (uint8_t)cluster);
+        assert(fat32_get_next_cluster(&fs, cluster) >= FAT32_CLUSTER_END - 7);
+    }
+
+    uint8_t sector[DISK_SECTOR_SIZE];
+    assert(disk_read_sector(&fs.disk, boundary_sector, sector));
+    assert(memcmp(sector, &boundary, sizeof(boundary)) == 0);
+
+    FAT32_DirEntry entries[10];
+    uint32_t count = 0;
+    assert(fat32_list_directory(&fs, "/high", entries, 10, &count));
+    assert(count == 3);
+    assert(strncmp(entries[2].DIR_Name, "DEEP    TXT", 11) == 0);
+
+    free(buffer);
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 large image test passed!\n");
+}
+
+void test_fat32_paged_fat() {
+    printf("Testing FAT32 paged FAT access...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+    DiskOptions options = { .backend = DISK_BACKEND_FILE, .size = 256ull * 1024 * 1024 * 1024 };
+
+    assert(fat32_init_with_options(&fs, test_filename, &options));
+    assert(fat32_format(&fs));
+    assert(fs.fat_size > 16 * 1024);
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fs.is_formatted);
+    FAT32_Stats stats;
+    fat32_get_stats(&fs, &stats);
+    assert(stats.disk.sectors_read <= 2);
+    assert(fs.fat_cache.count == 0);
+    assert(fs.free_map == NULL);
+
+    assert(fat32_set_fat_cache_budget(&fs, 0));
+    assert(fs.fat_cache.capacity == FATCACHE_MIN_PAGES);
+
+    assert(fat32_create_directory(&fs, "data"));
+    uint32_t far = fs.data_cluster_count - 100;
+    fs.next_free = far;
+    uint32_t first = 0;
+    assert(fat32_allocate_clusters(&fs, 50, 0, &first));
+    assert(first == far);
+
+    uint32_t spread[8];
+    for (uint32_t i = 0; i < 8; i++) {
+        spread[i] = 2 + (i + 1) * (fs.data_cluster_count / 9);
+        assert(fat32_set_cluster_value(&fs, spread[i], i == 7 ? FAT32_CLUSTER_END : spread[i] + 1));
+        assert(fs.fat_cache.count <= fs.fat_cache.capacity);
+    }
+    assert(fat32_sync(&fs));
+
+    fat32_get_stats(&fs, &stats);
+    assert(stats.fat_page_misses > 8);
+    assert(stats.disk.sectors_read < 1024);
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    uint32_t cluster = first;
+    for (uint32_t i = 0; i < 49; i++) {
+        assert(fat32_get_next_cluster(&fs, cluster) == cluster + 1);
+        cluster++;
+    }
+    assert(fat32_get_next_cluster(&fs, cluster) >= FAT32_CLUSTER_END);
+    for (uint32_t i = 0; i < 8; i++) {
+        assert(fat32_get_next_cluster(&fs, spread[i]) == (i == 7 ? FAT32_CLUSTER_END : spread[i] + 1));
+    }
+
+    uint32_t free_clusters = 0;
+    uint32_t total_clusters = 0;
+    assert(fat32_get_free_space(&fs, &free_clusters, &total_clusters));
+    assert(free_clusters == total_clusters - 1 - 1 - 50 - 8);
+    assert(fat32_change_directory(&fs, "/data"));
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 paged FAT access test passed!\n");
+}
+
+void test_fat32_dir_index() {
+    printf("Testing FAT32 directory name index...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+
+    char name[16];
+    for (int i = 0; i < 2000; i++) {
+        sprintf(name, "f%d.txt", i);
+        assert(fat32_create_file(&fs, name));
+    }
+    assert(!fat32_create_file(&fs, "f1234.txt"));
+    assert(fat32_create_directory(&fs, "sub"));
+    assert(!fat32_create_directory(&fs, "f0.txt"));
+
+    DirIndex *index = dirindex_get(&fs.dir_index, FAT32_ROOTDIR_CLUSTER);
+    assert(index != NULL);
+    assert(index->live == 2003);
+
+    assert(fat32_change_directory(&fs, "/sub"));
+    assert(fat32_create_file(&fs, "inner.txt"));
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(dirindex_get(&fs.dir_index, FAT32_ROOTDIR_CLUSTER) == NULL);
+    assert(!fat32_create_file(&fs, "f1999.txt"));
+    assert(fat32_create_file(&fs, "f2000.txt"));
+    assert(fat32_change_directory(&fs, "/sub"));
+
+    assert(fat32_set_dir_index_budget(&fs, 0));
+    assert(fs.dir_index.lru_head == NULL);
+    assert(!fat32_create_file(&fs, "inner.txt"));
+    assert(fat32_change_directory(&fs, "/"));
+    assert(!fat32_create_file(&fs, "f42.txt"));
+    assert(fat32_create_file(&fs, "f2001.txt"));
+
+    FAT32_DirEntry *entries = (FAT32_DirEntry*)malloc(2100 * sizeof(FAT32_DirEntry));
+    assert(entries != NULL);
+    uint32_t count = 0;
+    assert(fat32_list_directory(&fs, "/", entries, 2100, &count));
+    assert(count == 2005);
+    free(entries);
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 directory name index test passed!\n");
+}
+
+static bool has_listed_name(FAT32_FileSystem *fs, const char *path, const char *name) {
+    FAT32_DirInfo *infos = (FAT32_DirInfo*)malloc(64 * sizeof(FAT32_DirInfo));
+    assert(infos != NULL);
+    uint32_t count = 0;
+    assert(fat32_read_directory(fs, path, infos, 64, &count));
+
+    bool found = false;
+    for (uint32_t i = 0; i < count && !found; i++) {
+        found = strcmp(infos[i].name, name) == 0;
+    }
+    free(infos);
+    return found;
+}
+
+static void check_long_names(FAT32_FileSystem *fs, const char *spanning) {
+    FAT32_File file;
+
+    assert(fat32_change_directory(fs, "/Long Directory Name"));
+    assert(!fat32_create_file(fs, "LONG FILE NAME.TXT"));
+    assert(!fat32_create_file(fs, "longfi~1.txt"));
+    assert(!fat32_create_file(fs, "caf\xc3\xa9 menu.txt"));
+    assert(!fat32_create_file(fs, spanning));
+
+    assert(fat32_open(fs, "/long directory name/long file name.txt", FAT32_O_READ, &file));
+    assert(file.size == 5);
+    assert(fat32_close_file(&file));
+    assert(fat32_open(fs, "/LONGDI~1/LONGFI~1.TXT", FAT32_O_READ, &file));
+    assert(file.size == 5);
+    assert(fat32_close_file(&file));
+    assert(fat32_open(fs, "/Long Directory Name/LONGFI~2.TXT", FAT32_O_READ, &file));
+    assert(file.size == 0);
+    assert(fat32_close_file(&file));
+
+    assert(has_listed_name(fs, "/", "Long Directory Name"));
+    assert(has_listed_name(fs, NULL, "Long File Name.txt"));
+    assert(has_listed_name(fs, NULL, "Long File Number.txt"));
+    assert(has_listed_name(fs, NULL, "caf\xc3\xa9 menu.txt"));
+    assert(has_listed_name(fs, NULL, "readme.md"));
+    assert(has_listed_name(fs, NULL, spanning));
+
+    FAT32_DirEntry entries[64];
+    uint32_t count = 0;
+    assert(fat32_list_directory(fs, NULL, entries, 64, &count));
+    assert(count == 18);
+}
+
+void test_fat32_long_names() {
+    printf("Testing FAT32 long filenames...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+    FAT32_File file;
+    uint32_t written = 0;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+    assert(fs.bytes_per_cluster == 512);
+
+    assert(fat32_create_directory(&fs, "Long Directory Name"));
+    assert(fat32_change_directory(&fs, "/Long Directory Name"));
+    uint32_t dir_cluster = fs.current_dir_cluster;
+
+    char spanning[64];
+    memset(spanning, 'z', 60);
+    spanning[60] = '\0';
+    char name[8];
+    for (int i = 0; i < 11; i++) {
+        sprintf(name, "s%d", i);
+        assert(fat32_create_file(&fs, name));
+    }
+    assert(fat32_create_file(&fs, spanning));
+    assert(fat32_create_file(&fs, "Long File Name.txt"));
+    assert(fat32_create_file(&fs, "Long File Number.txt"));
+    assert(fat32_create_file(&fs, "caf\xc3\xa9 menu.txt"));
+    assert(fat32_create_file(&fs, "readme.md"));
+    assert(!fat32_create_file(&fs, "bad name."));
+    assert(!fat32_create_file(&fs, "bad\xc3"));
+
+    assert(fat32_open(&fs, "Long File Name.txt", FAT32_O_WRITE, &file));
+    assert(fat32_write(&file, "hello", 5, &written) && written == 5);
+    assert(fat32_close_file(&file));
+
+    check_long_names(&fs, spanning);
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    check_long_names(&fs, spanning);
+    assert(fat32_set_dir_index_budget(&fs, 0));
+    check_long_names(&fs, spanning);
+
+    assert(fat32_create_file(&fs, "Long File Nothing.txt"));
+    assert(fat32_open(&fs, "/Long Directory Name/LONGFI~3.TXT", FAT32_O_READ, &file));
+    assert(fat32_close_file(&file));
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    uint8_t *cluster = (uint8_t*)malloc(fs.bytes_per_cluster);
+    assert(cluster != NULL);
+    assert(fat32_read_cluster(&fs, dir_cluster, cluster));
+    FAT32_LFNEntry *first = (FAT32_LFNEntry*)(cluster + 13 * sizeof(FAT32_DirEntry));
+    assert(first->LDIR_Attr == FAT32_ATTR_LFN);
+    assert(first->LDIR_0rd == (FAT32_LFN_LAST_ENTRY | 5));
+    first->LDIR_Chksum ^= 0xFF;
+    assert(fat32_write_cluster(&fs, dir_cluster, cluster));
+    free(cluster);
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_change_directory(&fs, "/Long Directory Name"));
+    assert(!fat32_open(&fs, spanning, FAT32_O_READ, &file));
+    assert(fat32_open(&fs, "ZZZZZZ~1", FAT32_O_READ, &file));
+    assert(fat32_close_file(&file));
+    assert(!has_listed_name(&fs, NULL, spanning));
+    assert(has_listed_name(&fs, NULL, "ZZZZZZ~1"));
+    fat32_close(&fs);
+
+    remove(test_filename);
+
+    printf("FAT32 long filenames test passed!\n");
+}
+
+void test_fat32_dentry_cache() {
+    printf("Testing FAT32 path resolution cache...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+
+    assert(fat32_create_directory(&fs, "a"));
+    assert(fat32_change_directory(&fs, "/a"));
+    assert(fat32_create_directory(&fs, "b"));
+    assert(fat32_change_directory(&fs, "/a/b"));
+    assert(fat32_create_directory(&fs, "c"));
+    assert(fat32_create_file(&fs, "file.txt"));
+    assert(fat32_change_directory(&fs, "/a/b/c"));
+    uint32_t c_cluster = fs.current_dir_cluster;
+
+    uint32_t cluster = 0;
+    uint8_t attr = 0;
+    assert(dentry_lookup(&fs.dentries, "/A/B/C", &cluster, &attr));
+    assert(cluster == c_cluster);
+    assert(attr & FAT32_ATTR_DIRECTORY);
+    assert(dentry_lookup(&fs.dentries, "/A", NULL, NULL));
+
+    assert(dentry_insert(&fs.dentries, "/A/B/C", 12345, FAT32_ATTR_DIRECTORY));
+    assert(fat32_change_directory(&fs, "/a/b/c"));
+    assert(fs.current_dir_cluster == 12345);
+
+    assert(fat32_change_directory(&fs, "/a/b"));
+    assert(!fat32_create_directory(&fs, "c"));
+    assert(fat32_create_directory(&fs, "d"));
+    assert(dentry_insert(&fs.dentries, "/A/B/E/F", 999, FAT32_ATTR_DIRECTORY));
+    assert(fat32_create_directory(&fs, "e"));
+    assert(!dentry_lookup(&fs.dentries, "/A/B/E/F", NULL, NULL));
+    assert(!fat32_change_directory(&fs, "/a/b/e/f"));
+
+    assert(!fat32_change_directory(&fs, "/a/b/file.txt"));
+    assert(!fat32_change_directory(&fs, "/a/b/file.txt/x"));
+    assert(dentry_lookup(&fs.dentries, "/A/B/FILE.TXT", NULL, &attr));
+    assert(!(attr & FAT32_ATTR_DIRECTORY));
+
+    assert(fat32_format(&fs));
+    assert(fs.dentries.count == 0);
+    assert(!fat32_change_directory(&fs, "/a/b/c"));
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 path resolution cache test passed!\n");
+}
+
+static void fill_pattern(uint8_t *buffer, uint32_t length, uint32_t seed) {
+    for (uint32_t i = 0; i < length; i++) {
+        buffer[i] = (uint8_t)((i + seed) * 31 + (i >> 8));
+    }
+}
+
+void test_fat32_fat_extents() {
+    printf("Testing FAT32 run-length FAT...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_set_fat_extents(&fs, true));
+    assert(fs.fat_map.runs == NULL);
+    assert(fat32_format(&fs));
+    assert(fs.fat_map.runs != NULL);
+    assert(fs.fat_map.count == 2);
+
+    uint32_t first = 0;
+    assert(fat32_allocate_clusters(&fs, 100, 0, &first));
+    assert(first == FAT32_ROOTDIR_CLUSTER + 1);
+    assert(fs.fat_map.count == 3);
+    assert(fat32_create_directory(&fs, "data"));
+
+    uint32_t total = 20 * fs.bytes_per_cluster + 99;
+    uint8_t *expected = (uint8_t*)malloc(total);
+    uint8_t *actual = (uint8_t*)malloc(total);
+    assert(expected && actual);
+    fill_pattern(expected, total, 11);
+
+    FAT32_File file;
+    uint32_t done = 0;
+    assert(fat32_open(&fs, "/data/blob.bin", FAT32_O_WRITE | FAT32_O_CREATE, &file));
+    assert(fat32_write(&file, expected, total, &done));
+    assert(done == total);
+    assert(fat32_close_file(&file));
+
+    uint32_t hole = first + 50;
+    assert(fat32_set_cluster_value(&fs, hole - 1, FAT32_CLUSTER_END));
+    assert(fat32_set_cluster_value(&fs, hole, FAT32_CLUSTER_FREE));
+    fs.next_free = first;
+    assert(fat32_allocate_cluster(&fs) == hole);
+    assert(fat32_sync(&fs));
+
+    for (uint32_t cluster = 0; cluster < fs.data_cluster_count / 4; cluster++) {
+        uint32_t value = cluster < 2 ? read_fat_entry_from_disk(&fs, 0, cluster)
+                                     : fat32_get_next_cluster(&fs, cluster);
+        assert(read_fat_entry_from_disk(&fs, 0, cluster) == value);
+        assert(read_fat_entry_from_disk(&fs, 1, cluster) == value);
+    }
+    assert(read_fat_entry_from_disk(&fs, 0, hole) == FAT32_CLUSTER_END);
+    assert(read_fat_entry_from_disk(&fs, 0, 0) == (0x0FFFFF00 | fs.bootSector.BPB_Media));
+
+    uint32_t free_clusters = fs.free_count;
+    assert(fat32_set_fat_extents(&fs, false));
+    assert(fs.fat_map.runs == NULL);
+    assert(fat32_get_next_cluster(&fs, hole) == FAT32_CLUSTER_END);
+    assert(fat32_set_fat_extents(&fs, true));
+    assert(fs.fat_map.runs != NULL);
+    assert(fs.free_count == free_clusters);
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fs.fat_map.runs == NULL);
+    assert(fs.free_count == free_clusters);
+    assert(fat32_get_next_cluster(&fs, hole - 1) == FAT32_CLUSTER_END);
+    assert(fat32_get_next_cluster(&fs, first) == first + 1);
+    assert(fat32_set_fat_extents(&fs, true));
+    assert(fs.fat_map.count < 16);
+
+    assert(fat32_open(&fs, "/data/blob.bin", FAT32_O_READ, &file));
+    assert(fat32_read(&file, actual, total, &done));
+    assert(done == total);
+    assert(memcmp(actual, expected, total) == 0);
+    assert(file.extent_count == 1);
+    assert(fat32_close_file(&file));
+
+    assert(fat32_open(&fs, "/data/blob.bin", FAT32_O_WRITE | FAT32_O_TRUNC, &file));
+    assert(fat32_close_file(&file));
+    uint32_t free_clusters_after = 0;
+    uint32_t total_clusters = 0;
+    assert(fat32_get_free_space(&fs, &free_clusters_after, &total_clusters));
+    assert(free_clusters_after == free_clusters + 21);
+    assert(fatmap_count_free(&fs.fat_map) == free_clusters_after);
+
+    free(expected);
+    free(actual);
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 run-length FAT test passed!\n");
+}
+
+void test_fat32_file_io() {
+    printf("Testing FAT32 streaming file I/O...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+    assert(fat32_create_directory(&fs, "data"));
+
+    uint32_t total = 10 * fs.bytes_per_cluster + 1234;
+    uint8_t *expected = (uint8_t*)malloc(total);
+    uint8_t *actual = (uint8_t*)malloc(total);
+    assert(expected && actual);
+    fill_pattern(expected, total, 7);
+
+    FAT32_File file;
+    assert(!fat32_open(&fs, "/data/blob.bin", FAT32_O_READ, &file));
+    assert(fat32_open(&fs, "/data/blob.bin", FAT32_O_WRITE | FAT32_O_CREATE, &file));
+
+    uint32_t written = 0;
+    uint32_t chunks[] = { 100, 3 * fs.bytes_per_cluster + 17, 2 * fs.bytes_per_cluster + 904, 0 };
+    uint32_t offset = 0;
+    for (int i = 0; chunks[i] != 0; i++) {
+        assert(fat32_write(&file, expected + offset, chunks[i], &written));
+        assert(written == chunks[i]);
+        offset += chunks[i];
+    }
+    assert(fat32_write(&file, expected + offset, total - offset, &written));
+    assert(file.size == total);
+    assert(fat32_close_file(&file));
+
+    FAT32_DirEntry entries[10];
+    uint32_t count = 0;
+    assert(fat32_list_directory(&fs, "/data", entries, 10, &count));
+    assert(count == 3);
+    assert(strncmp(entries[2].DIR_Name, "BLOB    BIN", 11) == 0);
+    assert(entries[2].DIR_FileSize == total);
+    assert(entries[2].DIR_FstClusLO != 0);
+
+    fat32_close(&fs);
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_change_directory(&fs, "/data"));
+
+    assert(fat32_open(&fs, "blob.bin", FAT32_O_READ, &file));
+    uint32_t read = 0;
+    assert(fat32_read(&file, actual, total, &read));
+    assert(read == total);
+    assert(memcmp(actual, expected, total) == 0);
+    assert(!fat32_read(&file, actual, 1, &read) || read == 0);
+    assert(fat32_close_file(&file));
+
+    assert(fat32_open(&fs, "/data/blob.bin", FAT32_O_READ, &file));
+    memset(actual, 0, total);
+    offset = 0;
+    while (offset < total) {
+        uint32_t step = 777;
+        assert(fat32_read(&file, actual + offset, step, &read));
+        offset += read;
+        if (read < step) {
+            break;
+        }
+    }
+    assert(offset == total);
+    assert(memcmp(actual, expected, total) == 0);
+    assert(fat32_close_file(&file));
+
+    assert(!fat32_open(&fs, "/data", FAT32_O_READ, &file));
+    assert(!fat32_open(&fs, "/data/blob.bin", FAT32_O_READ | FAT32_O_TRUNC, &file));
+
+    free(expected);
+    free(actual);
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 streaming file I/O test passed!\n");
+}
+
+void test_fat32_file_modes() {
+    printf("Testing FAT32 file open modes...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+    DiskOptions options = { .backend = DISK_BACKEND_MMAP };
+
+    assert(fat32_init_with_options(&fs, test_filename, &options));
+    assert(fat32_format(&fs));
+
+    FAT32_File file;
+    assert(fat32_open(&fs, "log.txt", FAT32_O_WRITE | FAT32_O_CREATE, &file));
+    assert(fat32_write(&file, "hello ", 6, NULL));
+    assert(fat32_close_file(&file));
+
+    assert(fat32_open(&fs, "log.txt", FAT32_O_WRITE | FAT32_O_APPEND, &file));
+    assert(fat32_write(&file, "world", 5, NULL));
+    assert(fat32_close_file(&file));
+
+    char text[32] = {0};
+    uint32_t read = 0;
+    assert(fat32_open(&fs, "/log.txt", FAT32_O_READ | FAT32_O_WRITE, &file));
+    assert(fat32_read(&file, text, sizeof(text), &read));
+    assert(read == 11);
+    assert(memcmp(text, "hello world", 11) == 0);
+    assert(fat32_write(&file, "!", 1, NULL));
+    assert(file.size == 12);
+    assert(fat32_close_file(&file));
+
+    uint32_t free_before = fs.free_count;
+    assert(fat32_open(&fs, "log.txt", FAT32_O_WRITE | FAT32_O_TRUNC, &file));
+    assert(file.size == 0);
+    assert(fs.free_count == free_before + 1);
+    assert(fat32_close_file(&file));
+
+    assert(fat32_open(&fs, "log.txt", FAT32_O_READ, &file));
+    assert(file.size == 0 && file.first_cluster == 0);
+    assert(fat32_read(&file, text, sizeof(text), &read));
+    assert(read == 0);
+    assert(fat32_close_file(&file));
+
+    uint8_t *chunk = (uint8_t*)calloc(1, fs.bytes_per_cluster);
+    assert(chunk != NULL);
+    assert(fat32_open(&fs, "fill.bin", FAT32_O_WRITE | FAT32_O_CREATE, &file));
+    uint32_t written = fs.bytes_per_cluster;
+    while (written == fs.bytes_per_cluster) {
+        fat32_write(&file, chunk, fs.bytes_per_cluster, &written);
+    }
+    assert(fs.free_count == 0);
+    assert(!fat32_write(&file, chunk, 1, &written));
+    assert(written == 0);
+    assert(fat32_close_file(&file));
+    free(chunk);
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 file open modes test passed!\n");
+}
+
+void test_fat32_file_positional_io() {
+    printf("Testing FAT32 positional file I/O...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+
+    uint32_t cluster_size = fs.bytes_per_cluster;
+    uint32_t total = 64 * cluster_size;
+    uint8_t *model = (uint8_t*)malloc(total);
+    uint8_t *actual = (uint8_t*)malloc(total);
+    assert(model && actual);
+    fill_pattern(model, total, 3);
+
+    FAT32_File a;
+    FAT32_File b;
+    assert(fat32_open(&fs, "a.db", FAT32_O_WRITE | FAT32_O_CREATE, &a));
+    assert(fat32_open(&fs, "b.db", FAT32_O_WRITE | FAT32_O_CREATE, &b));
+    for (uint32_t i = 0; i < 64; i++) {
+        assert(fat32_write(&a, model + i * cluster_size, cluster_size, NULL));
+        if (i % 4 == 3) {
+            assert(fat32_write(&b, model, cluster_size, NULL));
+        }
+    }
+    assert(a.extent_count == 16);
+    assert(a.cluster_count == 64);
+    assert(fat32_close_file(&a));
+    assert(fat32_close_file(&b));
+
+    assert(fat32_open(&fs, "a.db", FAT32_O_READ | FAT32_O_WRITE, &a));
+    uint8_t block[4096];
+    uint32_t seed = 12345;
+    for (int i = 0; i < 500; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t offset = (seed >> 8) % (total - sizeof(block));
+        uint32_t done = 0;
+
+        if (i % 2 == 0) {
+            fill_pattern(block, sizeof(block), seed);
+            assert(fat32_pwrite(&a, block, sizeof(block), offset, &done));
+            assert(done == sizeof(block));
+            memcpy(model + offset, block, sizeof(block));
+        } else {
+            assert(fat32_pread(&a, block, sizeof(block), offset, &done));
+            assert(done == sizeof(block));
+            assert(memcmp(block, model + offset, sizeof(block)) == 0);
+        }
+    }
+    assert(a.position == 0);
+    assert(a.size == total);
+
+    uint32_t done = 0;
+    assert(fat32_pread(&a, block, sizeof(block), total - 100, &done));
+    assert(done == 100);
+    assert(fat32_pread(&a, block, sizeof(block), total + 100, &done));
+    assert(done == 0);
+
+    assert(fat32_pwrite(&a, "tail", 4, total + 2 * cluster_size + 10, &done));
+    assert(done == 4);
+    assert(a.size == total + 2 * cluster_size + 14);
+    assert(a.extent_count == 17);
+    assert(fat32_close_file(&a));
+
+    assert(fat32_open(&fs, "/a.db", FAT32_O_READ, &a));
+    assert(a.size == total + 2 * cluster_size + 14);
+    assert(fat32_read(&a, actual, total, &done));
+    assert(done == total);
+    assert(memcmp(actual, model, total) == 0);
+    assert(fat32_read(&a, actual, total, &done));
+    assert(done == 2 * cluster_size + 14);
+    for (uint32_t i = 0; i < 2 * cluster_size + 10; i++) {
+        assert(actual[i] == 0);
+    }
+    assert(memcmp(actual + 2 * cluster_size + 10, "tail", 4) == 0);
+    assert(fat32_close_file(&a));
+
+    free(model);
+    free(actual);
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 positional file I/O test passed!\n");
+}
+
+void test_fat32_allocate_clusters() {
+    printf("Testing FAT32 contiguous cluster allocation...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+
+    uint32_t initial_free = fs.free_count;
+    uint32_t first = 0;
+    assert(fat32_allocate_clusters(&fs, 100, 0, &first));
+    assert(first == FAT32_ROOTDIR_CLUSTER + 1);
+    for (uint32_t c = first; c < first + 99; c++) {
+        assert(fat32_get_next_cluster(&fs, c) == c + 1);
+    }
+    assert(fat32_get_next_cluster(&fs, first + 99) == FAT32_CLUSTER_END);
+    assert(fs.free_count == initial_free - 100);
+
+    uint32_t appended = 0;
+    assert(fat32_allocate_clusters(&fs, 10, first + 99, &appended));
+    assert(appended == first + 100);
+    assert(fat32_get_next_cluster(&fs, first + 99) == appended);
+
+    for (uint32_t c = first; c < first + 110; c += 2) {
+        assert(fat32_set_cluster_value(&fs, c, FAT32_CLUSTER_FREE));
+    }
+    for (uint32_t c = first + 20; c < first + 30; c++) {
+        assert(fat32_set_cluster_value(&fs, c, FAT32_CLUSTER_FREE));
+    }
+    for (uint32_t c = first + 60; c < first + 66; c++) {
+        assert(fat32_set_cluster_value(&fs, c, FAT32_CLUSTER_FREE));
+    }
+
+    uint32_t fit = 0;
+    fs.next_free = first + 19;
+    assert(fat32_allocate_clusters(&fs, 5, 0, &fit));
+    assert(fit == first + 20);
+
+    uint32_t remaining = fs.free_count;
+    assert(!fat32_allocate_clusters(&fs, remaining + 1, 0, &fit));
+    assert(fs.free_count == remaining);
+
+    uint32_t tail = 0;
+    uint32_t tail_count = fs.data_cluster_count + 2 - (first + 110);
+    assert(fat32_allocate_clusters(&fs, tail_count, 0, &tail));
+    assert(tail == first + 110);
+    assert(fs.free_count == 58);
+
+    uint32_t chain = 0;
+    fs.next_free = first + 19;
+    assert(fat32_allocate_clusters(&fs, 8, 0, &chain));
+    assert(fs.free_count == 50);
+
+    uint32_t expected[] = { 25, 26, 27, 28, 29, 30, 32, 34 };
+    uint32_t cluster = chain;
+    for (int i = 0; i < 8; i++) {
+        assert(cluster == first + expected[i]);
+        cluster = fat32_get_next_cluster(&fs, cluster);
+    }
+    assert(cluster == FAT32_CLUSTER_END);
+
+    uint32_t next_free = fs.next_free;
+    assert(!fat32_allocate_clusters(&fs, 3, fs.data_cluster_count + 2, &chain));
+    assert(fs.free_count == 50);
+    assert(fs.next_free == next_free);
+    for (uint32_t c = first + 36; c <= first + 40; c += 2) {
+        assert(fat32_get_next_cluster(&fs, c) == FAT32_CLUSTER_FREE);
+    }
+    assert(fat32_allocate_clusters(&fs, 3, 0, &chain));
+    assert(chain == first + 36);
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 contiguous cluster allocation test passed!\n");
+}
+
+static void copy_image(const char *from, const char *to) {
+    FILE *in = fopen(from, "rb");
+    FILE *out = fopen(to, "wb");
+    assert(in && out);
+
+    char buffer[65536];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        assert(fwrite(buffer, 1, length, out) == length);
+    }
+    fclose(in);
+    fclose(out);
+}
+
+void test_fat32_preallocate() {
+    printf("Testing FAT32 preallocation...\n");
+
+    const char *test_filename = get_temp_filename();
+    char snapshot[80];
+    snprintf(snapshot, sizeof(snapshot), "%s.crash", test_filename);
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+
+    uint32_t bytes = 300 * fs.bytes_per_cluster + 100;
+    uint32_t initial_free = fs.free_count;
+    assert(fat32_preallocate(&fs, "/reserved.bin", bytes, true));
+    assert(fs.free_count == initial_free - 301);
+
+    FAT32_File file;
+    assert(fat32_open(&fs, "/reserved.bin", FAT32_O_READ | FAT32_O_WRITE, &file));
+    assert(file.size == bytes);
+
+    uint8_t *data = (uint8_t*)malloc(bytes);
+    uint32_t done = 0;
+    assert(fat32_read(&file, data, bytes, &done));
+    assert(done == bytes);
+    for (uint32_t i = 0; i < bytes; i++) {
+        assert(data[i] == 0);
+    }
+    assert(file.extent_count == 1);
+    assert(file.cluster_count == 301);
+
+    fill_pattern(data, bytes, 5);
+    assert(fat32_pwrite(&file, data, bytes, 0, &done));
+    assert(done == bytes);
+    assert(fs.free_count == initial_free - 301);
+    assert(fat32_close_file(&file));
+
+    assert(fat32_preallocate(&fs, "/reserved.bin", fs.bytes_per_cluster, false));
+    assert(fat32_open(&fs, "/reserved.bin", FAT32_O_READ, &file));
+    assert(file.size == bytes);
+    assert(fat32_pread(&file, data, 64, 0, &done));
+    uint8_t expected[64];
+    fill_pattern(expected, sizeof(expected), 5);
+    assert(memcmp(data, expected, sizeof(expected)) == 0);
+    assert(fat32_close_file(&file));
+
+    assert(fat32_preallocate(&fs, "/reserved.bin", 2 * bytes, false));
+    assert(fs.free_count == initial_free - 601);
+
+    copy_image(test_filename, snapshot);
+    FAT32_FileSystem crashed;
+    assert(fat32_init(&crashed, snapshot));
+    FAT32_FSInfo fsinfo;
+    assert(disk_read_sector(&crashed.disk, crashed.bootSector.BPB_FSInfo, &fsinfo));
+    assert(fsinfo.FSI_Free_Count == initial_free - 601);
+    assert(fat32_open(&crashed, "/reserved.bin", FAT32_O_READ, &file));
+    assert(file.size == bytes);
+    uint32_t chain_length = 0;
+    for (uint32_t c = file.first_cluster; c >= 2 && c < FAT32_CLUSTER_END; c = fat32_get_next_cluster(&crashed, c)) {
+        chain_length++;
+    }
+    assert(chain_length == 601);
+    assert(fat32_close_file(&file));
+    fat32_close(&crashed);
+    remove(snapshot);
+
+    assert(fat32_open(&fs, "/reserved.bin", FAT32_O_READ | FAT32_O_WRITE, &file));
+    assert(file.size == bytes);
+
+    uint8_t tail = 0xAB;
+    assert(fat32_pwrite(&file, &tail, 1, 2 * bytes - 1, &done));
+    assert(file.size == 2 * bytes);
+    assert(fs.free_count == initial_free - 601);
+    assert(fat32_pread(&file, data, bytes, bytes, &done));
+    assert(done == bytes);
+    for (uint32_t i = 0; i + 1 < bytes; i++) {
+        assert(data[i] == 0);
+    }
+    assert(data[bytes - 1] == 0xAB);
+    assert(fat32_close_file(&file));
+
+    assert(!fat32_preallocate(&fs, "/missing/file.bin", 10, false));
+
+    free(data);
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 preallocation test passed!\n");
+}
+
+void test_fat32_deferred_sync() {
+    printf("Testing FAT32 deferred sync...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+
+    FAT32_FSInfo fsinfo;
+    assert(disk_read_sector(&fs.disk, fs.bootSector.BPB_FSInfo, &fsinfo));
+    uint32_t initial_free = fsinfo.FSI_Free_Count;
+
+    assert(fat32_set_deferred_sync(&fs, true));
+    char name[16];
+    for (int i = 0; i < 20; i++) {
+        snprintf(name, sizeof(name), "DIR%d", i);
+        assert(fat32_create_directory(&fs, name));
+        snprintf(name, sizeof(name), "F%d.TXT", i);
+        assert(fat32_create_file(&fs, name));
+    }
+    assert(fs.fsinfo_dirty);
+
+    assert(disk_read_sector(&fs.disk, fs.bootSector.BPB_FSInfo, &fsinfo));
+    assert(fsinfo.FSI_Free_Count == initial_free);
+
+    assert(fat32_set_deferred_sync(&fs, false));
+    assert(!fs.fsinfo_dirty);
+    assert(disk_read_sector(&fs.disk, fs.bootSector.BPB_FSInfo, &fsinfo));
+    uint32_t root_growth = (42 * sizeof(FAT32_DirEntry) - 1) / fs.bytes_per_cluster;
+    assert(fsinfo.FSI_Free_Count == initial_free - 20 - root_growth);
+
+    assert(fat32_set_deferred_sync(&fs, true));
+    assert(fat32_create_directory(&fs, "LAST"));
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fs.is_formatted);
+    assert(!fs.defer_sync);
+    FAT32_DirEntry entries[64];
+    uint32_t count = 0;
+    assert(fat32_list_directory(&fs, "/", entries, 64, &count));
+    assert(count == 43);
+    assert(fat32_change_directory(&fs, "/LAST"));
+    assert(fat32_change_directory(&fs, "/DIR19"));
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 deferred sync test passed!\n");
+}
+
+void test_fat32_deferred_mirrors() {
+    printf("Testing FAT32 deferred mirror updates...\n");
+
+    const char *test_filename = get_temp_filename();
+    char snapshot[80];
+    snprintf(snapshot, sizeof(snapshot), "%s.crash", test_filename);
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+    assert(fat32_set_deferred_mirrors(&fs, true));
+
+    FAT32_BootSector boot;
+    assert(disk_read_sector(&fs.disk, 0, &boot));
+    assert(boot.BPB_ExtFlags == FAT32_EXTFLAGS_NO_MIRROR);
+
+    FAT32_Stats stats;
+    fat32_reset_stats(&fs);
+    char name[16];
+    for (int i = 0; i < 10; i++) {
+        snprintf(name, sizeof(name), "DIR%d", i);
+        assert(fat32_create_directory(&fs, name));
+    }
+    uint32_t last_dir = FAT32_ROOTDIR_CLUSTER + 10;
+    assert(read_fat_entry_from_disk(&fs, 0, last_dir) == FAT32_CLUSTER_END);
+    assert(read_fat_entry_from_disk(&fs, 1, last_dir) == FAT32_CLUSTER_FREE);
+    fat32_get_stats(&fs, &stats);
+    assert(stats.fat_flushes == 10);
+    assert(stats.fat_sectors_written == 10);
+    assert(stats.fat_mirror_syncs == 0);
+
+    copy_image(test_filename, snapshot);
+
+    assert(fat32_sync(&fs));
+    assert(read_fat_entry_from_disk(&fs, 1, last_dir) == FAT32_CLUSTER_END);
+    fat32_get_stats(&fs, &stats);
+    assert(stats.fat_mirror_syncs == 1);
+    assert(stats.fat_mirror_sectors == 1);
+    assert(fat32_sync(&fs));
+    fat32_get_stats(&fs, &stats);
+    assert(stats.fat_mirror_syncs == 1);
+
+    assert(fat32_create_directory(&fs, "LAST"));
+    assert(read_fat_entry_from_disk(&fs, 1, last_dir + 1) == FAT32_CLUSTER_FREE);
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fs.bootSector.BPB_ExtFlags == 0);
+    assert(read_fat_entry_from_disk(&fs, 1, last_dir + 1) == FAT32_CLUSTER_END);
+    assert(fat32_set_deferred_mirrors(&fs, true));
+    assert(fat32_create_directory(&fs, "MORE"));
+    assert(fat32_set_deferred_mirrors(&fs, false));
+    assert(fs.bootSector.BPB_ExtFlags == 0);
+    assert(read_fat_entry_from_disk(&fs, 1, last_dir + 2) == FAT32_CLUSTER_END);
+    fat32_close(&fs);
+    remove(test_filename);
+
+    assert(fat32_init(&fs, snapshot));
+    assert(fs.is_formatted);
+    assert(fs.bootSector.BPB_ExtFlags == 0);
+    assert(disk_read_sector(&fs.disk, 0, &boot));
+    assert(boot.BPB_ExtFlags == 0);
+    for (uint32_t cluster = 0; cluster < 256; cluster++) {
+        assert(read_fat_entry_from_disk(&fs, 1, cluster) == read_fat_entry_from_disk(&fs, 0, cluster));
+    }
+    assert(read_fat_entry_from_disk(&fs, 1, last_dir) == FAT32_CLUSTER_END);
+    assert(fat32_change_directory(&fs, "/DIR9"));
+    fat32_close(&fs);
+    remove(snapshot);
+
+    printf("FAT32 deferred mirror updates test passed!\n");
+}
+
+void test_fat32_stats() {
+    printf("Testing FAT32 activity counters...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fat32_format(&fs));
+    fat32_reset_stats(&fs);
+
+    FAT32_Stats stats;
+    fat32_get_stats(&fs, &stats);
+    assert(stats.disk.write_ops == 0 && stats.syncs == 0 && stats.cache_misses == 0);
+
+    assert(fat32_create_file(&fs, "a.txt"));
+    fat32_get_stats(&fs, &stats);
+    assert(stats.syncs == 1);
+    assert(stats.fat_flushes == 0);
+    assert(stats.clusters_allocated == 0);
+    assert(stats.lookups == 1);
+    assert(stats.dir_index_misses == 1);
+    assert(stats.disk.sectors_written > 0);
+
+    assert(fat32_create_directory(&fs, "sub"));
+    fat32_get_stats(&fs, &stats);
+    assert(stats.syncs == 2);
+    assert(stats.fat_flushes == 1);
+    assert(stats.fat_sectors_written == fs.bootSector.BPB_NumFATs);
+    assert(stats.clusters_allocated == 1);
+    assert(stats.lookups == 2);
+    assert(stats.dir_index_hits == 1);
+
+    assert(fat32_change_directory(&fs, "/SUB"));
+    assert(fat32_change_directory(&fs, "/"));
+    assert(fat32_change_directory(&fs, "/SUB"));
+    fat32_get_stats(&fs, &stats);
+    assert(stats.path_resolutions >= 2);
+    assert(stats.dentry_hits >= 1);
+    assert(stats.dentry_misses >= 1);
+    assert(stats.cache_hits > 0);
+
+    fat32_reset_stats(&fs);
+    fat32_get_stats(&fs, &stats);
+    assert(stats.lookups == 0 && stats.cache_hits == 0 && stats.disk.sectors_written == 0);
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 activity counters test passed!\n");
+}
+
+static bool fat_sector_is_zero(FAT32_FileSystem *fs, uint32_t fat_index, uint32_t sector) {
+    uint8_t buffer[DISK_SECTOR_SIZE];
+    uint32_t first = fs->bootSector.BPB_RsvdSecCnt + fat_index * fs->fat_size;
+    assert(disk_read_sector(&fs->disk, first + sector, buffer));
+    for (int i = 0; i < DISK_SECTOR_SIZE; i++) {
+        if (buffer[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_fat32_format_modes() {
+    printf("Testing FAT32 quick and full format...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+    DiskOptions options = { .backend = DISK_BACKEND_FILE, .size = 1024ull * 1024 * 1024 };
+    FAT32_FormatOptions modes[] = {
+        { .mode = FAT32_FORMAT_QUICK, .threads = 1 },
+        { .mode = FAT32_FORMAT_FULL, .threads = 4 }
+    };
+
+    assert(fat32_init_with_options(&fs, test_filename, &options));
+    fat32_reset_stats(&fs);
+    assert(fat32_format_ex(&fs, &modes[0]));
+
+    FAT32_Stats stats;
+    fat32_get_stats(&fs, &stats);
+    assert(stats.disk.sectors_written < 16 + fs.sectors_per_cluster);
+    assert(stats.fat_sectors_written == fs.bootSector.BPB_NumFATs);
+
+    struct stat st;
+    assert(stat(test_filename, &st) == 0);
+    assert((uint64_t)st.st_blocks * 512 < 1024 * 1024);
+
+    for (int m = 0; m < 2; m++) {
+        assert(fat32_preallocate(&fs, "big.bin", 4 * 1024 * 1024, false));
+        assert(fat32_create_directory(&fs, "dir"));
+        fat32_close(&fs);
+
+        assert(fat32_init(&fs, test_filename));
+        assert(fs.is_formatted);
+        assert(!fat_sector_is_zero(&fs, 0, 1));
+        assert(!fat_sector_is_zero(&fs, 1, 1));
+
+        fat32_reset_stats(&fs);
+        assert(fat32_format_ex(&fs, &modes[m]));
+        fat32_get_stats(&fs, &stats);
+        if (modes[m].mode == FAT32_FORMAT_FULL) {
+            assert(stats.disk.sectors_written >= fs.first_data_sector - 1);
+            assert(stats.disk.sectors_zeroed == 0);
+        }
+        fat32_close(&fs);
+
+        assert(fat32_init(&fs, test_filename));
+        assert(fs.is_formatted);
+        assert(fat_sector_is_zero(&fs, 0, 1));
+        assert(fat_sector_is_zero(&fs, 1, 1));
+        assert(fat_sector_is_zero(&fs, 1, fs.fat_size - 1));
+        assert(fat32_get_next_cluster(&fs, FAT32_ROOTDIR_CLUSTER) >= FAT32_CLUSTER_END - 7);
+        assert(fs.free_count == fs.data_cluster_count - 1);
+
+        uint8_t boot[DISK_SECTOR_SIZE];
+        uint8_t backup[DISK_SECTOR_SIZE];
+        assert(disk_read_sector(&fs.disk, 0, boot));
+        assert(disk_read_sector(&fs.disk, fs.bootSector.BPB_BkBootSec, backup));
+        assert(memcmp(boot, backup, DISK_SECTOR_SIZE) == 0);
+        assert(disk_read_sector(&fs.disk, fs.bootSector.BPB_FSInfo, boot));
+        assert(disk_read_sector(&fs.disk, fs.bootSector.BPB_BkBootSec + 1, backup));
+        assert(memcmp(boot, backup, DISK_SECTOR_SIZE) == 0);
+
+        FAT32_DirEntry entries[10];
+        uint32_t count = 0;
+        assert(fat32_list_directory(&fs, "/", entries, 10, &count));
+        assert(count == 2);
+    }
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 quick and full format test passed!\n");
+}
+
+void test_fat32_format_geometry() {
+    printf("Testing FAT32 format geometry...\n");
+
+    const char *test_filename = get_temp_filename();
+    FAT32_FileSystem fs;
+    DiskOptions options = { .backend = DISK_BACKEND_FILE, .size = 64ull * 1024 * 1024 };
+
+    assert(fat32_init_with_options(&fs, test_filename, &options));
+    assert(fat32_format(&fs));
+    assert(fs.sectors_per_cluster == 1);
+    assert(fs.first_data_sector % 8 == 0);
+    assert(fs.bootSector.BPB_RsvdSecCnt >= FAT32_MIN_RESERVED_SECTORS);
+    fat32_close(&fs);
+    remove(test_filename);
+
+    options.size = 1024ull * 1024 * 1024;
+    assert(fat32_init_with_options(&fs, test_filename, &options));
+    assert(fat32_format(&fs));
+    assert(fs.bytes_per_cluster == 4096);
+    assert(fs.first_data_sector % 2048 == 0);
+    assert((uint64_t)fs.data_cluster_count * 4 + 8 <= (uint64_t)fs.fat_size * DISK_SECTOR_SIZE);
+    uint32_t auto_fat_size = fs.fat_size;
+    uint32_t first_data_sector = fs.first_data_sector;
+
+    FAT32_FormatOptions format = { .mode = FAT32_FORMAT_QUICK, .cluster_size = 512, .align = 4096 };
+    assert(fat32_format_ex(&fs, &format));
+    assert(fs.sectors_per_cluster == 1);
+    assert(fs.first_data_sector % 8 == 0);
+    assert(fs.fat_size > auto_fat_size * 7);
+
+    format.cluster_size = 32768;
+    format.align = 0;
+    assert(fat32_format_ex(&fs, &format));
+    assert(fs.sectors_per_cluster == 64);
+    assert(fs.first_data_sector % 2048 == 0);
+    assert(fat32_create_directory(&fs, "dir"));
+    fat32_close(&fs);
+
+    assert(fat32_init(&fs, test_filename));
+    assert(fs.is_formatted);
+    assert(fs.sectors_per_cluster == 64);
+    assert(fat32_change_directory(&fs, "/dir"));
+
+    format.cluster_size = 3000;
+    assert(!fat32_format_ex(&fs, &format));
+    format.cluster_size = 0;
+    format.align = 1000;
+    assert(!fat32_format_ex(&fs, &format));
+    format.align = 0;
+    assert(fat32_format_ex(&fs, &format));
+    assert(fs.first_data_sector == first_data_sector);
+
+    fat32_close(&fs);
+    remove(test_filename);
+
+    printf("FAT32 format geometry test passed!\n");
+}
+
 int main() {
     srand(time(NULL));
 
     test_fat32_init_format();
     test_fat32_directory_operations();
     test_fat32_file_operations();
+    test_fat32_fat_writeback();
+    test_fat32_allocation_index();
+    test_fat32_fsinfo();
+    test_fat32_mmap_backend();
+    test_fat32_small_cache();
+    test_fat32_large_image();
+    test_fat32_paged_fat();
+    test_fat32_fat_extents();
+    test_fat32_dir_index();
+    test_fat32_long_names();
+    test_fat32_dentry_cache();
+    test_fat32_file_io();
+    test_fat32_file_modes();
+    test_fat32_file_positional_io();
+    test_fat32_allocate_clusters();
+    test_fat32_preallocate();
+    test_fat32_deferred_sync();
+    test_fat32_deferred_mirrors();
+    test_fat32_stats();
+    test_fat32_format_modes();
+    test_fat32_format_geometry();
 
     printf("All FAT32 tests passed successfully!\n");
     return 0;
@@ -0,0 +1,201 @@
+#include "../include/fatcache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#define FAT_START 32
+#define FAT_SECTORS 20
+#define ENTRIES_PER_SECTOR (DISK_SECTOR_SIZE / sizeof(uint32_t))
+
+const char* get_temp_filename() {
+    static char filename[64];
+    sprintf(filename, "test_fatcache_%d.bin", rand());
+    return filename;
+}
+
+static uint32_t read_entry(Disk *disk, uint8_t copy, uint32_t cluster) {
+    uint32_t sector_data[ENTRIES_PER_SECTOR];
+    assert(disk_read_sector(disk, FAT_START + copy * FAT_SECTORS + cluster / ENTRIES_PER_SECTOR, sector_data));
+    return sector_data[cluster % ENTRIES_PER_SECTOR];
+}
+
+void test_fatcache_read_write() {
+    printf("Testing FAT cache reads and write-back...\n");
+
+    const char *test_filename = get_temp_filename();
+    Disk disk;
+    assert(disk_init(&disk, test_filename));
+
+    uint32_t sector_data[ENTRIES_PER_SECTOR];
+    for (uint32_t i = 0; i < ENTRIES_PER_SECTOR; i++) {
+        sector_data[i] = 1000 + i;
+    }
+    assert(disk_write_sector(&disk, FAT_START + 9, sector_data));
+
+    FatCache cache;
+    assert(fatcache_init(&cache, &disk, FAT_START, FAT_SECTORS, 2, FATCACHE_DEFAULT_BUDGET));
+    assert(cache.count == 0);
+
+    uint32_t value = 0;
+    assert(fatcache_get(&cache, 9 * ENTRIES_PER_SECTOR + 5, &value));
+    assert(value == 1005);
+    assert(cache.count == 1 && cache.misses == 1);
+    assert(fatcache_get(&cache, 9 * ENTRIES_PER_SECTOR + 6, &value));
+    assert(value == 1006);
+    assert(cache.count == 1 && cache.hits == 1);
+
+    assert(!fatcache_get(&cache, FAT_SECTORS * ENTRIES_PER_SECTOR, &value));
+    assert(fatcache_get(&cache, FAT_SECTORS * ENTRIES_PER_SECTOR - 1, &value));
+    assert(value == 0);
+
+    assert(fatcache_set(&cache, 300, 0x0FFFFFFF));
+    assert(fatcache_set(&cache, FAT_SECTORS * ENTRIES_PER_SECTOR - 1, 77));
+    assert(cache.dirty_pages == 2);
+    assert(read_entry(&disk, 0, 300) == 0);
+
+    assert(fatcache_flush(&cache));
+    assert(cache.dirty_pages == 0);
+    assert(cache.sectors_written == 4);
+    assert(read_entry(&disk, 0, 300) == 0x0FFFFFFF);
+    assert(read_entry(&disk, 1, 300) == 0x0FFFFFFF);
+    assert(read_entry(&disk, 0, FAT_SECTORS * ENTRIES_PER_SECTOR - 1) == 77);
+    assert(read_entry(&disk, 1, FAT_SECTORS * ENTRIES_PER_SECTOR - 1) == 77);
+    assert(read_entry(&disk, 1, 0) == 0);
+
+    assert(fatcache_flush(&cache));
+    assert(cache.sectors_written == 4);
+
+    assert(fatcache_set(&cache, 301, 5));
+    fatcache_invalidate(&cache);
+    assert(cache.count == 0);
+    assert(fatcache_get(&cache, 301, &value));
+    assert(value == 0);
+
+    fatcache_destroy(&cache);
+    disk_close(&disk);
+    remove(test_filename);
+
+    printf("FAT cache reads and write-back test passed!\n");
+}
+
+void test_fatcache_eviction() {
+    printf("Testing FAT cache eviction...\n");
+
+    const char *test_filename = get_temp_filename();
+    Disk disk;
+    assert(disk_init(&disk, test_filename));
+
+    FatCache cache;
+    uint32_t fat_sectors = 16 * FATCACHE_PAGE_SECTORS;
+    assert(fatcache_init(&cache, &disk, FAT_START, fat_sectors, 1, 0));
+    assert(cache.capacity == FATCACHE_MIN_PAGES);
+
+    assert(fatcache_set(&cache, 10, 11));
+    for (uint32_t page = 1; page < FATCACHE_MIN_PAGES + 2; page++) {
+        uint32_t value;
+        assert(fatcache_get(&cache, page * FATCACHE_PAGE_ENTRIES, &value));
+        assert(cache.count <= cache.capacity);
+    }
+    assert(cache.dirty_pages == 1);
+    assert(cache.sectors_written == 0);
+
+    for (uint32_t page = 0; page < FATCACHE_MIN_PAGES + 2; page++) {
+        assert(fatcache_set(&cache, page * FATCACHE_PAGE_ENTRIES + 1, page + 100));
+    }
+    assert(cache.count == cache.capacity);
+    assert(cache.sectors_written > 0);
+
+    for (uint32_t page = 0; page < FATCACHE_MIN_PAGES + 2; page++) {
+        uint32_t value;
+        assert(fatcache_get(&cache, page * FATCACHE_PAGE_ENTRIES + 1, &value));
+        assert(value == page + 100);
+    }
+    uint32_t value;
+    assert(fatcache_get(&cache, 10, &value));
+    assert(value == 11);
+
+    assert(fatcache_set_budget(&cache, 16 * FATCACHE_PAGE_SIZE));
+    assert(cache.capacity == 16);
+    assert(fatcache_get(&cache, 1, &value));
+    assert(value == 100);
+
+    fatcache_destroy(&cache);
+    assert(read_entry(&disk, 0, 10) == 11);
+    assert(read_entry(&disk, 0, 3 * FATCACHE_PAGE_ENTRIES + 1) == 103);
+
+    disk_close(&disk);
+    remove(test_filename);
+
+    printf("FAT cache eviction test passed!\n");
+}
+
+void test_fatcache_deferred_mirrors() {
+    printf("Testing FAT cache deferred mirror updates...\n");
+
+    const char *test_filename = get_temp_filename();
+    Disk disk;
+    assert(disk_init(&disk, test_filename));
+
+    FatCache cache;
+    assert(fatcache_init(&cache, &disk, FAT_START, FAT_SECTORS, 2, FATCACHE_DEFAULT_BUDGET));
+    assert(fatcache_set_defer_mirrors(&cache, true));
+
+    assert(fatcache_set(&cache, 200, 201));
+    assert(fatcache_set(&cache, 15 * ENTRIES_PER_SECTOR, 7));
+    assert(fatcache_flush(&cache));
+    assert(cache.sectors_written == 2);
+    assert(read_entry(&disk, 0, 200) == 201);
+    assert(read_entry(&disk, 1, 200) == 0);
+    assert(cache.stale_first == 1 && cache.stale_end == 16);
+
+    assert(fatcache_set(&cache, 201, 0x0FFFFFFF));
+    assert(fatcache_flush(&cache));
+    assert(cache.stale_first == 1 && cache.stale_end == 16);
+
+    assert(fatcache_sync_mirrors(&cache));
+    assert(cache.mirror_syncs == 1);
+    assert(cache.mirror_sectors == 15);
+    assert(cache.stale_end == 0);
+    assert(read_entry(&disk, 1, 200) == 201);
+    assert(read_entry(&disk, 1, 201) == 0x0FFFFFFF);
+    assert(read_entry(&disk, 1, 15 * ENTRIES_PER_SECTOR) == 7);
+
+    assert(fatcache_sync_mirrors(&cache));
+    assert(cache.mirror_syncs == 1);
+
+    assert(fatcache_set(&cache, 202, 9));
+    assert(fatcache_flush(&cache));
+    assert(fatcache_set_defer_mirrors(&cache, false));
+    assert(read_entry(&disk, 1, 202) == 9);
+    assert(fatcache_set(&cache, 203, 10));
+    assert(fatcache_flush(&cache));
+    assert(read_entry(&disk, 1, 203) == 10);
+    assert(cache.stale_end == 0);
+
+    uint32_t sector_data[ENTRIES_PER_SECTOR];
+    memset(sector_data, 0xAB, sizeof(sector_data));
+    assert(disk_write_sector(&disk, FAT_START + FAT_SECTORS + 4, sector_data));
+    assert(fatcache_copy(&cache, 1, 4, 1));
+    assert(read_entry(&disk, 0, 4 * ENTRIES_PER_SECTOR) == 0xABABABAB);
+    assert(!fatcache_copy(&cache, 2, 0, 1));
+    assert(!fatcache_copy(&cache, 0, FAT_SECTORS - 1, 2));
+
+    fatcache_destroy(&cache);
+    disk_close(&disk);
+    remove(test_filename);
+
+    printf("FAT cache deferred mirror updates test passed!\n");
+}
+
+int main() {
+    srand(time(NULL));
+
+    test_fatcache_read_write();
+    test_fatcache_eviction();
+    test_fatcache_deferred_mirrors();
+
+    printf("All FAT cache tests passed successfully!\n");
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "../include/fatmap.h"
+#include "../include/disk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#define FAT_SECTORS 8
+#define ENTRIES_PER_SECTOR (DISK_SECTOR_SIZE / sizeof(uint32_t))
+#define CLUSTER_END 0x0FFFFFFF
+
+static void check_against(const FatMap *map, const uint32_t *expected, uint32_t limit) {
+    uint32_t free_count = 0;
+    for (uint32_t cluster = 2; cluster < limit; cluster++) {
+        uint32_t value = 0;
+        assert(fatmap_get(map, cluster, &value));
+        assert(value == expected[cluster]);
+        if (value == 0) {
+            free_count++;
+        }
+
+        uint32_t length = 0;
+        uint32_t next = 0;
+        assert(fatmap_run(map, cluster, &length, &next));
+        assert(length >= 1 && cluster + length <= limit);
+        for (uint32_t i = 0; i + 1 < length; i++) {
+            assert(expected[cluster + i] == cluster + i + 1);
+        }
+        assert(expected[cluster + length - 1] == next);
+
+        uint32_t want_free = fatmap_find(map, cluster, limit, true);
+        uint32_t want_used = fatmap_find(map, cluster, limit, false);
+        uint32_t first_free = cluster;
+        while (first_free < limit && expected[first_free] != 0) {
+            first_free++;
+        }
+        uint32_t first_used = cluster;
+        while (first_used < limit && expected[first_used] == 0) {
+            first_used++;
+        }
+        assert(want_free == first_free);
+        assert(want_used == first_used);
+    }
+    assert(fatmap_count_free(map) == free_count);
+
+    uint32_t entries[FAT_SECTORS * ENTRIES_PER_SECTOR];
+    fatmap_read(map, 0, FAT_SECTORS * ENTRIES_PER_SECTOR, entries);
+    for (uint32_t cluster = 0; cluster < FAT_SECTORS * ENTRIES_PER_SECTOR; cluster++) {
+        assert(entries[cluster] == (cluster < limit ? expected[cluster] : 0));
+    }
+}
+
+void test_fatmap_runs() {
+    printf("Testing FAT map runs...\n");
+
+    FatMap map;
+    assert(fatmap_init(&map, FAT_SECTORS));
+    map.head[0] = 0x0FFFFFF8;
+    map.head[1] = CLUSTER_END;
+    assert(fatmap_append(&map, 1, CLUSTER_END));
+    assert(fatmap_append(&map, 500, 0));
+    assert(map.limit == 503);
+    assert(map.count == 2);
+
+    for (uint32_t cluster = 3; cluster < 12; cluster++) {
+        assert(fatmap_set(&map, cluster, cluster + 1));
+    }
+    assert(fatmap_set(&map, 12, CLUSTER_END));
+    assert(map.count == 3);
+
+    uint32_t length = 0;
+    uint32_t next = 0;
+    assert(fatmap_run(&map, 3, &length, &next));
+    assert(length == 10 && next == CLUSTER_END);
+    assert(fatmap_run(&map, 7, &length, &next));
+    assert(length == 6 && next == CLUSTER_END);
+    assert(fatmap_find(&map, 2, map.limit, true) == 13);
+    assert(fatmap_find(&map, 13, map.limit, false) == map.limit);
+    assert(fatmap_count_free(&map) == 490);
+
+    assert(fatmap_set(&map, 7, 300));
+    assert(fatmap_run(&map, 3, &length, &next));
+    assert(length == 5 && next == 300);
+    assert(fatmap_set(&map, 7, 8));
+    assert(map.count == 3);
+
+    uint32_t value = 0;
+    assert(fatmap_get(&map, 0, &value) && value == 0x0FFFFFF8);
+    assert(!fatmap_get(&map, map.limit, &value));
+    assert(!fatmap_set(&map, map.limit, 1));
+
+    assert(fatmap_is_dirty(&map, 0));
+    assert(!fatmap_is_dirty(&map, 1));
+    assert(fatmap_next_dirty(&map, 1) == FAT_SECTORS);
+    assert(fatmap_set(&map, 3 * ENTRIES_PER_SECTOR + 5, CLUSTER_END));
+    assert(fatmap_next_dirty(&map, 1) == 3);
+    fatmap_clear_dirty(&map);
+    assert(fatmap_next_dirty(&map, 0) == FAT_SECTORS);
+
+    assert(fatmap_memory(&map) >= map.count * sizeof(FatRun));
+    fatmap_destroy(&map);
+    assert(map.runs == NULL);
+
+    printf("FAT map runs test passed!\n");
+}
+
+void test_fatmap_random() {
+    printf("Testing FAT map against a flat table...\n");
+
+    uint32_t limit = 700;
+    uint32_t expected[FAT_SECTORS * ENTRIES_PER_SECTOR];
+    memset(expected, 0, sizeof(expected));
+
+    FatMap map;
+    assert(fatmap_init(&map, FAT_SECTORS));
+    for (uint32_t cluster = 2; cluster < limit; cluster++) {
+        expected[cluster] = (cluster % 50 == 0) ? CLUSTER_END : (cluster % 97 < 40 ? 0 : cluster + 1);
+        assert(fatmap_append(&map, 1, expected[cluster]));
+    }
+    check_against(&map, expected, limit);
+
+    for (int step = 0; step < 3000; step++) {
+        uint32_t cluster = 2 + (uint32_t)rand() % (limit - 2);
+        uint32_t value;
+        switch (rand() % 4) {
+            case 0: value = 0; break;
+            case 1: value = cluster + 1; break;
+            case 2: value = CLUSTER_END; break;
+            default: value = 2 + (uint32_t)rand() % (limit - 2); break;
+        }
+        assert(fatmap_set(&map, cluster, value));
+        expected[cluster] = value;
+
+        if (step % 250 == 0) {
+            check_against(&map, expected, limit);
+        }
+    }
+    check_against(&map, expected, limit);
+
+    for (uint32_t cluster = 2; cluster < limit; cluster++) {
+        assert(fatmap_set(&map, cluster, 0));
+        expected[cluster] = 0;
+    }
+    check_against(&map, expected, limit);
+    assert(map.count == 1);
+
+    fatmap_destroy(&map);
+
+    printf("FAT map against a flat table test passed!\n");
+}
+
+int main() {
+    srand(time(NULL));
+
+    test_fatmap_runs();
+    test_fatmap_random();
+
+    printf("All FAT map tests passed successfully!\n");
+    return 0;
+}
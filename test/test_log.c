@@ -0,0 +1,102 @@
+#include "../include/log.h"
+#include "../include/fat32.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+typedef struct {
+    int count[LOG_LEVEL_DEBUG + 1];
+    char last[512];
+} Captured;
+
+static void capture(LogLevel level, const char *message, void *user_data) {
+    Captured *captured = (Captured*)user_data;
+    captured->count[level]++;
+    strncpy(captured->last, message, sizeof(captured->last) - 1);
+    captured->last[sizeof(captured->last) - 1] = '\0';
+}
+
+void test_log_levels() {
+    printf("Testing log levels...\n");
+
+    Captured captured;
+    memset(&captured, 0, sizeof(captured));
+    log_set_callback(capture, &captured);
+
+    assert(log_get_level() == LOG_DEFAULT_LEVEL);
+    LOG_ERROR("error %d", 1);
+    LOG_WARN("warning %s", "two");
+    LOG_INFO("info");
+    LOG_DEBUG("debug");
+    assert(captured.count[LOG_LEVEL_ERROR] == (LOG_COMPILE_LEVEL >= LOG_LEVEL_ERROR ? 1 : 0));
+    assert(captured.count[LOG_LEVEL_WARN] == (LOG_COMPILE_LEVEL >= LOG_LEVEL_WARN ? 1 : 0));
+    assert(captured.count[LOG_LEVEL_INFO] == 0);
+    assert(captured.count[LOG_LEVEL_DEBUG] == 0);
+
+    log_write(LOG_LEVEL_WARN, "warning %s", "two");
+    assert(strcmp(captured.last, "warning two") == 0);
+
+    log_set_level(LOG_LEVEL_DEBUG);
+    LOG_DEBUG("value %u", 42u);
+    assert(captured.count[LOG_LEVEL_DEBUG] == (LOG_COMPILE_LEVEL >= LOG_LEVEL_DEBUG ? 1 : 0));
+
+    log_set_level(LOG_LEVEL_NONE);
+    int errors = captured.count[LOG_LEVEL_ERROR];
+    LOG_ERROR("dropped");
+    assert(captured.count[LOG_LEVEL_ERROR] == errors);
+    assert(!log_is_enabled(LOG_LEVEL_ERROR));
+
+    LogLevel level;
+    assert(log_parse_level("info", &level) && level == LOG_LEVEL_INFO);
+    assert(log_parse_level("none", &level) && level == LOG_LEVEL_NONE);
+    assert(!log_parse_level("verbose", &level));
+
+    log_set_level(LOG_DEFAULT_LEVEL);
+    log_set_callback(NULL, NULL);
+
+    printf("Log levels test passed!\n");
+}
+
+void test_log_filesystem_messages() {
+    printf("Testing filesystem log messages...\n");
+
+    char filename[64];
+    sprintf(filename, "test_log_%d.bin", rand());
+
+    Captured captured;
+    memset(&captured, 0, sizeof(captured));
+    log_set_callback(capture, &captured);
+
+    FAT32_FileSystem fs;
+    assert(fat32_init(&fs, filename));
+    assert(fat32_format(&fs));
+    fat32_close(&fs);
+    assert(captured.count[LOG_LEVEL_INFO] == 0);
+    assert(captured.count[LOG_LEVEL_DEBUG] == 0);
+
+    log_set_level(LOG_LEVEL_DEBUG);
+    assert(fat32_init(&fs, filename));
+    fat32_close(&fs);
+    if (LOG_COMPILE_LEVEL >= LOG_LEVEL_INFO) {
+        assert(captured.count[LOG_LEVEL_INFO] == 1);
+        assert(strcmp(captured.last, "Valid FAT32 filesystem detected") == 0);
+    }
+
+    log_set_level(LOG_DEFAULT_LEVEL);
+    log_set_callback(NULL, NULL);
+    remove(filename);
+
+    printf("Filesystem log messages test passed!\n");
+}
+
+int main() {
+    srand(time(NULL));
+
+    test_log_levels();
+    test_log_filesystem_messages();
+
+    printf("All log tests passed successfully!\n");
+    return 0;
+}
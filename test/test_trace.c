@@ -0,0 +1,93 @@
+#ifndef FAT32_TRACE
+#define FAT32_TRACE
+#endif
+
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+static void traced_leaf(void) {
+    TRACE_FUNCTION();
+}
+
+static void traced_parent(void) {
+    TRACE_SCOPE("parent");
+    traced_leaf();
+    traced_leaf();
+}
+
+void test_trace_spans() {
+    printf("Testing trace spans...\n");
+
+    traced_parent();
+    assert(trace_event_count() == 0);
+
+    assert(trace_enable(16));
+    assert(trace_is_enabled());
+    traced_parent();
+    assert(trace_event_count() == 3);
+
+    TraceEvent leaf;
+    TraceEvent parent;
+    assert(trace_get_event(0, &leaf));
+    assert(trace_get_event(2, &parent));
+    assert(strcmp(leaf.name, "traced_leaf") == 0);
+    assert(strcmp(parent.name, "parent") == 0);
+    assert(parent.start_ns <= leaf.start_ns);
+    assert(leaf.start_ns + leaf.duration_ns <= parent.start_ns + parent.duration_ns);
+    assert(!trace_get_event(3, &leaf));
+
+    trace_disable();
+    assert(!trace_is_enabled());
+    assert(trace_event_count() == 0);
+
+    printf("Trace spans test passed!\n");
+}
+
+void test_trace_ring_buffer() {
+    printf("Testing trace ring buffer...\n");
+
+    assert(trace_enable(4));
+    for (int i = 0; i < 3; i++) {
+        traced_parent();
+    }
+    assert(trace_event_count() == 4);
+    assert(trace_dropped_count() == 5);
+
+    TraceEvent event;
+    assert(trace_get_event(3, &event));
+    assert(strcmp(event.name, "parent") == 0);
+
+    char filename[64];
+    sprintf(filename, "test_trace_%d.json", rand());
+    assert(trace_write_chrome(filename));
+
+    FILE *file = fopen(filename, "r");
+    assert(file != NULL);
+    char content[4096];
+    size_t length = fread(content, 1, sizeof(content) - 1, file);
+    content[length] = '\0';
+    fclose(file);
+    remove(filename);
+
+    assert(strncmp(content, "{\"traceEvents\":[", 16) == 0);
+    assert(strstr(content, "\"name\":\"parent\",\"cat\":\"fat32\",\"ph\":\"X\"") != NULL);
+    assert(strstr(content, "\"dropped_spans\":5") != NULL);
+
+    trace_disable();
+
+    printf("Trace ring buffer test passed!\n");
+}
+
+int main() {
+    srand(time(NULL));
+
+    test_trace_spans();
+    test_trace_ring_buffer();
+
+    printf("All trace tests passed successfully!\n");
+    return 0;
+}
@@ -86,6 +86,12 @@ void test_filename_validation() {
     assert(!is_valid_filename("test/path"));
     assert(!is_valid_filename("test:invalid"));
     assert(!is_valid_filename("test?invalid"));
+    assert(!is_valid_filename("."));
+    assert(!is_valid_filename(".."));
+    assert(!is_valid_filename("trailing."));
+    assert(!is_valid_filename("trailing "));
+    assert(is_valid_filename("Long File Name.txt"));
+    assert(is_valid_filename("caf\xc3\xa9.txt"));
     
     char long_name[300];
     memset(long_name, 'a', 256);
@@ -126,6 +132,122 @@ void test_name_conversion() {
     printf("Name conversion test passed!\n");
 }
 
+void test_short_names() {
+    printf("Testing short name generation...\n");
+
+    char short_name[11];
+    uint8_t flags = 0xFF;
+
+    assert(short_name_from_name(short_name, &flags, "README.TXT"));
+    assert(memcmp(short_name, "README  TXT", 11) == 0);
+    assert(flags == 0);
+    assert(short_name_from_name(short_name, &flags, "readme.txt"));
+    assert(memcmp(short_name, "README  TXT", 11) == 0);
+    assert(flags == (SHORT_NAME_LOWER_BASE | SHORT_NAME_LOWER_EXT));
+    assert(short_name_from_name(short_name, &flags, "Makefile") == false);
+    assert(short_name_from_name(short_name, &flags, "data.BIN"));
+    assert(flags == SHORT_NAME_LOWER_BASE);
+    assert(!short_name_from_name(short_name, &flags, "toolongname.txt"));
+    assert(!short_name_from_name(short_name, &flags, "a.b.c"));
+    assert(!short_name_from_name(short_name, &flags, "with space"));
+
+    char result[13];
+    convert_from_short_name_case(result, "README  TXT", SHORT_NAME_LOWER_EXT);
+    assert(strcmp(result, "README.txt") == 0);
+
+    assert(!short_name_basis(short_name, "Long File Name.txt"));
+    assert(memcmp(short_name, "LONGFILETXT", 11) == 0);
+    assert(short_name_set_tail(short_name, 1));
+    assert(memcmp(short_name, "LONGFI~1TXT", 11) == 0);
+    assert(short_name_set_tail(short_name, 12345));
+    assert(memcmp(short_name, "LO~12345TXT", 11) == 0);
+    assert(!short_name_set_tail(short_name, 0));
+
+    assert(short_name_basis(short_name, "Readme.Txt"));
+    assert(memcmp(short_name, "README  TXT", 11) == 0);
+    assert(!short_name_basis(short_name, "archive.tar.gz"));
+    assert(memcmp(short_name, "ARCHIVETGZ ", 11) == 0);
+    assert(!short_name_basis(short_name, "a+b"));
+    assert(memcmp(short_name, "A_B        ", 11) == 0);
+    assert(!short_name_basis(short_name, "...hidden"));
+    assert(memcmp(short_name, "HIDDEN     ", 11) == 0);
+
+    assert(lfn_checksum("README  TXT") == lfn_checksum("README  TXT"));
+    assert(lfn_checksum("README  TXT") != lfn_checksum("README  TXU"));
+
+    printf("Short name generation test passed!\n");
+}
+
+void test_utf16_conversion() {
+    printf("Testing UTF-8/UTF-16 conversion...\n");
+
+    uint16_t units[16];
+    size_t length;
+    const char *name = "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80";
+    assert(utf8_to_utf16(name, units, 16, &length));
+    assert(length == 5);
+    assert(units[0] == 'a' && units[1] == 0x00E9 && units[2] == 0x20AC);
+    assert(units[3] == 0xD83D && units[4] == 0xDE00);
+
+    char back[32];
+    assert(utf16_to_utf8(units, length, back, sizeof(back)));
+    assert(strcmp(back, name) == 0);
+    assert(!utf16_to_utf8(units, length, back, 4));
+
+    assert(!utf8_to_utf16("\xc0\xaf", units, 16, &length));
+    assert(!utf8_to_utf16("\xed\xa0\x80", units, 16, &length));
+    assert(!utf8_to_utf16("\xe2\x82", units, 16, &length));
+    assert(!utf8_to_utf16("\xff", units, 16, &length));
+    assert(!utf8_to_utf16("abc", units, 2, &length));
+
+    uint16_t lone = 0xD800;
+    assert(utf16_to_utf8(&lone, 1, back, sizeof(back)));
+    assert(strcmp(back, "\xef\xbf\xbd") == 0);
+
+    uint16_t upper[3] = { 'A', 'B', 0x00C9 };
+    uint16_t lower[3] = { 'a', 'b', 0x00C9 };
+    uint16_t other[3] = { 'a', 'b', 0x00E9 };
+    assert(lfn_name_equal(upper, 3, lower, 3));
+    assert(lfn_name_hash(upper, 3) == lfn_name_hash(lower, 3));
+    assert(!lfn_name_equal(lower, 3, other, 3));
+    assert(!lfn_name_equal(lower, 2, lower, 3));
+
+    printf("UTF-8/UTF-16 conversion test passed!\n");
+}
+
+void test_parse_size() {
+    printf("Testing size parsing...\n");
+
+    uint64_t size = 0;
+
+    assert(parse_size("512", &size));
+    assert(size == 512);
+
+    assert(parse_size("64K", &size));
+    assert(size == 64ull * 1024);
+
+    assert(parse_size("20M", &size));
+    assert(size == 20ull * 1024 * 1024);
+
+    assert(parse_size("32G", &size));
+    assert(size == 32ull * 1024 * 1024 * 1024);
+
+    assert(parse_size("2TiB", &size));
+    assert(size == 2ull * 1024 * 1024 * 1024 * 1024);
+
+    assert(parse_size("1gb", &size));
+    assert(size == 1024ull * 1024 * 1024);
+
+    assert(!parse_size("", &size));
+    assert(!parse_size("G", &size));
+    assert(!parse_size("12X", &size));
+    assert(!parse_size("-5M", &size));
+    assert(!parse_size("99999999999999999999", &size));
+    assert(!parse_size("99999999999T", &size));
+
+    printf("Size parsing test passed!\n");
+}
+
 int main(void) {
     test_path_normalize();
     test_path_combine();
@@ -133,6 +255,9 @@ int main(void) {
     test_path_get_components();
     test_filename_validation();
     test_name_conversion();
+    test_short_names();
+    test_utf16_conversion();
+    test_parse_size();
     printf("All utility tests passed successfully!\n");
     return 0;
 }
\ No newline at end of file